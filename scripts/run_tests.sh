@@ -61,7 +61,7 @@ if [ "$SKIP_CPP" = false ]; then
 
 	# Define common source files needed for linking
 	# We compile these once or include them in the g++ command
-	COMMON_SOURCES="$PROJECT_ROOT/src/linux/window_utils.cpp $PROJECT_ROOT/src/linux/window_detector.cpp $PROJECT_ROOT/src/linux/window_detector_x11.cpp $PROJECT_ROOT/src/linux/window_detector_wayland.cpp $PROJECT_ROOT/src/linux/window_detector_fallback.cpp"
+	COMMON_SOURCES="$PROJECT_ROOT/src/linux/process_runner.cpp $PROJECT_ROOT/src/linux/compositor_fingerprint.cpp $PROJECT_ROOT/src/linux/backend_health.cpp $PROJECT_ROOT/src/linux/x11_client_pid.cpp $PROJECT_ROOT/src/linux/x11_connection.cpp $PROJECT_ROOT/src/linux/x11_event_watcher.cpp $PROJECT_ROOT/src/linux/x11_library.cpp $PROJECT_ROOT/src/linux/x11_property_fetch.cpp $PROJECT_ROOT/src/linux/x11_window_table.cpp $PROJECT_ROOT/src/linux/window_utils.cpp $PROJECT_ROOT/src/linux/window_detector.cpp $PROJECT_ROOT/src/linux/window_detector_x11.cpp $PROJECT_ROOT/src/linux/window_detector_wayland.cpp $PROJECT_ROOT/src/linux/window_detector_fallback.cpp $PROJECT_ROOT/src/linux/active_window_sampler.cpp $PROJECT_ROOT/src/linux/focus_change_filter.cpp $PROJECT_ROOT/src/linux/focus_session_recorder.cpp $PROJECT_ROOT/src/linux/idle_monitor.cpp $PROJECT_ROOT/src/linux/sample_scheduler.cpp $PROJECT_ROOT/src/linux/session_bus.cpp $PROJECT_ROOT/src/linux/gnome_focus_tracker.cpp $PROJECT_ROOT/src/linux/gnome_introspect_windows.cpp $PROJECT_ROOT/src/linux/kwin_focus_tracker.cpp $PROJECT_ROOT/src/linux/json_value.cpp $PROJECT_ROOT/src/linux/sway_ipc.cpp"
 
 	# Find all C++ test files in src/test/linux
 	# If src/test/linux doesn't exist, try src/test for backward compatibility or general tests
@@ -83,12 +83,12 @@ if [ "$SKIP_CPP" = false ]; then
 			acore_log_info "Compiling $BINARY..."
 
 			# Compile with all sources to ensure symbols are resolved
-			# We use pkg-config for glib-2.0 which is used by window_utils/detector
-			# shellcheck disable=SC2046
-			if g++ -g -o "$BINARY" \
+			# We use pkg-config for glib-2.0/gio-2.0 which are used by window_utils/detector
+			# shellcheck disable=SC2046,SC2086
+			if g++ -g -pthread -o "$BINARY" \
 				"$SOURCE" \
-				"$COMMON_SOURCES" \
-				$(pkg-config --cflags --libs glib-2.0) \
+				$COMMON_SOURCES \
+				$(pkg-config --cflags --libs glib-2.0 gio-2.0) \
 				-I "$INCLUDE_DIR"; then
 
 				acore_log_info "Executing $BINARY..."
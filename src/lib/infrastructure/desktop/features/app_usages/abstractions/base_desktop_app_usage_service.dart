@@ -17,6 +17,10 @@ abstract class BaseDesktopAppUsageService extends BaseAppUsageService {
     super.appUsageFilterService,
   );
 
+  /// Returned by [getActiveWindow] while the user is away from the computer.
+  /// No time is recorded for it, and it does not count as a failure.
+  static const String idleWindowOutput = '<idle>';
+
   @protected
   Future<String?> getActiveWindow();
 
@@ -39,7 +43,7 @@ abstract class BaseDesktopAppUsageService extends BaseAppUsageService {
       }
 
       if (currentWindow != _activeDesktopWindowOutput) {
-        if (_activeDesktopWindowOutput.isNotEmpty) {
+        if (_activeDesktopWindowOutput.isNotEmpty && _activeDesktopWindowOutput != idleWindowOutput) {
           List<String> activeWindowOutputSections = _activeDesktopWindowOutput.split(',');
           String windowTitle = activeWindowOutputSections[0];
           String windowProcess = activeWindowOutputSections[1];
@@ -57,7 +61,10 @@ abstract class BaseDesktopAppUsageService extends BaseAppUsageService {
         _activeDesktopWindowTime = 0;
       }
 
-      _activeDesktopWindowTime += 1;
+      // Idle time belongs to no app
+      if (currentWindow != idleWindowOutput) {
+        _activeDesktopWindowTime += 1;
+      }
     });
   }
 
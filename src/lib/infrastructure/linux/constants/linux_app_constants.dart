@@ -14,6 +14,9 @@ class _Channels {
   /// App usage detection channel
   String get appUsage => "${LinuxAppConstants.packageName}/app_usage";
 
+  /// Focus change event channel, pushed by the native side on window changes
+  String get appUsageFocusEvents => "$appUsage/focus_events";
+
   /// Window management channel
   String get windowManagement => "${LinuxAppConstants.packageName}/window_management";
 }
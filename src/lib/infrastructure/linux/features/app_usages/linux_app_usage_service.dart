@@ -5,6 +5,7 @@ import 'package:whph/infrastructure/linux/constants/linux_app_constants.dart';
 
 class LinuxAppUsageService extends BaseDesktopAppUsageService {
   static final MethodChannel _channel = MethodChannel(LinuxAppConstants.channels.appUsage);
+  static const int _structuredReplyVersion = 2;
 
   LinuxAppUsageService(
     super.appUsageRepository,
@@ -17,9 +18,19 @@ class LinuxAppUsageService extends BaseDesktopAppUsageService {
   @override
   Future<String?> getActiveWindow() async {
     try {
-      // Use native method channel instead of bash script
-      final String? result = await _channel.invokeMethod('getActiveWindow');
-      return result;
+      // Use native method channel instead of bash script. The structured
+      // reply also says whether the user is idle, which the legacy string
+      // reports as an "unknown" window.
+      final result = await _channel.invokeMethod<Map<dynamic, dynamic>>(
+        'getActiveWindow',
+        {'version': _structuredReplyVersion},
+      );
+      if (result == null) return null;
+      if (result['idle'] == true) return BaseDesktopAppUsageService.idleWindowOutput;
+
+      final title = result['title'] as String? ?? '';
+      final application = result['application'] as String? ?? '';
+      return '$title,$application';
     } on PlatformException catch (e) {
       Logger.error('Platform error: ${e.message}');
       return null;
@@ -0,0 +1,173 @@
+#include "active_window_sampler.h"
+#include <atomic>
+#include <time.h>
+
+std::chrono::nanoseconds BootTimeNow() {
+  struct timespec ts;
+  clock_gettime(CLOCK_BOOTTIME, &ts);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
+ActiveWindowSampler::ActiveWindowSampler(WindowDetector &detector,
+                                         std::mutex &detector_mutex,
+                                         std::chrono::milliseconds interval)
+    : detector_(detector), detector_mutex_(detector_mutex),
+      interval_(interval) {}
+
+ActiveWindowSampler::~ActiveWindowSampler() { Stop(); }
+
+void ActiveWindowSampler::SetSnapshotListener(SnapshotListener listener) {
+  snapshot_listener_ = std::move(listener);
+}
+
+void ActiveWindowSampler::Start() {
+  std::lock_guard<std::mutex> lock(wake_mutex_);
+  if (running_) {
+    return;
+  }
+  running_ = true;
+  thread_ = std::thread(&ActiveWindowSampler::Run, this);
+}
+
+void ActiveWindowSampler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    if (!running_) {
+      return;
+    }
+    running_ = false;
+  }
+  wake_cv_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+std::shared_ptr<const WindowSnapshot> ActiveWindowSampler::Latest() const {
+  return std::atomic_load(&latest_);
+}
+
+void ActiveWindowSampler::RequestSample() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    sample_requested_ = true;
+  }
+  wake_cv_.notify_all();
+}
+
+void ActiveWindowSampler::SetIdleProbe(
+    IdleProbe probe, std::chrono::milliseconds poll_interval) {
+  idle_probe_ = std::move(probe);
+  idle_poll_interval_ = poll_interval;
+}
+
+void ActiveWindowSampler::SetIdleThreshold(
+    std::chrono::milliseconds threshold) {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    idle_threshold_ = threshold;
+  }
+  wake_cv_.notify_all();
+}
+
+std::chrono::milliseconds ActiveWindowSampler::IdleThreshold() const {
+  std::lock_guard<std::mutex> lock(wake_mutex_);
+  return idle_threshold_;
+}
+
+bool ActiveWindowSampler::CheckIdle(std::chrono::milliseconds *idle_for) {
+  std::chrono::milliseconds threshold = IdleThreshold();
+  if (!idle_probe_ || threshold.count() <= 0) {
+    return false;
+  }
+  return idle_probe_(idle_for) && *idle_for >= threshold;
+}
+
+void ActiveWindowSampler::Run() {
+  bool idle = false;
+  while (true) {
+    bool was_idle = idle;
+    std::chrono::milliseconds idle_for(0);
+    idle = CheckIdle(&idle_for);
+    if (idle) {
+      if (!was_idle) {
+        PublishIdle(idle_for);
+      }
+    } else {
+      WindowInfo info;
+      std::chrono::steady_clock::duration detection_time;
+      {
+        std::lock_guard<std::mutex> lock(detector_mutex_);
+        auto started_at = std::chrono::steady_clock::now();
+        info = detector_.GetActiveWindow();
+        detection_time = std::chrono::steady_clock::now() - started_at;
+      }
+      // The window has been in use since input resumed, not just since now
+      if (was_idle && info.changed_at.count() == 0) {
+        info.changed_at = BootTimeNow() - idle_for;
+      }
+      Publish(info, std::chrono::duration_cast<std::chrono::microseconds>(
+                        detection_time));
+    }
+
+    // Sleep until the next interval, an explicit request or Stop().
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    auto interval = interval_;
+    if (idle && idle_poll_interval_.count() > 0) {
+      interval = idle_poll_interval_;
+    }
+    auto deadline = std::chrono::steady_clock::now() + interval;
+    wake_cv_.wait_until(lock, deadline, [this, &deadline] {
+      return !running_ || sample_requested_ ||
+             std::chrono::steady_clock::now() >= deadline;
+    });
+    if (!running_) {
+      return;
+    }
+    sample_requested_ = false;
+  }
+}
+
+void ActiveWindowSampler::Publish(const WindowInfo &info,
+                                  std::chrono::microseconds detection_time) {
+  auto snapshot = std::make_shared<WindowSnapshot>();
+  snapshot->info = info;
+  snapshot->detection_time = detection_time;
+  snapshot->captured_at = std::chrono::steady_clock::now();
+  snapshot->captured_at_boottime = BootTimeNow();
+
+  // Date the snapshot back to the change itself when the backend knows it,
+  // but never before the previous snapshot
+  std::chrono::nanoseconds since_change =
+      snapshot->captured_at_boottime - info.changed_at;
+  if (info.changed_at.count() > 0 && since_change.count() > 0 &&
+      info.changed_at > last_captured_at_boottime_) {
+    snapshot->captured_at -=
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            since_change);
+    snapshot->captured_at_boottime = info.changed_at;
+  }
+  Store(std::move(snapshot));
+}
+
+void ActiveWindowSampler::PublishIdle(std::chrono::milliseconds idle_for) {
+  auto snapshot = std::make_shared<WindowSnapshot>();
+  snapshot->info = WindowInfo{"unknown", "unknown"};
+  snapshot->idle = true;
+  // Dated back to the last input. Unlike a change, this may precede the
+  // previous snapshot: those were taken while nobody was there.
+  snapshot->captured_at = std::chrono::steady_clock::now() - idle_for;
+  snapshot->captured_at_boottime = BootTimeNow() - idle_for;
+  Store(std::move(snapshot));
+}
+
+void ActiveWindowSampler::Store(std::shared_ptr<WindowSnapshot> snapshot) {
+  snapshot->sequence = ++sequence_;
+  last_captured_at_boottime_ = snapshot->captured_at_boottime;
+  std::shared_ptr<const WindowSnapshot> published(std::move(snapshot));
+  std::atomic_store(&latest_, published);
+
+  if (snapshot_listener_) {
+    snapshot_listener_(std::move(published));
+  }
+}
@@ -0,0 +1,108 @@
+#ifndef ACTIVE_WINDOW_SAMPLER_H_
+#define ACTIVE_WINDOW_SAMPLER_H_
+
+#include "window_detector.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Immutable result of one detection. Published as a whole and never modified
+// afterwards, so readers can hold on to it without locking.
+struct WindowSnapshot {
+  WindowInfo info;
+  // steady_clock (CLOCK_MONOTONIC) time at which detection finished, or at
+  // which the change happened if the backend reported it (see
+  // WindowInfo::changed_at).
+  std::chrono::steady_clock::time_point captured_at;
+  // Same instant on CLOCK_BOOTTIME, which keeps advancing during suspend.
+  std::chrono::nanoseconds captured_at_boottime{0};
+  // Increments with every published snapshot, starting at 1.
+  uint64_t sequence = 0;
+  // How long the detector took to produce info.
+  std::chrono::microseconds detection_time{0};
+  // The user went idle: info is unknown and captured_at is the time of their
+  // last input. Detection is paused until the next non-idle snapshot.
+  bool idle = false;
+};
+
+// Current CLOCK_BOOTTIME time.
+std::chrono::nanoseconds BootTimeNow();
+
+// Runs WindowDetector::GetActiveWindow() on its own thread and schedule and
+// publishes the newest result, so readers never wait on a slow backend.
+class ActiveWindowSampler {
+public:
+  // detector_mutex must be the lock every other user of detector holds.
+  ActiveWindowSampler(WindowDetector &detector, std::mutex &detector_mutex,
+                      std::chrono::milliseconds interval);
+  ~ActiveWindowSampler();
+
+  ActiveWindowSampler(const ActiveWindowSampler &) = delete;
+  ActiveWindowSampler &operator=(const ActiveWindowSampler &) = delete;
+
+  // Called on the sampler thread after every published snapshot. Must be
+  // set before Start().
+  using SnapshotListener =
+      std::function<void(std::shared_ptr<const WindowSnapshot>)>;
+  void SetSnapshotListener(SnapshotListener listener);
+
+  void Start();
+  // Blocks until a detection in progress has finished.
+  void Stop();
+
+  // Newest snapshot, or nullptr before the first detection completed.
+  // Safe to call from any thread.
+  std::shared_ptr<const WindowSnapshot> Latest() const;
+
+  // Wakes the sampler to detect now instead of at the next interval.
+  void RequestSample();
+
+  // Stores the time since the user's last input in idle. Returns false when
+  // that is unknown, in which case the user counts as active. Called on the
+  // sampler thread.
+  using IdleProbe = std::function<bool(std::chrono::milliseconds *idle)>;
+
+  // Once the probe reports at least the idle threshold, detection stops: one
+  // idle snapshot is published, and then only the probe runs, every
+  // poll_interval, until input resumes. Must be set before Start().
+  void SetIdleProbe(IdleProbe probe, std::chrono::milliseconds poll_interval);
+
+  // Zero, the default, disables idle detection.
+  void SetIdleThreshold(std::chrono::milliseconds threshold);
+  std::chrono::milliseconds IdleThreshold() const;
+
+private:
+  void Run();
+  // True if the user has been idle for at least the threshold; idle_for
+  // receives how long.
+  bool CheckIdle(std::chrono::milliseconds *idle_for);
+  void Publish(const WindowInfo &info,
+               std::chrono::microseconds detection_time);
+  void PublishIdle(std::chrono::milliseconds idle_for);
+  void Store(std::shared_ptr<WindowSnapshot> snapshot);
+
+  WindowDetector &detector_;
+  std::mutex &detector_mutex_;
+
+  // Only accessed through std::atomic_load/std::atomic_store.
+  std::shared_ptr<const WindowSnapshot> latest_;
+  uint64_t sequence_ = 0;
+  std::chrono::nanoseconds last_captured_at_boottime_{0};
+  SnapshotListener snapshot_listener_;
+  IdleProbe idle_probe_;
+  std::chrono::milliseconds idle_poll_interval_{0};
+
+  mutable std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  const std::chrono::milliseconds interval_;
+  std::chrono::milliseconds idle_threshold_{0};
+  bool running_ = false;
+  bool sample_requested_ = false;
+  std::thread thread_;
+};
+
+#endif // ACTIVE_WINDOW_SAMPLER_H_
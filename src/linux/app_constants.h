@@ -14,4 +14,7 @@
 #define APP_USAGE_CHANNEL PACKAGE_NAME "/app_usage"
 #define WINDOW_MANAGEMENT_CHANNEL PACKAGE_NAME "/window_management"
 
+// Event channel names
+#define APP_USAGE_FOCUS_EVENTS_CHANNEL APP_USAGE_CHANNEL "/focus_events"
+
 #endif // APP_CONSTANTS_H
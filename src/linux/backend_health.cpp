@@ -0,0 +1,82 @@
+#include "backend_health.h"
+#include <algorithm>
+
+constexpr uint32_t BackendHealthTracker::kFailuresBeforeQuarantine;
+
+BackendHealthTracker::BackendHealthTracker(Clock::duration backoff,
+                                           Clock::duration max_backoff,
+                                           Clock::duration proven_max_backoff)
+    : backoff_(backoff), max_backoff_(max_backoff),
+      proven_max_backoff_(proven_max_backoff) {}
+
+bool BackendHealthTracker::ShouldTry(const std::string &backend,
+                                     Clock::time_point now) const {
+  auto it = stats_.find(backend);
+  return it == stats_.end() || now >= it->second.quarantined_until;
+}
+
+void BackendHealthTracker::RecordSuccess(const std::string &backend,
+                                         Clock::duration latency) {
+  Stats &stats = stats_[backend];
+  Record(stats, latency);
+  stats.successes++;
+  stats.consecutive_failures = 0;
+  stats.quarantined_until = Clock::time_point();
+  preferred_ = backend;
+}
+
+void BackendHealthTracker::RecordFailure(const std::string &backend,
+                                         Clock::duration latency,
+                                         Clock::time_point now) {
+  Stats &stats = stats_[backend];
+  Record(stats, latency);
+  stats.consecutive_failures++;
+  if (stats.consecutive_failures < kFailuresBeforeQuarantine) {
+    return;
+  }
+
+  Clock::duration limit =
+      stats.successes > 0 ? proven_max_backoff_ : max_backoff_;
+  Clock::duration quarantine = backoff_;
+  for (uint32_t i = kFailuresBeforeQuarantine;
+       i < stats.consecutive_failures && quarantine < limit; i++) {
+    quarantine *= 2;
+  }
+  stats.quarantined_until = now + std::min(quarantine, limit);
+}
+
+std::vector<std::string>
+BackendHealthTracker::Order(const std::vector<std::string> &candidates,
+                            Clock::time_point now) const {
+  std::vector<std::string> order;
+  for (const std::string &backend : candidates) {
+    if (ShouldTry(backend, now)) {
+      order.push_back(backend);
+    }
+  }
+
+  auto preferred = std::find(order.begin(), order.end(), preferred_);
+  if (preferred != order.end()) {
+    std::rotate(order.begin(), preferred, preferred + 1);
+  }
+  return order;
+}
+
+BackendHealthTracker::Stats
+BackendHealthTracker::Get(const std::string &backend) const {
+  auto it = stats_.find(backend);
+  return it != stats_.end() ? it->second : Stats();
+}
+
+void BackendHealthTracker::Reset() {
+  stats_.clear();
+  preferred_.clear();
+}
+
+void BackendHealthTracker::Record(Stats &stats, Clock::duration latency) {
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(latency);
+  stats.average_latency = stats.attempts == 0
+                              ? micros
+                              : (stats.average_latency * 7 + micros) / 8;
+  stats.attempts++;
+}
@@ -0,0 +1,70 @@
+#ifndef BACKEND_HEALTH_H_
+#define BACKEND_HEALTH_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Success rate and latency of each detection backend, keyed by backend name.
+//
+// A backend that keeps failing is quarantined with exponential backoff, so
+// polls stop paying for backends that are reachable but never answer (e.g.
+// org.gnome.Shell.Eval on GNOME 41+). The backend that answered last is
+// promoted to the front of the order.
+//
+// Not thread-safe; callers serialize access like every other detector call.
+class BackendHealthTracker {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stats {
+    uint64_t attempts = 0;
+    uint64_t successes = 0;
+    uint32_t consecutive_failures = 0;
+    // Exponentially weighted moving average over all attempts.
+    std::chrono::microseconds average_latency{0};
+    Clock::time_point quarantined_until;
+  };
+
+  // Failures in a row before a backend is quarantined.
+  static constexpr uint32_t kFailuresBeforeQuarantine = 3;
+
+  // backoff is the first quarantine, doubled for every further failure up to
+  // max_backoff. A backend that has answered before is capped at
+  // proven_max_backoff instead: its failures usually mean that no window
+  // has focus, and it should notice the next focused window quickly.
+  BackendHealthTracker(Clock::duration backoff = std::chrono::seconds(2),
+                       Clock::duration max_backoff = std::chrono::minutes(5),
+                       Clock::duration proven_max_backoff =
+                           std::chrono::seconds(10));
+
+  // False while the backend is quarantined.
+  bool ShouldTry(const std::string &backend, Clock::time_point now) const;
+
+  void RecordSuccess(const std::string &backend, Clock::duration latency);
+  void RecordFailure(const std::string &backend, Clock::duration latency,
+                     Clock::time_point now);
+
+  // candidates with the last successful backend moved to the front and
+  // quarantined backends removed. Otherwise keeps the given order.
+  std::vector<std::string> Order(const std::vector<std::string> &candidates,
+                                 Clock::time_point now) const;
+
+  // Empty Stats for a backend that was never tried.
+  Stats Get(const std::string &backend) const;
+
+  void Reset();
+
+private:
+  void Record(Stats &stats, Clock::duration latency);
+
+  Clock::duration backoff_;
+  Clock::duration max_backoff_;
+  Clock::duration proven_max_backoff_;
+  std::map<std::string, Stats> stats_;
+  std::string preferred_;
+};
+
+#endif // BACKEND_HEALTH_H_
@@ -0,0 +1,242 @@
+#include "compositor_fingerprint.h"
+#include "session_bus.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace {
+
+constexpr const char *kGnomeShellBusName = "org.gnome.Shell";
+constexpr const char *kKwinBusName = "org.kde.KWin";
+constexpr gint kBusCallTimeoutMs = 500;
+
+// Desktop names (as found in XDG_CURRENT_DESKTOP) of compositors served by
+// the wlroots backend.
+const char *const kWlrootsDesktops[] = {"hyprland", "river", "wayfire",
+                                        "labwc", "niri"};
+
+std::string ToLower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return value;
+}
+
+bool HasDesktop(const std::string &desktops, const std::string &name) {
+  size_t start = 0;
+  while (start <= desktops.size()) {
+    size_t end = desktops.find(':', start);
+    if (end == std::string::npos) {
+      end = desktops.size();
+    }
+    if (desktops.compare(start, end - start, name) == 0) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+bool IsSocket(const char *path) {
+  struct stat st;
+  return path && *path && stat(path, &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+bool IsSet(const char *name) {
+  const char *value = getenv(name);
+  return value && *value;
+}
+
+} // namespace
+
+const char *WaylandBackendName(WaylandBackend backend) {
+  switch (backend) {
+  case WaylandBackend::kGnomeShell:
+    return "gnome-shell";
+  case WaylandBackend::kSway:
+    return "sway";
+  case WaylandBackend::kKwin:
+    return "kwin";
+  case WaylandBackend::kWlroots:
+    return "wlroots";
+  }
+  return "unknown";
+}
+
+std::vector<WaylandBackend>
+PlanWaylandBackends(const CompositorEnvironment &env) {
+  std::vector<WaylandBackend> plan;
+  auto add = [&plan](WaylandBackend backend) {
+    if (std::find(plan.begin(), plan.end(), backend) == plan.end()) {
+      plan.push_back(backend);
+    }
+  };
+
+  // Running compositors first: they answer on the bus or own a socket
+  if (env.gnome_shell_owned) {
+    add(WaylandBackend::kGnomeShell);
+  }
+  if (env.sway_socket) {
+    add(WaylandBackend::kSway);
+  }
+  if (env.kwin_owned) {
+    add(WaylandBackend::kKwin);
+  }
+  if (env.hyprland) {
+    add(WaylandBackend::kWlroots);
+  }
+
+  // Then what the session claims to be. Inside Flatpak the bus proxy may
+  // hide the compositor's name, so this is often the only evidence.
+  if (HasDesktop(env.desktop, "gnome")) {
+    add(WaylandBackend::kGnomeShell);
+  }
+  if (HasDesktop(env.desktop, "sway")) {
+    add(WaylandBackend::kSway);
+  }
+  if (env.kde_session || HasDesktop(env.desktop, "kde") ||
+      HasDesktop(env.desktop, "plasma")) {
+    add(WaylandBackend::kKwin);
+  }
+  for (const char *desktop : kWlrootsDesktops) {
+    if (HasDesktop(env.desktop, desktop)) {
+      add(WaylandBackend::kWlroots);
+    }
+  }
+
+  if (plan.empty()) {
+    plan = {WaylandBackend::kGnomeShell, WaylandBackend::kSway,
+            WaylandBackend::kKwin, WaylandBackend::kWlroots};
+  }
+  return plan;
+}
+
+constexpr std::chrono::seconds CompositorFingerprint::kFailureReprobeInterval;
+
+CompositorFingerprint::CompositorFingerprint() {
+  connection_ = SessionBus();
+  if (!connection_) {
+    return;
+  }
+
+  for (const char *name : {kGnomeShellBusName, kKwinBusName}) {
+    watch_ids_.push_back(g_bus_watch_name_on_connection(
+        connection_, name, G_BUS_NAME_WATCHER_FLAGS_NONE, OnNameAppeared,
+        OnNameVanished, this, nullptr));
+  }
+}
+
+CompositorFingerprint::~CompositorFingerprint() {
+  for (guint id : watch_ids_) {
+    g_bus_unwatch_name(id);
+  }
+}
+
+std::vector<WaylandBackend> CompositorFingerprint::Plan() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (probed_) {
+      return plan_;
+    }
+  }
+
+  // Probe without the lock, so bus name callbacks on the main thread never
+  // wait for the D-Bus round trips below.
+  std::map<std::string, std::string> owners;
+  CompositorEnvironment env = Probe(owners);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  owners_ = std::move(owners);
+  plan_ = PlanWaylandBackends(env);
+  probed_ = true;
+  last_probe_ = std::chrono::steady_clock::now();
+  return plan_;
+}
+
+bool CompositorFingerprint::Includes(WaylandBackend backend) {
+  std::vector<WaylandBackend> plan = Plan();
+  return std::find(plan.begin(), plan.end(), backend) != plan.end();
+}
+
+void CompositorFingerprint::ReportFailure() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto since_probe = std::chrono::steady_clock::now() - last_probe_;
+  if (probed_ && since_probe >= kFailureReprobeInterval) {
+    probed_ = false;
+  }
+}
+
+CompositorEnvironment
+CompositorFingerprint::Probe(std::map<std::string, std::string> &owners) {
+  CompositorEnvironment env;
+  for (const char *var :
+       {"XDG_CURRENT_DESKTOP", "XDG_SESSION_DESKTOP", "DESKTOP_SESSION"}) {
+    const char *value = getenv(var);
+    if (value && *value) {
+      if (!env.desktop.empty()) {
+        env.desktop += ':';
+      }
+      env.desktop += ToLower(value);
+    }
+  }
+  env.sway_socket = IsSocket(getenv("SWAYSOCK"));
+  env.hyprland = IsSet("HYPRLAND_INSTANCE_SIGNATURE");
+  env.kde_session = IsSet("KDE_FULL_SESSION");
+
+  for (const char *name : {kGnomeShellBusName, kKwinBusName}) {
+    owners[name] = GetNameOwner(name);
+  }
+  env.gnome_shell_owned = !owners[kGnomeShellBusName].empty();
+  env.kwin_owned = !owners[kKwinBusName].empty();
+  return env;
+}
+
+std::string CompositorFingerprint::GetNameOwner(const char *name) {
+  if (!connection_) {
+    return "";
+  }
+
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_sync(
+      connection_, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+      "org.freedesktop.DBus", "GetNameOwner", g_variant_new("(s)", name),
+      G_VARIANT_TYPE("(s)"), G_DBUS_CALL_FLAGS_NONE, kBusCallTimeoutMs,
+      nullptr, &error);
+  if (!reply) {
+    // org.freedesktop.DBus.Error.NameHasNoOwner: nobody owns the name
+    g_clear_error(&error);
+    return "";
+  }
+
+  const gchar *owner = nullptr;
+  g_variant_get(reply, "(&s)", &owner);
+  std::string result = owner ? owner : "";
+  g_variant_unref(reply);
+  return result;
+}
+
+void CompositorFingerprint::OnNameAppeared(GDBusConnection *connection,
+                                           const gchar *name,
+                                           const gchar *name_owner,
+                                           gpointer user_data) {
+  static_cast<CompositorFingerprint *>(user_data)->OnNameOwnerChanged(
+      name, name_owner ? name_owner : "");
+}
+
+void CompositorFingerprint::OnNameVanished(GDBusConnection *connection,
+                                           const gchar *name,
+                                           gpointer user_data) {
+  static_cast<CompositorFingerprint *>(user_data)->OnNameOwnerChanged(name,
+                                                                      "");
+}
+
+void CompositorFingerprint::OnNameOwnerChanged(const std::string &name,
+                                               const std::string &owner) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The watch reports the current owner once when it starts; that only
+  // matters if it differs from what the last probe saw.
+  auto it = owners_.find(name);
+  if (probed_ && it != owners_.end() && it->second != owner) {
+    probed_ = false;
+  }
+}
@@ -0,0 +1,87 @@
+#ifndef COMPOSITOR_FINGERPRINT_H_
+#define COMPOSITOR_FINGERPRINT_H_
+
+#include <gio/gio.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Ways of querying the active window on Wayland, one per compositor family.
+enum class WaylandBackend { kGnomeShell, kSway, kKwin, kWlroots };
+
+const char *WaylandBackendName(WaylandBackend backend);
+
+// What a probe found out about the running session.
+struct CompositorEnvironment {
+  // Lower-cased, colon-separated XDG_CURRENT_DESKTOP, XDG_SESSION_DESKTOP and
+  // DESKTOP_SESSION, e.g. "ubuntu:gnome".
+  std::string desktop;
+  // SWAYSOCK points to an existing socket.
+  bool sway_socket = false;
+  // HYPRLAND_INSTANCE_SIGNATURE is set.
+  bool hyprland = false;
+  // KDE_FULL_SESSION is set.
+  bool kde_session = false;
+  // The D-Bus names are owned on the session bus.
+  bool gnome_shell_owned = false;
+  bool kwin_owned = false;
+};
+
+// Ordered list of backends worth trying for env. Backends with positive
+// evidence come first; without any evidence every backend is tried in the
+// historical order.
+std::vector<WaylandBackend>
+PlanWaylandBackends(const CompositorEnvironment &env);
+
+// Works out once which compositor is running and caches the resulting
+// backend plan, instead of probing every backend on every poll.
+//
+// The plan is recomputed when the owner of a watched D-Bus name
+// (org.gnome.Shell, org.kde.KWin) changes, or after ReportFailure().
+// Construct on the thread whose main context should receive bus name
+// changes; Plan() and ReportFailure() may be called from any thread.
+class CompositorFingerprint {
+public:
+  CompositorFingerprint();
+  ~CompositorFingerprint();
+
+  CompositorFingerprint(const CompositorFingerprint &) = delete;
+  CompositorFingerprint &operator=(const CompositorFingerprint &) = delete;
+
+  std::vector<WaylandBackend> Plan();
+  bool Includes(WaylandBackend backend);
+
+  // Every backend in the plan failed. Triggers a re-probe, at most once per
+  // kFailureReprobeInterval so a session without a focused window does not
+  // probe on every poll.
+  void ReportFailure();
+
+  static constexpr std::chrono::seconds kFailureReprobeInterval{30};
+
+private:
+  // Reads the environment and the owners of the watched bus names.
+  CompositorEnvironment Probe(std::map<std::string, std::string> &owners);
+  std::string GetNameOwner(const char *name);
+
+  static void OnNameAppeared(GDBusConnection *connection, const gchar *name,
+                             const gchar *name_owner, gpointer user_data);
+  static void OnNameVanished(GDBusConnection *connection, const gchar *name,
+                             gpointer user_data);
+  void OnNameOwnerChanged(const std::string &name, const std::string &owner);
+
+  std::mutex mutex_;
+  bool probed_ = false;
+  std::vector<WaylandBackend> plan_;
+  // Owner of each watched name at probe time, empty if unowned.
+  std::map<std::string, std::string> owners_;
+  std::chrono::steady_clock::time_point last_probe_;
+
+  // The shared session bus; not owned.
+  GDBusConnection *connection_ = nullptr;
+  std::vector<guint> watch_ids_;
+};
+
+#endif // COMPOSITOR_FINGERPRINT_H_
@@ -0,0 +1,64 @@
+#include "focus_change_filter.h"
+
+FocusChangeFilter::FocusChangeFilter(std::chrono::milliseconds debounce)
+    : debounce_(debounce) {}
+
+bool FocusChangeFilter::SameWindow(const WindowInfo &a, const WindowInfo &b) {
+  return a.title == b.title && a.application == b.application;
+}
+
+void FocusChangeFilter::Offer(const WindowInfo &info, Time changed_at) {
+  // Switching back to the reported window within the debounce period
+  // cancels the pending change.
+  if (has_reported_ && SameWindow(info, reported_)) {
+    has_pending_ = false;
+    return;
+  }
+
+  if (has_pending_ && SameWindow(info, pending_)) {
+    return;
+  }
+
+  has_pending_ = true;
+  pending_ = info;
+  pending_since_ = changed_at;
+}
+
+bool FocusChangeFilter::TakeReady(Time now, WindowInfo *out,
+                                  Time *changed_at) {
+  if (!has_pending_ || now - pending_since_ < debounce_) {
+    return false;
+  }
+
+  has_pending_ = false;
+  has_reported_ = true;
+  reported_ = pending_;
+  if (out) {
+    *out = reported_;
+  }
+  if (changed_at) {
+    *changed_at = pending_since_;
+  }
+  return true;
+}
+
+std::chrono::milliseconds
+FocusChangeFilter::TimeUntilReady(Time now) const {
+  auto elapsed =
+      std::chrono::duration_cast<std::chrono::milliseconds>(now - pending_since_);
+  if (elapsed >= debounce_) {
+    return std::chrono::milliseconds(0);
+  }
+  return debounce_ - elapsed;
+}
+
+void FocusChangeFilter::MarkReported(const WindowInfo &info) {
+  has_pending_ = false;
+  has_reported_ = true;
+  reported_ = info;
+}
+
+void FocusChangeFilter::Reset() {
+  has_reported_ = false;
+  has_pending_ = false;
+}
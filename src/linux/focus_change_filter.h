@@ -0,0 +1,57 @@
+#ifndef FOCUS_CHANGE_FILTER_H_
+#define FOCUS_CHANGE_FILTER_H_
+
+#include "window_detector.h"
+#include <chrono>
+
+// Turns a stream of detections into focus change events: repeated
+// detections of the same (title, application) pair are dropped, and a new
+// pair is only reported once it has been stable for the debounce period.
+//
+// All times are CLOCK_BOOTTIME, like WindowSnapshot::captured_at_boottime.
+class FocusChangeFilter {
+public:
+  using Time = std::chrono::nanoseconds;
+
+  explicit FocusChangeFilter(std::chrono::milliseconds debounce);
+
+  // Feeds one detection of a window that has had focus since changed_at.
+  void Offer(const WindowInfo &info, Time changed_at);
+
+  // Returns true and fills out when a pending change has been stable for the
+  // debounce period at now. The change then becomes the last reported
+  // window. changed_at, if given, receives the time passed to Offer() for it.
+  bool TakeReady(Time now, WindowInfo *out, Time *changed_at = nullptr);
+
+  // Time left until the pending change is ready, zero if it already is.
+  // Only meaningful while HasPending() is true.
+  std::chrono::milliseconds TimeUntilReady(Time now) const;
+
+  bool HasPending() const { return has_pending_; }
+  bool HasReported() const { return has_reported_; }
+  const WindowInfo &LastReported() const { return reported_; }
+
+  // Records info as reported without going through the debounce period,
+  // e.g. when it was sent to a new subscriber directly.
+  void MarkReported(const WindowInfo &info);
+
+  // Forgets the last reported window, so the next detection is reported
+  // again (e.g. for a new subscriber).
+  void Reset();
+
+  void SetDebounce(std::chrono::milliseconds debounce) { debounce_ = debounce; }
+
+private:
+  static bool SameWindow(const WindowInfo &a, const WindowInfo &b);
+
+  std::chrono::milliseconds debounce_;
+
+  bool has_reported_ = false;
+  WindowInfo reported_;
+
+  bool has_pending_ = false;
+  WindowInfo pending_;
+  Time pending_since_{0};
+};
+
+#endif // FOCUS_CHANGE_FILTER_H_
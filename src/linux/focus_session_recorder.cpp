@@ -0,0 +1,96 @@
+#include "focus_session_recorder.h"
+#include <algorithm>
+
+namespace {
+
+bool IsUnknown(const WindowInfo &info) {
+  return info.title == "unknown" && info.application == "unknown";
+}
+
+} // namespace
+
+FocusSessionRecorder::FocusSessionRecorder(size_t capacity,
+                                           std::chrono::nanoseconds max_gap)
+    : capacity_(capacity), max_gap_(max_gap) {}
+
+void FocusSessionRecorder::Record(const WindowInfo &info,
+                                  std::chrono::nanoseconds now) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  bool in_gap = has_current_ && now - last_seen_ > max_gap_;
+
+  if (has_current_ && !in_gap && info.title == current_.title &&
+      info.application == current_.application) {
+    last_seen_ = now;
+    return;
+  }
+
+  if (has_current_) {
+    // Without a gap the window changed somewhere between the two
+    // detections; attribute that time to the previous one.
+    CloseCurrent(in_gap ? last_seen_ : now);
+  }
+
+  // Failed detections do not start a session.
+  if (IsUnknown(info)) {
+    return;
+  }
+
+  has_current_ = true;
+  current_.application = info.application;
+  current_.title = info.title;
+  current_.start = now;
+  current_.end = now;
+  last_seen_ = now;
+}
+
+void FocusSessionRecorder::RecordIdle(std::chrono::nanoseconds idle_since) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (has_current_) {
+    CloseCurrent(std::max(current_.start, std::min(idle_since, last_seen_)));
+  }
+}
+
+std::vector<FocusSession> FocusSessionRecorder::Drain(bool split_current,
+                                                      size_t *dropped) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (split_current && has_current_ && last_seen_ > current_.start) {
+    FocusSession partial = current_;
+    partial.end = last_seen_;
+    Push(std::move(partial));
+    current_.start = last_seen_;
+  }
+
+  std::vector<FocusSession> sessions(
+      std::make_move_iterator(completed_.begin()),
+      std::make_move_iterator(completed_.end()));
+  completed_.clear();
+  if (dropped) {
+    *dropped = dropped_;
+  }
+  dropped_ = 0;
+  return sessions;
+}
+
+void FocusSessionRecorder::CloseCurrent(std::chrono::nanoseconds end) {
+  has_current_ = false;
+  current_.end = end;
+  // Zero-length sessions carry no time.
+  if (current_.end > current_.start) {
+    Push(std::move(current_));
+  }
+  current_ = FocusSession();
+}
+
+void FocusSessionRecorder::Push(FocusSession session) {
+  if (capacity_ == 0) {
+    dropped_++;
+    return;
+  }
+  if (completed_.size() >= capacity_) {
+    completed_.pop_front();
+    dropped_++;
+  }
+  completed_.push_back(std::move(session));
+}
@@ -0,0 +1,59 @@
+#ifndef FOCUS_SESSION_RECORDER_H_
+#define FOCUS_SESSION_RECORDER_H_
+
+#include "window_detector.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// One continuous stretch of focus on a window. Times are CLOCK_BOOTTIME.
+struct FocusSession {
+  std::string application;
+  std::string title;
+  std::chrono::nanoseconds start{0};
+  std::chrono::nanoseconds end{0};
+};
+
+// Turns detections into completed focus sessions kept in a bounded buffer,
+// so the Dart side can drain them in one call every few minutes instead of
+// counting one-second ticks. Thread-safe.
+class FocusSessionRecorder {
+public:
+  // max_gap: a longer silence between detections (suspend, stalled backend)
+  // ends the session at the last detection instead of spanning the gap.
+  FocusSessionRecorder(size_t capacity, std::chrono::nanoseconds max_gap);
+
+  // Feeds one detection taken at now (CLOCK_BOOTTIME).
+  void Record(const WindowInfo &info, std::chrono::nanoseconds now);
+
+  // The user has been idle since idle_since (CLOCK_BOOTTIME). Ends the open
+  // session there, dropping the detections taken while nobody was there.
+  void RecordIdle(std::chrono::nanoseconds idle_since);
+
+  // Returns and clears the completed sessions, oldest first. With
+  // split_current the open session is also returned up to its last
+  // detection and continues from there, so no time is reported twice.
+  // dropped receives the number of sessions discarded since the previous
+  // drain because the buffer was full.
+  std::vector<FocusSession> Drain(bool split_current,
+                                  size_t *dropped = nullptr);
+
+private:
+  void CloseCurrent(std::chrono::nanoseconds end);
+  void Push(FocusSession session);
+
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  const std::chrono::nanoseconds max_gap_;
+  std::deque<FocusSession> completed_;
+  size_t dropped_ = 0;
+
+  bool has_current_ = false;
+  FocusSession current_;
+  std::chrono::nanoseconds last_seen_{0};
+};
+
+#endif // FOCUS_SESSION_RECORDER_H_
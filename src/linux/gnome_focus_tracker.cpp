@@ -0,0 +1,147 @@
+#include "gnome_focus_tracker.h"
+#include "session_bus.h"
+
+constexpr const char *GnomeFocusTracker::kBusName;
+constexpr const char *GnomeFocusTracker::kObjectPath;
+constexpr const char *GnomeFocusTracker::kInterface;
+
+GnomeFocusTracker::GnomeFocusTracker(GDBusConnection *connection,
+                                     ChangeCallback on_change)
+    : connection_(connection), on_change_(std::move(on_change)),
+      cancellable_(g_cancellable_new()) {
+  if (!connection_) {
+    return;
+  }
+
+  // Matched against the current owner of the name, so signals from a
+  // restarted shell keep arriving
+  subscription_id_ = g_dbus_connection_signal_subscribe(
+      connection_, kBusName, kInterface, "FocusChanged", kObjectPath, nullptr,
+      G_DBUS_SIGNAL_FLAGS_NONE, OnFocusChanged, this, nullptr);
+  watch_id_ = g_bus_watch_name_on_connection(
+      connection_, kBusName, G_BUS_NAME_WATCHER_FLAGS_NONE, OnNameAppeared,
+      OnNameVanished, this, nullptr);
+}
+
+GnomeFocusTracker::~GnomeFocusTracker() {
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  if (connection_) {
+    g_bus_unwatch_name(watch_id_);
+    g_dbus_connection_signal_unsubscribe(connection_, subscription_id_);
+  }
+}
+
+bool GnomeFocusTracker::IsActive() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return active_;
+}
+
+bool GnomeFocusTracker::Current(WindowInfo *info) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!active_ || !has_focus_) {
+    return false;
+  }
+  *info = focus_;
+  return true;
+}
+
+bool GnomeFocusTracker::Activate(const std::string &title) {
+  if (!connection_ || !IsActive()) {
+    return false;
+  }
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_sync(
+      connection_, kBusName, kObjectPath, kInterface, "Activate",
+      g_variant_new("(s)", title.c_str()), G_VARIANT_TYPE("(b)"),
+      G_DBUS_CALL_FLAGS_NONE, kSessionBusCallTimeoutMs, nullptr, &error);
+  if (!reply) {
+    g_clear_error(&error);
+    return false;
+  }
+  gboolean activated = FALSE;
+  g_variant_get(reply, "(b)", &activated);
+  g_variant_unref(reply);
+  return activated;
+}
+
+void GnomeFocusTracker::Update(GVariant *focus) {
+  const gchar *title = nullptr;
+  const gchar *app_id = nullptr;
+  guint32 pid = 0;
+  g_variant_get(focus, "(&s&su)", &title, &app_id, &pid);
+
+  WindowInfo info{"unknown", "unknown"};
+  if (*title) {
+    info.title = WindowDetector::ValidateUtf8(title);
+  }
+  if (*app_id) {
+    info.application = WindowDetector::ValidateUtf8(app_id);
+  }
+  info.pid = static_cast<int>(pid);
+  info.backend = "gnome-extension";
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    focus_ = info;
+    has_focus_ = true;
+  }
+  on_change_();
+}
+
+void GnomeFocusTracker::OnNameAppeared(GDBusConnection *connection,
+                                       const gchar *name,
+                                       const gchar *name_owner,
+                                       gpointer user_data) {
+  GnomeFocusTracker *self = static_cast<GnomeFocusTracker *>(user_data);
+  {
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    self->active_ = true;
+    self->has_focus_ = false;
+  }
+  // Signals only report changes; the current focus has to be asked for
+  g_dbus_connection_call(connection, name_owner, kObjectPath, kInterface,
+                         "GetFocus", nullptr, G_VARIANT_TYPE("(ssu)"),
+                         G_DBUS_CALL_FLAGS_NONE, kSessionBusCallTimeoutMs,
+                         self->cancellable_, OnFocusReady, self);
+}
+
+void GnomeFocusTracker::OnNameVanished(GDBusConnection *connection,
+                                       const gchar *name,
+                                       gpointer user_data) {
+  GnomeFocusTracker *self = static_cast<GnomeFocusTracker *>(user_data);
+  bool was_active;
+  {
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    was_active = self->active_;
+    self->active_ = false;
+    self->has_focus_ = false;
+  }
+  if (was_active) {
+    self->on_change_();
+  }
+}
+
+void GnomeFocusTracker::OnFocusReady(GObject *source, GAsyncResult *result,
+                                     gpointer user_data) {
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                  result, &error);
+  if (!reply) {
+    // Cancelled means the tracker is gone; otherwise the next FocusChanged
+    // fills in the focus
+    g_clear_error(&error);
+    return;
+  }
+  static_cast<GnomeFocusTracker *>(user_data)->Update(reply);
+  g_variant_unref(reply);
+}
+
+void GnomeFocusTracker::OnFocusChanged(
+    GDBusConnection *connection, const gchar *sender_name,
+    const gchar *object_path, const gchar *interface_name,
+    const gchar *signal_name, GVariant *parameters, gpointer user_data) {
+  if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(ssu)"))) {
+    return;
+  }
+  static_cast<GnomeFocusTracker *>(user_data)->Update(parameters);
+}
@@ -0,0 +1,80 @@
+#ifndef GNOME_FOCUS_TRACKER_H_
+#define GNOME_FOCUS_TRACKER_H_
+
+#include "window_detector.h"
+#include <gio/gio.h>
+
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Follows the focused window through the GNOME Shell extension shipped in
+// share/gnome-shell/extensions/whph-focus-tracker@ahmetcetinkaya.me. The
+// extension emits FocusChanged on every focus and title change, so nothing
+// is polled and org.gnome.Shell.Eval, which modern GNOME locks down, is not
+// needed. While the extension is not on the bus Current() returns false and
+// callers fall back to other backends.
+//
+// Construct on the thread whose main context should receive the signals;
+// the other methods may be called from any thread.
+class GnomeFocusTracker {
+public:
+  static constexpr const char *kBusName = "me.ahmetcetinkaya.whph.FocusTracker";
+  static constexpr const char *kObjectPath =
+      "/me/ahmetcetinkaya/whph/FocusTracker";
+  static constexpr const char *kInterface =
+      "me.ahmetcetinkaya.whph.FocusTracker";
+
+  // Called on the constructing thread's main context whenever the reported
+  // focus changes, including when the extension appears or goes away.
+  using ChangeCallback = std::function<void()>;
+
+  // connection is not owned and must outlive the tracker; with nullptr the
+  // tracker never becomes active.
+  GnomeFocusTracker(GDBusConnection *connection, ChangeCallback on_change);
+  ~GnomeFocusTracker();
+
+  GnomeFocusTracker(const GnomeFocusTracker &) = delete;
+  GnomeFocusTracker &operator=(const GnomeFocusTracker &) = delete;
+
+  // True while the extension owns its bus name.
+  bool IsActive() const;
+
+  // The focused window as last reported. False while the extension is not on
+  // the bus or has not answered yet.
+  bool Current(WindowInfo *info) const;
+
+  // Asks the extension to activate the first window whose title contains
+  // title. False if it found none or is not running.
+  bool Activate(const std::string &title);
+
+private:
+  // focus is a (ssu) of title, application ID and PID.
+  void Update(GVariant *focus);
+
+  static void OnNameAppeared(GDBusConnection *connection, const gchar *name,
+                             const gchar *name_owner, gpointer user_data);
+  static void OnNameVanished(GDBusConnection *connection, const gchar *name,
+                             gpointer user_data);
+  static void OnFocusReady(GObject *source, GAsyncResult *result,
+                           gpointer user_data);
+  static void OnFocusChanged(GDBusConnection *connection,
+                             const gchar *sender_name,
+                             const gchar *object_path,
+                             const gchar *interface_name,
+                             const gchar *signal_name, GVariant *parameters,
+                             gpointer user_data);
+
+  GDBusConnection *connection_;
+  ChangeCallback on_change_;
+  guint watch_id_ = 0;
+  guint subscription_id_ = 0;
+  GCancellable *cancellable_;
+
+  mutable std::mutex mutex_;
+  bool active_ = false;
+  bool has_focus_ = false;
+  WindowInfo focus_;
+};
+
+#endif // GNOME_FOCUS_TRACKER_H_
@@ -0,0 +1,213 @@
+#include "gnome_introspect_windows.h"
+#include "session_bus.h"
+
+namespace {
+
+constexpr const char *kShellBusName = "org.gnome.Shell";
+constexpr const char *kIntrospectPath = "/org/gnome/Shell/Introspect";
+constexpr const char *kIntrospectInterface = "org.gnome.Shell.Introspect";
+
+std::string LookupString(GVariant *properties, const char *key) {
+  const gchar *value = nullptr;
+  if (g_variant_lookup(properties, key, "&s", &value)) {
+    return value;
+  }
+  return "";
+}
+
+bool LookupBoolean(GVariant *properties, const char *key) {
+  gboolean value = FALSE;
+  return g_variant_lookup(properties, key, "b", &value) && value;
+}
+
+bool IsPermanentError(const GError *error) {
+  return g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_ACCESS_DENIED) ||
+         g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD) ||
+         g_error_matches(error, G_DBUS_ERROR,
+                         G_DBUS_ERROR_UNKNOWN_INTERFACE) ||
+         g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_OBJECT);
+}
+
+} // namespace
+
+std::vector<ToplevelWindow> ParseIntrospectWindows(GVariant *windows) {
+  std::vector<ToplevelWindow> result;
+  if (!g_variant_is_of_type(windows, G_VARIANT_TYPE("a{ta{sv}}"))) {
+    return result;
+  }
+
+  GVariantIter iter;
+  guint64 id;
+  GVariant *properties = nullptr;
+  g_variant_iter_init(&iter, windows);
+  while (g_variant_iter_loop(&iter, "{t@a{sv}}", &id, &properties)) {
+    ToplevelWindow window;
+    window.title =
+        WindowDetector::ValidateUtf8(LookupString(properties, "title"));
+    std::string application = LookupString(properties, "app-id");
+    if (application.empty()) {
+      application = LookupString(properties, "wm-class");
+    }
+    window.application = WindowDetector::ValidateUtf8(application);
+    window.focused = LookupBoolean(properties, "has-focus");
+    window.minimized = LookupBoolean(properties, "is-hidden");
+    result.push_back(std::move(window));
+  }
+  return result;
+}
+
+GnomeIntrospectWindows::GnomeIntrospectWindows(GDBusConnection *connection,
+                                               ChangeCallback on_change)
+    : connection_(connection), on_change_(std::move(on_change)),
+      cancellable_(g_cancellable_new()) {
+  if (!connection_) {
+    return;
+  }
+
+  // Both of the interface's signals: WindowsChanged and
+  // RunningApplicationsChanged
+  subscription_id_ = g_dbus_connection_signal_subscribe(
+      connection_, kShellBusName, kIntrospectInterface, nullptr,
+      kIntrospectPath, nullptr, G_DBUS_SIGNAL_FLAGS_NONE, OnShellChanged,
+      this, nullptr);
+  watch_id_ = g_bus_watch_name_on_connection(
+      connection_, kShellBusName, G_BUS_NAME_WATCHER_FLAGS_NONE,
+      OnNameAppeared, OnNameVanished, this, nullptr);
+}
+
+GnomeIntrospectWindows::~GnomeIntrospectWindows() {
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  if (connection_) {
+    g_bus_unwatch_name(watch_id_);
+    g_dbus_connection_signal_unsubscribe(connection_, subscription_id_);
+  }
+}
+
+bool GnomeIntrospectWindows::IsActive() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return active_;
+}
+
+bool GnomeIntrospectWindows::Current(WindowInfo *info) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!active_) {
+    return false;
+  }
+  for (const ToplevelWindow &window : windows_) {
+    if (window.focused) {
+      info->title = window.title.empty() ? "unknown" : window.title;
+      info->application =
+          window.application.empty() ? "unknown" : window.application;
+      info->pid = 0;
+      info->backend = "gnome-introspect";
+      return true;
+    }
+  }
+  return false;
+}
+
+std::vector<ToplevelWindow> GnomeIntrospectWindows::Windows() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return active_ ? windows_ : std::vector<ToplevelWindow>();
+}
+
+void GnomeIntrospectWindows::Refresh() {
+  if (!shell_present_ || denied_) {
+    return;
+  }
+  if (refresh_in_flight_) {
+    refresh_queued_ = true;
+    return;
+  }
+  refresh_in_flight_ = true;
+  g_dbus_connection_call(connection_, kShellBusName, kIntrospectPath,
+                         kIntrospectInterface, "GetWindows", nullptr,
+                         G_VARIANT_TYPE("(a{ta{sv}})"),
+                         G_DBUS_CALL_FLAGS_NONE, kSessionBusCallTimeoutMs,
+                         cancellable_, OnWindowsReady, this);
+}
+
+void GnomeIntrospectWindows::OnNameAppeared(GDBusConnection *connection,
+                                            const gchar *name,
+                                            const gchar *name_owner,
+                                            gpointer user_data) {
+  GnomeIntrospectWindows *self =
+      static_cast<GnomeIntrospectWindows *>(user_data);
+  self->shell_present_ = true;
+  self->denied_ = false;
+  self->Refresh();
+}
+
+void GnomeIntrospectWindows::OnNameVanished(GDBusConnection *connection,
+                                            const gchar *name,
+                                            gpointer user_data) {
+  GnomeIntrospectWindows *self =
+      static_cast<GnomeIntrospectWindows *>(user_data);
+  self->shell_present_ = false;
+  self->refresh_queued_ = false;
+  bool was_active;
+  {
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    was_active = self->active_;
+    self->active_ = false;
+    self->windows_.clear();
+  }
+  if (was_active) {
+    self->on_change_();
+  }
+}
+
+void GnomeIntrospectWindows::OnWindowsReady(GObject *source,
+                                            GAsyncResult *result,
+                                            gpointer user_data) {
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                  result, &error);
+  if (!reply) {
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      // The table is gone
+      g_error_free(error);
+      return;
+    }
+    GnomeIntrospectWindows *self =
+        static_cast<GnomeIntrospectWindows *>(user_data);
+    self->refresh_in_flight_ = false;
+    self->refresh_queued_ = false;
+    // Refused, or an old Shell without Introspect; asking again on every
+    // signal would not change that. Other failures are retried on
+    // the next signal.
+    self->denied_ = IsPermanentError(error);
+    g_error_free(error);
+    return;
+  }
+
+  GnomeIntrospectWindows *self =
+      static_cast<GnomeIntrospectWindows *>(user_data);
+  self->refresh_in_flight_ = false;
+  GVariant *windows = g_variant_get_child_value(reply, 0);
+  std::vector<ToplevelWindow> parsed = ParseIntrospectWindows(windows);
+  g_variant_unref(windows);
+  g_variant_unref(reply);
+
+  if (self->shell_present_) {
+    {
+      std::lock_guard<std::mutex> lock(self->mutex_);
+      self->windows_ = std::move(parsed);
+      self->active_ = true;
+    }
+    self->on_change_();
+  }
+
+  if (self->refresh_queued_) {
+    self->refresh_queued_ = false;
+    self->Refresh();
+  }
+}
+
+void GnomeIntrospectWindows::OnShellChanged(
+    GDBusConnection *connection, const gchar *sender_name,
+    const gchar *object_path, const gchar *interface_name,
+    const gchar *signal_name, GVariant *parameters, gpointer user_data) {
+  static_cast<GnomeIntrospectWindows *>(user_data)->Refresh();
+}
@@ -0,0 +1,91 @@
+#ifndef GNOME_INTROSPECT_WINDOWS_H_
+#define GNOME_INTROSPECT_WINDOWS_H_
+
+#include "window_detector.h"
+#include <gio/gio.h>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Windows from an org.gnome.Shell.Introspect.GetWindows reply body, of type
+// a{ta{sv}}, in the order Shell lists them. Application is the app-id,
+// falling back to wm-class. Introspect does not report PIDs.
+std::vector<ToplevelWindow> ParseIntrospectWindows(GVariant *windows);
+
+// GNOME Shell's window list, read once through org.gnome.Shell.Introspect
+// and re-read only when Shell signals a change, so focus queries are
+// answered from memory.
+//
+// WindowsChanged covers windows opening, closing and being renamed, but not
+// focus moving between them. RunningApplicationsChanged, which Shell emits
+// when the focused application changes, re-reads the list for that. Focus
+// moving between two windows of the same application is not signalled at
+// all, so the focused window may lag until the next change of either kind.
+//
+// Shell only answers Introspect for allowed callers (portals, or any caller
+// with unsafe mode or the development-tools setting on). When the call is
+// refused the table stays inactive until Shell restarts.
+//
+// Construct on the thread whose main context should receive the signals;
+// the other methods may be called from any thread.
+class GnomeIntrospectWindows {
+public:
+  // Called on the constructing thread's main context after every refresh,
+  // and when Shell goes away.
+  using ChangeCallback = std::function<void()>;
+
+  // connection is not owned and must outlive the table; with nullptr the
+  // table never becomes active.
+  GnomeIntrospectWindows(GDBusConnection *connection,
+                         ChangeCallback on_change);
+  ~GnomeIntrospectWindows();
+
+  GnomeIntrospectWindows(const GnomeIntrospectWindows &) = delete;
+  GnomeIntrospectWindows &operator=(const GnomeIntrospectWindows &) = delete;
+
+  // True once GetWindows has answered, until Shell goes away.
+  bool IsActive() const;
+
+  // The focused window. False while inactive or when no window has focus.
+  bool Current(WindowInfo *info) const;
+
+  // Every window, empty while inactive.
+  std::vector<ToplevelWindow> Windows() const;
+
+private:
+  // Issues GetWindows, or queues another one if a call is in flight so that
+  // a burst of signals costs at most two calls.
+  void Refresh();
+
+  static void OnNameAppeared(GDBusConnection *connection, const gchar *name,
+                             const gchar *name_owner, gpointer user_data);
+  static void OnNameVanished(GDBusConnection *connection, const gchar *name,
+                             gpointer user_data);
+  static void OnWindowsReady(GObject *source, GAsyncResult *result,
+                             gpointer user_data);
+  static void OnShellChanged(GDBusConnection *connection,
+                             const gchar *sender_name,
+                             const gchar *object_path,
+                             const gchar *interface_name,
+                             const gchar *signal_name, GVariant *parameters,
+                             gpointer user_data);
+
+  GDBusConnection *connection_;
+  ChangeCallback on_change_;
+  guint watch_id_ = 0;
+  guint subscription_id_ = 0;
+  GCancellable *cancellable_;
+
+  // Main thread only.
+  bool shell_present_ = false;
+  bool denied_ = false;
+  bool refresh_in_flight_ = false;
+  bool refresh_queued_ = false;
+
+  mutable std::mutex mutex_;
+  bool active_ = false;
+  std::vector<ToplevelWindow> windows_;
+};
+
+#endif // GNOME_INTROSPECT_WINDOWS_H_
@@ -0,0 +1,227 @@
+#include "idle_monitor.h"
+#include "session_bus.h"
+#include "x11_connection.h"
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+#ifdef HAVE_X11
+#include "x11_library.h"
+#endif
+
+namespace {
+
+constexpr gint kBusCallTimeoutMs = 500;
+
+// Value of a property of the caller's logind session. nullptr on failure.
+GVariant *GetLogindProperty(GDBusConnection *bus, const char *property) {
+  if (!bus) {
+    return nullptr;
+  }
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_sync(
+      bus, "org.freedesktop.login1", "/org/freedesktop/login1/session/auto",
+      "org.freedesktop.DBus.Properties", "Get",
+      g_variant_new("(ss)", "org.freedesktop.login1.Session", property),
+      G_VARIANT_TYPE("(v)"), G_DBUS_CALL_FLAGS_NONE, kBusCallTimeoutMs,
+      nullptr, &error);
+  g_clear_error(&error);
+  if (!reply) {
+    return nullptr;
+  }
+  GVariant *value = nullptr;
+  g_variant_get(reply, "(v)", &value);
+  g_variant_unref(reply);
+  return value;
+}
+
+bool IsX11Session() {
+  const char *wayland_display = getenv("WAYLAND_DISPLAY");
+  const char *xdg_session_type = getenv("XDG_SESSION_TYPE");
+  const char *display = getenv("DISPLAY");
+  if ((wayland_display && *wayland_display) ||
+      (xdg_session_type && strcmp(xdg_session_type, "wayland") == 0)) {
+    return false;
+  }
+  return (display && *display) ||
+         (xdg_session_type && strcmp(xdg_session_type, "x11") == 0);
+}
+
+uint64_t MonotonicNowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 +
+         static_cast<uint64_t>(ts.tv_nsec) / 1000;
+}
+
+} // namespace
+
+const char *IdleSourceName(IdleSource source) {
+  switch (source) {
+  case IdleSource::kXScreenSaver:
+    return "xscreensaver";
+  case IdleSource::kMutter:
+    return "mutter";
+  case IdleSource::kScreenSaver:
+    return "screensaver";
+  case IdleSource::kLogind:
+    return "logind";
+  }
+  return "unknown";
+}
+
+std::vector<IdleSource> PlanIdleSources(bool x11_session) {
+  std::vector<IdleSource> plan;
+  if (x11_session) {
+    plan.push_back(IdleSource::kXScreenSaver);
+  }
+  plan.push_back(IdleSource::kMutter);
+  plan.push_back(IdleSource::kScreenSaver);
+  plan.push_back(IdleSource::kLogind);
+  return plan;
+}
+
+std::chrono::milliseconds LogindIdleTime(bool idle_hint, uint64_t idle_since_us,
+                                         uint64_t now_us) {
+  if (!idle_hint || idle_since_us == 0 || idle_since_us > now_us) {
+    return std::chrono::milliseconds(0);
+  }
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::microseconds(now_us - idle_since_us));
+}
+
+constexpr std::chrono::seconds IdleMonitor::kRetryInterval;
+
+IdleMonitor::IdleMonitor()
+    : plan_(PlanIdleSources(IsX11Session())),
+      x11_(std::make_unique<X11Connection>()) {
+  GError *error = nullptr;
+  system_bus_ = g_bus_get_sync(G_BUS_TYPE_SYSTEM, nullptr, &error);
+  g_clear_error(&error);
+}
+
+IdleMonitor::~IdleMonitor() {
+  if (system_bus_) {
+    g_object_unref(system_bus_);
+  }
+}
+
+bool IdleMonitor::Query(std::chrono::milliseconds *idle) {
+  if (current_ >= 0) {
+    if (QuerySource(plan_[current_], idle)) {
+      return true;
+    }
+    current_ = -1;
+  }
+
+  auto now = std::chrono::steady_clock::now();
+  if (failed_ && now - last_failure_ < kRetryInterval) {
+    return false;
+  }
+  for (size_t i = 0; i < plan_.size(); i++) {
+    if (QuerySource(plan_[i], idle)) {
+      current_ = static_cast<int>(i);
+      failed_ = false;
+      return true;
+    }
+  }
+  failed_ = true;
+  last_failure_ = now;
+  return false;
+}
+
+bool IdleMonitor::QuerySource(IdleSource source,
+                              std::chrono::milliseconds *idle) {
+  switch (source) {
+  case IdleSource::kXScreenSaver:
+    return QueryXScreenSaver(idle);
+  case IdleSource::kMutter:
+    return QueryMutter(idle);
+  case IdleSource::kScreenSaver:
+    return QueryScreenSaver(idle);
+  case IdleSource::kLogind:
+    return QueryLogind(idle);
+  }
+  return false;
+}
+
+bool IdleMonitor::QueryXScreenSaver(std::chrono::milliseconds *idle) {
+#if defined(HAVE_X11) && defined(HAVE_XSS)
+  Display *display = x11_->Get();
+  if (!display || !X11Lib().has_xss) {
+    return false;
+  }
+  const X11Library &x11 = X11Lib();
+  int event_base, error_base;
+  if (!x11.XScreenSaverQueryExtension(display, &event_base, &error_base)) {
+    return false;
+  }
+  XScreenSaverInfo *info = x11.XScreenSaverAllocInfo();
+  if (!info) {
+    return false;
+  }
+  bool ok = x11.XScreenSaverQueryInfo(display, x11_->Root(), info) != 0;
+  if (ok) {
+    *idle = std::chrono::milliseconds(info->idle);
+  }
+  x11.XFree(info);
+  return ok;
+#else
+  return false;
+#endif
+}
+
+bool IdleMonitor::QueryMutter(std::chrono::milliseconds *idle) {
+  GVariant *reply = SessionBusCall("org.gnome.Mutter.IdleMonitor",
+                                   "/org/gnome/Mutter/IdleMonitor/Core",
+                                   "org.gnome.Mutter.IdleMonitor",
+                                   "GetIdletime", nullptr, "(t)");
+  if (!reply) {
+    return false;
+  }
+  guint64 idle_ms = 0;
+  g_variant_get(reply, "(t)", &idle_ms);
+  g_variant_unref(reply);
+  *idle = std::chrono::milliseconds(idle_ms);
+  return true;
+}
+
+bool IdleMonitor::QueryScreenSaver(std::chrono::milliseconds *idle) {
+  // Milliseconds, despite what older documentation says
+  GVariant *reply = SessionBusCall("org.freedesktop.ScreenSaver",
+                                   "/org/freedesktop/ScreenSaver",
+                                   "org.freedesktop.ScreenSaver",
+                                   "GetSessionIdleTime", nullptr, "(u)");
+  if (!reply) {
+    return false;
+  }
+  guint32 idle_ms = 0;
+  g_variant_get(reply, "(u)", &idle_ms);
+  g_variant_unref(reply);
+  *idle = std::chrono::milliseconds(idle_ms);
+  return true;
+}
+
+bool IdleMonitor::QueryLogind(std::chrono::milliseconds *idle) {
+  GVariant *hint = GetLogindProperty(system_bus_, "IdleHint");
+  if (!hint) {
+    return false;
+  }
+  bool idle_hint = g_variant_is_of_type(hint, G_VARIANT_TYPE_BOOLEAN) &&
+                   g_variant_get_boolean(hint);
+  g_variant_unref(hint);
+
+  // The timestamp is only worth a second round trip while idle
+  uint64_t idle_since_us = 0;
+  if (idle_hint) {
+    GVariant *since = GetLogindProperty(system_bus_, "IdleSinceHintMonotonic");
+    if (since) {
+      if (g_variant_is_of_type(since, G_VARIANT_TYPE_UINT64)) {
+        idle_since_us = g_variant_get_uint64(since);
+      }
+      g_variant_unref(since);
+    }
+  }
+  *idle = LogindIdleTime(idle_hint, idle_since_us, MonotonicNowUs());
+  return true;
+}
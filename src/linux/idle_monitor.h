@@ -0,0 +1,74 @@
+#ifndef IDLE_MONITOR_H_
+#define IDLE_MONITOR_H_
+
+#include <gio/gio.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Ways of asking how long the user has been idle.
+enum class IdleSource {
+  // XScreenSaver extension. Only meaningful on X11 sessions: under XWayland
+  // it only sees input that went to X clients.
+  kXScreenSaver,
+  // org.gnome.Mutter.IdleMonitor.GetIdletime.
+  kMutter,
+  // org.freedesktop.ScreenSaver.GetSessionIdleTime (KDE and others).
+  kScreenSaver,
+  // IdleHint of the logind session. Coarse: set by the desktop's own idle
+  // timeout, so it only reports idleness past that.
+  kLogind
+};
+
+const char *IdleSourceName(IdleSource source);
+
+// Ordered list of sources worth trying. x11_session is true on an X11
+// session, false on Wayland.
+std::vector<IdleSource> PlanIdleSources(bool x11_session);
+
+// Idle time from logind's IdleHint and IdleSinceHintMonotonic (CLOCK_MONOTONIC
+// microseconds). Zero while the hint is not set.
+std::chrono::milliseconds LogindIdleTime(bool idle_hint, uint64_t idle_since_us,
+                                         uint64_t now_us);
+
+class X11Connection;
+
+// Time since the user's last input, from the first source in the plan that
+// answers. The source that answered is kept until it fails.
+//
+// Not thread-safe; the sampler queries it from its own thread only.
+class IdleMonitor {
+public:
+  IdleMonitor();
+  ~IdleMonitor();
+
+  IdleMonitor(const IdleMonitor &) = delete;
+  IdleMonitor &operator=(const IdleMonitor &) = delete;
+
+  // False if no source answers; after that the plan is retried at most every
+  // kRetryInterval.
+  bool Query(std::chrono::milliseconds *idle);
+
+  static constexpr std::chrono::seconds kRetryInterval{60};
+
+private:
+  bool QuerySource(IdleSource source, std::chrono::milliseconds *idle);
+  bool QueryXScreenSaver(std::chrono::milliseconds *idle);
+  bool QueryMutter(std::chrono::milliseconds *idle);
+  bool QueryScreenSaver(std::chrono::milliseconds *idle);
+  bool QueryLogind(std::chrono::milliseconds *idle);
+
+  std::vector<IdleSource> plan_;
+  // Index into plan_ of the source that answered last, -1 if none.
+  int current_ = -1;
+  std::chrono::steady_clock::time_point last_failure_;
+  bool failed_ = false;
+
+  GDBusConnection *system_bus_ = nullptr;
+  // Only used with HAVE_X11.
+  std::unique_ptr<X11Connection> x11_;
+};
+
+#endif // IDLE_MONITOR_H_
@@ -0,0 +1,302 @@
+#include "json_value.h"
+#include <glib.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// Deeper documents are rejected rather than risking the stack.
+constexpr int kMaxDepth = 256;
+
+const JsonValue &NullValue() {
+  static const JsonValue null_value;
+  return null_value;
+}
+
+void AppendUtf8(uint32_t code_point, std::string *out) {
+  if (code_point < 0x80) {
+    *out += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    *out += static_cast<char>(0xC0 | (code_point >> 6));
+    *out += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    *out += static_cast<char>(0xE0 | (code_point >> 12));
+    *out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    *out += static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    *out += static_cast<char>(0xF0 | (code_point >> 18));
+    *out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    *out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    *out += static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+}
+
+} // namespace
+
+class JsonValue::Parser {
+public:
+  explicit Parser(const std::string &text) : text_(text) {}
+
+  bool ParseDocument(JsonValue *value) {
+    if (!ParseValue(value, 0)) {
+      return false;
+    }
+    SkipSpace();
+    return pos_ == text_.size();
+  }
+
+private:
+  void SkipSpace() {
+    while (pos_ < text_.size() &&
+           isspace(static_cast<unsigned char>(text_[pos_]))) {
+      pos_++;
+    }
+  }
+
+  bool Consume(const char *literal) {
+    size_t length = strlen(literal);
+    if (text_.compare(pos_, length, literal) != 0) {
+      return false;
+    }
+    pos_ += length;
+    return true;
+  }
+
+  bool ParseValue(JsonValue *value, int depth) {
+    if (depth > kMaxDepth) {
+      return false;
+    }
+    SkipSpace();
+    if (pos_ == text_.size()) {
+      return false;
+    }
+    switch (text_[pos_]) {
+    case '{':
+      return ParseObject(value, depth);
+    case '[':
+      return ParseArray(value, depth);
+    case '"':
+      value->type_ = Type::kString;
+      return ParseString(&value->string_);
+    case 't':
+      value->type_ = Type::kBool;
+      value->bool_ = true;
+      return Consume("true");
+    case 'f':
+      value->type_ = Type::kBool;
+      value->bool_ = false;
+      return Consume("false");
+    case 'n':
+      value->type_ = Type::kNull;
+      return Consume("null");
+    default:
+      return ParseNumber(value);
+    }
+  }
+
+  bool ParseObject(JsonValue *value, int depth) {
+    value->type_ = Type::kObject;
+    pos_++;
+    SkipSpace();
+    if (pos_ < text_.size() && text_[pos_] == '}') {
+      pos_++;
+      return true;
+    }
+    while (true) {
+      SkipSpace();
+      std::string key;
+      if (pos_ == text_.size() || text_[pos_] != '"' || !ParseString(&key)) {
+        return false;
+      }
+      SkipSpace();
+      if (pos_ == text_.size() || text_[pos_++] != ':') {
+        return false;
+      }
+      value->members_.emplace_back(std::move(key), JsonValue());
+      if (!ParseValue(&value->members_.back().second, depth + 1)) {
+        return false;
+      }
+      SkipSpace();
+      if (pos_ == text_.size()) {
+        return false;
+      }
+      char next = text_[pos_++];
+      if (next == '}') {
+        return true;
+      }
+      if (next != ',') {
+        return false;
+      }
+    }
+  }
+
+  bool ParseArray(JsonValue *value, int depth) {
+    value->type_ = Type::kArray;
+    pos_++;
+    SkipSpace();
+    if (pos_ < text_.size() && text_[pos_] == ']') {
+      pos_++;
+      return true;
+    }
+    while (true) {
+      value->items_.emplace_back();
+      if (!ParseValue(&value->items_.back(), depth + 1)) {
+        return false;
+      }
+      SkipSpace();
+      if (pos_ == text_.size()) {
+        return false;
+      }
+      char next = text_[pos_++];
+      if (next == ']') {
+        return true;
+      }
+      if (next != ',') {
+        return false;
+      }
+    }
+  }
+
+  bool ParseNumber(JsonValue *value) {
+    // strtod would also take "nan", "0x1f" and a locale's decimal comma
+    char first = text_[pos_];
+    if (first != '-' && !isdigit(static_cast<unsigned char>(first))) {
+      return false;
+    }
+    const char *start = text_.c_str() + pos_;
+    char *end = nullptr;
+    double number = g_ascii_strtod(start, &end);
+    if (end == start) {
+      return false;
+    }
+    value->type_ = Type::kNumber;
+    value->number_ = number;
+    pos_ += end - start;
+    return true;
+  }
+
+  // Four hex digits at pos_, which is advanced past them.
+  bool ParseHex4(uint32_t *value) {
+    if (pos_ + 4 > text_.size()) {
+      return false;
+    }
+    *value = 0;
+    for (size_t end = pos_ + 4; pos_ < end; pos_++) {
+      char c = text_[pos_];
+      int digit = c >= '0' && c <= '9'   ? c - '0'
+                  : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                  : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                                         : -1;
+      if (digit < 0) {
+        return false;
+      }
+      *value = *value * 16 + digit;
+    }
+    return true;
+  }
+
+  // Decodes the string whose opening quote is at pos_. Unpaired surrogates
+  // become U+FFFD.
+  bool ParseString(std::string *out) {
+    pos_++;
+    while (pos_ < text_.size() && text_[pos_] != '"') {
+      if (text_[pos_] != '\\') {
+        *out += text_[pos_++];
+        continue;
+      }
+      if (++pos_ == text_.size()) {
+        return false;
+      }
+      char escape = text_[pos_++];
+      switch (escape) {
+      case 'b':
+        *out += '\b';
+        break;
+      case 'f':
+        *out += '\f';
+        break;
+      case 'n':
+        *out += '\n';
+        break;
+      case 'r':
+        *out += '\r';
+        break;
+      case 't':
+        *out += '\t';
+        break;
+      case 'u': {
+        uint32_t unit;
+        if (!ParseHex4(&unit)) {
+          return false;
+        }
+        if (unit >= 0xD800 && unit < 0xDC00 &&
+            text_.compare(pos_, 2, "\\u") == 0) {
+          size_t low_start = pos_;
+          pos_ += 2;
+          uint32_t low;
+          if (ParseHex4(&low) && low >= 0xDC00 && low < 0xE000) {
+            unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+          } else {
+            pos_ = low_start;
+            unit = 0xFFFD;
+          }
+        } else if (unit >= 0xD800 && unit < 0xE000) {
+          unit = 0xFFFD;
+        }
+        AppendUtf8(unit, out);
+        break;
+      }
+      default:
+        // \", \\ and \/
+        *out += escape;
+        break;
+      }
+    }
+    if (pos_ == text_.size()) {
+      return false;
+    }
+    pos_++;
+    return true;
+  }
+
+  const std::string &text_;
+  size_t pos_ = 0;
+};
+
+bool JsonValue::Parse(const std::string &text, JsonValue *value) {
+  JsonValue parsed;
+  if (!Parser(text).ParseDocument(&parsed)) {
+    *value = JsonValue();
+    return false;
+  }
+  *value = std::move(parsed);
+  return true;
+}
+
+bool JsonValue::AsBool(bool fallback) const {
+  return type_ == Type::kBool ? bool_ : fallback;
+}
+
+double JsonValue::AsNumber(double fallback) const {
+  return type_ == Type::kNumber ? number_ : fallback;
+}
+
+std::string JsonValue::AsString(const std::string &fallback) const {
+  return type_ == Type::kString ? string_ : fallback;
+}
+
+const std::vector<JsonValue> &JsonValue::Items() const {
+  static const std::vector<JsonValue> empty;
+  return type_ == Type::kArray ? items_ : empty;
+}
+
+const JsonValue &JsonValue::Get(const std::string &key) const {
+  for (const auto &member : members_) {
+    if (member.first == key) {
+      return member.second;
+    }
+  }
+  return NullValue();
+}
@@ -0,0 +1,48 @@
+#ifndef JSON_VALUE_H_
+#define JSON_VALUE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A parsed JSON document, with just enough API for compositor replies
+// (GNOME Shell Eval results, sway IPC). Numbers are kept as doubles, which
+// holds every container ID and PID exactly.
+class JsonValue {
+public:
+  enum class Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  // Parses text, which must hold exactly one value. False on malformed or
+  // too deeply nested input, leaving *value null.
+  static bool Parse(const std::string &text, JsonValue *value);
+
+  Type type() const { return type_; }
+  bool IsNull() const { return type_ == Type::kNull; }
+  bool IsObject() const { return type_ == Type::kObject; }
+  bool IsArray() const { return type_ == Type::kArray; }
+
+  // The value, or the fallback if it has another type.
+  bool AsBool(bool fallback = false) const;
+  double AsNumber(double fallback = 0) const;
+  std::string AsString(const std::string &fallback = "") const;
+
+  // Elements of an array; empty for other types.
+  const std::vector<JsonValue> &Items() const;
+
+  // The member named key of an object; a null value if there is none or this
+  // is not an object.
+  const JsonValue &Get(const std::string &key) const;
+
+private:
+  class Parser;
+
+  Type type_ = Type::kNull;
+  bool bool_ = false;
+  double number_ = 0;
+  std::string string_;
+  std::vector<JsonValue> items_;
+  std::vector<std::pair<std::string, JsonValue>> members_;
+};
+
+#endif // JSON_VALUE_H_
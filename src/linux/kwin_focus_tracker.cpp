@@ -0,0 +1,350 @@
+#include "kwin_focus_tracker.h"
+#include "session_bus.h"
+#include "window_utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+constexpr const char *kKwinBusName = "org.kde.KWin";
+constexpr const char *kKwinScriptingInterface = "org.kde.kwin.Scripting";
+
+const char *kInterfaceXml =
+    "<node>"
+    "  <interface name='me.ahmetcetinkaya.whph.KWin'>"
+    "    <method name='FocusChanged'>"
+    "      <arg type='s' name='caption' direction='in'/>"
+    "      <arg type='s' name='resource_class' direction='in'/>"
+    "      <arg type='s' name='pid' direction='in'/>"
+    "    </method>"
+    "    <method name='TakeFocusRequest'>"
+    "      <arg type='s' name='title' direction='out'/>"
+    "    </method>"
+    "    <method name='FocusRequestDone'>"
+    "      <arg type='b' name='activated' direction='in'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+} // namespace
+
+constexpr const char *KwinFocusTracker::kObjectPath;
+constexpr const char *KwinFocusTracker::kInterface;
+constexpr const char *KwinFocusTracker::kPluginName;
+constexpr const char *KwinFocusTracker::kFocusShortcut;
+constexpr std::chrono::milliseconds KwinFocusTracker::kFocusRequestTimeout;
+
+std::string KwinFocusTrackerScript(const std::string &service) {
+  // Plasma 6 names first, Plasma 5 ones as fallback. The PID is sent as a
+  // string: callDBus picks the D-Bus type from the JS value.
+  return "var service = " + JsString(service) + ";\n"
+         "var path = " + JsString(KwinFocusTracker::kObjectPath) + ";\n"
+         "var iface = " + JsString(KwinFocusTracker::kInterface) + ";\n"
+         "var watched = null;\n"
+         "function report(w) {\n"
+         "  callDBus(service, path, iface, 'FocusChanged',\n"
+         "           w ? String(w.caption) : '',\n"
+         "           w ? String(w.resourceClass) : '',\n"
+         "           w ? String(w.pid) : '0');\n"
+         "}\n"
+         "function onCaptionChanged() { report(watched); }\n"
+         "function onActivated(w) {\n"
+         "  if (watched) watched.captionChanged.disconnect(onCaptionChanged);\n"
+         "  watched = w;\n"
+         "  if (w) w.captionChanged.connect(onCaptionChanged);\n"
+         "  report(w);\n"
+         "}\n"
+         "function windows() {\n"
+         "  return workspace.windowList ? workspace.windowList()\n"
+         "                              : workspace.clientList();\n"
+         "}\n"
+         "function activate(w) {\n"
+         "  if (workspace.windowList) workspace.activeWindow = w;\n"
+         "  else workspace.activeClient = w;\n"
+         "}\n"
+         "(workspace.windowActivated || workspace.clientActivated)\n"
+         "    .connect(onActivated);\n"
+         "onActivated(workspace.windowList ? workspace.activeWindow\n"
+         "                                 : workspace.activeClient);\n"
+         "registerShortcut(" + JsString(KwinFocusTracker::kFocusShortcut) +
+         ", 'WHPH: focus the requested window', '', function () {\n"
+         "  callDBus(service, path, iface, 'TakeFocusRequest',\n"
+         "           function (title) {\n"
+         "    // Empty when nobody asked, e.g. the user bound a key to it\n"
+         "    if (!title) return;\n"
+         "    var list = windows();\n"
+         "    var target = null;\n"
+         "    for (var i = 0; i < list.length && !target; i++) {\n"
+         "      if (String(list[i].caption).indexOf(title) !== -1)\n"
+         "        target = list[i];\n"
+         "    }\n"
+         "    for (var j = 0; j < list.length && !target; j++) {\n"
+         "      if (String(list[j].resourceClass).indexOf('whph') !== -1)\n"
+         "        target = list[j];\n"
+         "    }\n"
+         "    if (target) activate(target);\n"
+         "    callDBus(service, path, iface, 'FocusRequestDone',\n"
+         "             target !== null);\n"
+         "  });\n"
+         "});\n";
+}
+
+KwinFocusTracker::KwinFocusTracker(GDBusConnection *connection,
+                                   ChangeCallback on_change)
+    : connection_(connection), on_change_(std::move(on_change)),
+      cancellable_(g_cancellable_new()) {
+  if (!connection_) {
+    return;
+  }
+
+  static const GDBusInterfaceVTable vtable = {OnMethodCall, nullptr, nullptr,
+                                              {}};
+  GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(kInterfaceXml, nullptr);
+  object_id_ = g_dbus_connection_register_object(
+      connection_, kObjectPath, node->interfaces[0], &vtable, this, nullptr,
+      nullptr);
+  g_dbus_node_info_unref(node);
+  if (object_id_ == 0) {
+    return;
+  }
+
+  watch_id_ = g_bus_watch_name_on_connection(
+      connection_, kKwinBusName, G_BUS_NAME_WATCHER_FLAGS_NONE,
+      OnNameAppeared, OnNameVanished, this, nullptr);
+}
+
+KwinFocusTracker::~KwinFocusTracker() {
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  if (watch_id_ != 0) {
+    g_bus_unwatch_name(watch_id_);
+    // Otherwise the script keeps calling a name that no longer exists
+    g_dbus_connection_call(connection_, kKwinBusName, "/Scripting",
+                           kKwinScriptingInterface, "unloadScript",
+                           g_variant_new("(s)", kPluginName), nullptr,
+                           G_DBUS_CALL_FLAGS_NONE, -1, nullptr, nullptr,
+                           nullptr);
+  }
+  if (object_id_ != 0) {
+    g_dbus_connection_unregister_object(connection_, object_id_);
+  }
+  if (!script_path_.empty()) {
+    std::remove(script_path_.c_str());
+  }
+}
+
+bool KwinFocusTracker::IsActive() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return active_;
+}
+
+bool KwinFocusTracker::Current(WindowInfo *info) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!active_) {
+    return false;
+  }
+  *info = focus_;
+  return true;
+}
+
+bool KwinFocusTracker::Activate(const std::string &title) {
+  if (title.empty()) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!active_) {
+      return false;
+    }
+    request_pending_ = true;
+    request_title_ = title;
+    request_done_ = false;
+  }
+
+  GVariant *reply = SessionBusCall(
+      "org.kde.kglobalaccel", "/component/kwin",
+      "org.kde.kglobalaccel.Component", "invokeShortcut",
+      g_variant_new("(s)", kFocusShortcut), "()");
+  bool invoked = reply != nullptr;
+  if (reply) {
+    g_variant_unref(reply);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  bool done = invoked && request_cv_.wait_for(lock, kFocusRequestTimeout,
+                                              [this] { return request_done_; });
+  request_pending_ = false;
+  return done && request_result_;
+}
+
+void KwinFocusTracker::LoadScript() {
+  if (script_path_.empty()) {
+    script_path_ = KwinScriptPath("whph_focus_tracker.js");
+  }
+  if (!WriteKwinScript(script_path_, KwinFocusTrackerScript(
+                                         g_dbus_connection_get_unique_name(
+                                             connection_)))) {
+    return;
+  }
+
+  // A runner that died without unloading leaves its script behind
+  g_dbus_connection_call(connection_, kKwinBusName, "/Scripting",
+                         kKwinScriptingInterface, "unloadScript",
+                         g_variant_new("(s)", kPluginName),
+                         G_VARIANT_TYPE("(b)"), G_DBUS_CALL_FLAGS_NONE,
+                         kSessionBusCallTimeoutMs, cancellable_, OnUnloaded,
+                         this);
+}
+
+void KwinFocusTracker::OnNameAppeared(GDBusConnection *connection,
+                                      const gchar *name,
+                                      const gchar *name_owner,
+                                      gpointer user_data) {
+  KwinFocusTracker *self = static_cast<KwinFocusTracker *>(user_data);
+  self->kwin_owner_ = name_owner;
+  self->LoadScript();
+}
+
+void KwinFocusTracker::OnNameVanished(GDBusConnection *connection,
+                                      const gchar *name, gpointer user_data) {
+  KwinFocusTracker *self = static_cast<KwinFocusTracker *>(user_data);
+  self->kwin_owner_.clear();
+  bool was_active;
+  {
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    was_active = self->active_;
+    self->active_ = false;
+  }
+  if (was_active) {
+    self->on_change_();
+  }
+}
+
+void KwinFocusTracker::OnUnloaded(GObject *source, GAsyncResult *result,
+                                  gpointer user_data) {
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                  result, &error);
+  if (!reply) {
+    bool cancelled = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_error_free(error);
+    if (cancelled) {
+      return;
+    }
+  } else {
+    g_variant_unref(reply);
+  }
+
+  // Whether or not anything was unloaded
+  KwinFocusTracker *self = static_cast<KwinFocusTracker *>(user_data);
+  g_dbus_connection_call(
+      self->connection_, kKwinBusName, "/Scripting", kKwinScriptingInterface,
+      "loadScript",
+      g_variant_new("(ss)", self->script_path_.c_str(), kPluginName),
+      G_VARIANT_TYPE("(i)"), G_DBUS_CALL_FLAGS_NONE, kSessionBusCallTimeoutMs,
+      self->cancellable_, OnLoaded, self);
+}
+
+void KwinFocusTracker::OnLoaded(GObject *source, GAsyncResult *result,
+                                gpointer user_data) {
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                  result, &error);
+  if (!reply) {
+    // The journal and supportInformation backends remain
+    g_error_free(error);
+    return;
+  }
+  g_variant_unref(reply);
+
+  KwinFocusTracker *self = static_cast<KwinFocusTracker *>(user_data);
+  g_dbus_connection_call(self->connection_, kKwinBusName, "/Scripting",
+                         kKwinScriptingInterface, "start", nullptr, nullptr,
+                         G_DBUS_CALL_FLAGS_NONE, kSessionBusCallTimeoutMs,
+                         self->cancellable_, OnStarted, self);
+}
+
+void KwinFocusTracker::OnStarted(GObject *source, GAsyncResult *result,
+                                 gpointer user_data) {
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                  result, &error);
+  if (!reply) {
+    g_error_free(error);
+    return;
+  }
+  g_variant_unref(reply);
+  // The script's first report marks the tracker active
+}
+
+void KwinFocusTracker::OnMethodCall(GDBusConnection *connection,
+                                    const gchar *sender,
+                                    const gchar *object_path,
+                                    const gchar *interface_name,
+                                    const gchar *method_name,
+                                    GVariant *parameters,
+                                    GDBusMethodInvocation *invocation,
+                                    gpointer user_data) {
+  KwinFocusTracker *self = static_cast<KwinFocusTracker *>(user_data);
+
+  // Any client on the session bus could otherwise report a focus or take a
+  // pending request; only the script, which runs inside KWin, may
+  if (self->kwin_owner_.empty() ||
+      g_strcmp0(sender, self->kwin_owner_.c_str()) != 0) {
+    g_dbus_method_invocation_return_error_literal(
+        invocation, G_DBUS_ERROR, G_DBUS_ERROR_ACCESS_DENIED,
+        "Only KWin may call this object");
+    return;
+  }
+
+  if (g_strcmp0(method_name, "FocusChanged") == 0) {
+    const gchar *caption = nullptr;
+    const gchar *resource_class = nullptr;
+    const gchar *pid = nullptr;
+    g_variant_get(parameters, "(&s&s&s)", &caption, &resource_class, &pid);
+
+    WindowInfo info{"unknown", "unknown"};
+    if (*caption) {
+      info.title = WindowDetector::ValidateUtf8(caption);
+    }
+    if (*resource_class) {
+      info.application = WindowDetector::ValidateUtf8(resource_class);
+    }
+    info.pid = std::max(0, atoi(pid));
+    info.backend = "kwin-tracker";
+    {
+      std::lock_guard<std::mutex> lock(self->mutex_);
+      self->focus_ = info;
+      self->active_ = true;
+    }
+    g_dbus_method_invocation_return_value(invocation, nullptr);
+    self->on_change_();
+  } else if (g_strcmp0(method_name, "TakeFocusRequest") == 0) {
+    std::string title;
+    {
+      std::lock_guard<std::mutex> lock(self->mutex_);
+      if (self->request_pending_) {
+        title = self->request_title_;
+      }
+    }
+    g_dbus_method_invocation_return_value(
+        invocation, g_variant_new("(s)", title.c_str()));
+  } else if (g_strcmp0(method_name, "FocusRequestDone") == 0) {
+    gboolean activated = FALSE;
+    g_variant_get(parameters, "(b)", &activated);
+    {
+      std::lock_guard<std::mutex> lock(self->mutex_);
+      if (self->request_pending_) {
+        self->request_done_ = true;
+        self->request_result_ = activated;
+      }
+    }
+    self->request_cv_.notify_all();
+    g_dbus_method_invocation_return_value(invocation, nullptr);
+  } else {
+    g_dbus_method_invocation_return_error(
+        invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+        "No such method %s", method_name);
+  }
+}
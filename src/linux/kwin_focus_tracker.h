@@ -0,0 +1,106 @@
+#ifndef KWIN_FOCUS_TRACKER_H_
+#define KWIN_FOCUS_TRACKER_H_
+
+#include "window_detector.h"
+#include <gio/gio.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// The KWin script loaded by KwinFocusTracker. It reports the active window
+// and its caption changes to the object at service/kObjectPath through
+// callDBus. It also handles focus requests when the shortcut
+// KwinFocusTracker::kFocusShortcut is invoked.
+std::string KwinFocusTrackerScript(const std::string &service);
+
+// Follows the active window on KWin Wayland through a script that is loaded
+// once per KWin session. The script calls back into an object this class
+// exports on the session bus whenever workspace.windowActivated or the
+// active window's captionChanged fires, so nothing is polled and nothing
+// is spawned. Calls from any peer other than KWin are refused.
+//
+// Scripts cannot receive D-Bus calls, so focus requests go the other way:
+// Activate() invokes a global shortcut that the script registered, and the
+// script then fetches the request and reports the result with callDBus.
+//
+// Construct on the thread whose main context should serve the exported
+// object; the other methods may be called from any thread except that one.
+class KwinFocusTracker {
+public:
+  static constexpr const char *kObjectPath = "/me/ahmetcetinkaya/whph/KWin";
+  static constexpr const char *kInterface = "me.ahmetcetinkaya.whph.KWin";
+  static constexpr const char *kPluginName = "whph_focus_tracker";
+  static constexpr const char *kFocusShortcut = "WHPH Focus Request";
+  // How long Activate() waits for the script to act on a request.
+  static constexpr std::chrono::milliseconds kFocusRequestTimeout{1000};
+
+  // Called on the constructing thread's main context whenever the script
+  // reports a change, and when KWin goes away.
+  using ChangeCallback = std::function<void()>;
+
+  // connection is not owned and must outlive the tracker; with nullptr the
+  // tracker never becomes active.
+  KwinFocusTracker(GDBusConnection *connection, ChangeCallback on_change);
+  ~KwinFocusTracker();
+
+  KwinFocusTracker(const KwinFocusTracker &) = delete;
+  KwinFocusTracker &operator=(const KwinFocusTracker &) = delete;
+
+  // True once the script has reported, until KWin goes away.
+  bool IsActive() const;
+
+  // The active window as last reported. False while inactive.
+  bool Current(WindowInfo *info) const;
+
+  // Asks the script to activate the first window whose caption contains
+  // title, falling back to WHPH's own window. Blocks for up to
+  // kFocusRequestTimeout. False for an empty title.
+  bool Activate(const std::string &title);
+
+private:
+  void LoadScript();
+
+  static void OnNameAppeared(GDBusConnection *connection, const gchar *name,
+                             const gchar *name_owner, gpointer user_data);
+  static void OnNameVanished(GDBusConnection *connection, const gchar *name,
+                             gpointer user_data);
+  static void OnUnloaded(GObject *source, GAsyncResult *result,
+                         gpointer user_data);
+  static void OnLoaded(GObject *source, GAsyncResult *result,
+                       gpointer user_data);
+  static void OnStarted(GObject *source, GAsyncResult *result,
+                        gpointer user_data);
+  static void OnMethodCall(GDBusConnection *connection, const gchar *sender,
+                           const gchar *object_path,
+                           const gchar *interface_name,
+                           const gchar *method_name, GVariant *parameters,
+                           GDBusMethodInvocation *invocation,
+                           gpointer user_data);
+
+  GDBusConnection *connection_;
+  ChangeCallback on_change_;
+  guint object_id_ = 0;
+  guint watch_id_ = 0;
+  GCancellable *cancellable_;
+  // Main thread only.
+  std::string script_path_;
+  // KWin's unique bus name, the only peer whose calls are served; empty
+  // while KWin is away.
+  std::string kwin_owner_;
+
+  mutable std::mutex mutex_;
+  bool active_ = false;
+  WindowInfo focus_;
+  // The title of the focus request the script has not fetched yet.
+  bool request_pending_ = false;
+  std::string request_title_;
+  // Set by the script once it has handled the request.
+  bool request_done_ = false;
+  bool request_result_ = false;
+  std::condition_variable request_cv_;
+};
+
+#endif // KWIN_FOCUS_TRACKER_H_
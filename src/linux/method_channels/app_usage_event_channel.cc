@@ -0,0 +1,222 @@
+#include "app_usage_event_channel.h"
+#include "../app_constants.h"
+
+namespace {
+
+constexpr std::chrono::milliseconds kDefaultDebounce(500);
+constexpr std::chrono::seconds kDefaultHeartbeat(60);
+
+struct SnapshotDelivery {
+  std::weak_ptr<FocusEventStream> stream;
+  std::shared_ptr<const WindowSnapshot> snapshot;
+};
+
+gboolean deliver_snapshot(gpointer user_data) {
+  SnapshotDelivery* delivery = static_cast<SnapshotDelivery*>(user_data);
+  std::shared_ptr<FocusEventStream> stream = delivery->stream.lock();
+  if (stream) {
+    stream->Push(delivery->snapshot);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+void snapshot_delivery_free(gpointer user_data) {
+  delete static_cast<SnapshotDelivery*>(user_data);
+}
+
+int64_t lookup_int(FlValue* args, const gchar* key, int64_t fallback) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return fallback;
+  }
+  FlValue* value = fl_value_lookup_string(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_INT) {
+    return fallback;
+  }
+  return fl_value_get_int(value);
+}
+
+}  // namespace
+
+void app_usage_set_clock_mapping(FlValue* map) {
+  fl_value_set_string_take(
+      map, "nowBoottimeMs",
+      fl_value_new_int(std::chrono::duration_cast<std::chrono::milliseconds>(
+                           BootTimeNow())
+                           .count()));
+  fl_value_set_string_take(map, "nowEpochMs",
+                           fl_value_new_int(g_get_real_time() / 1000));
+}
+
+FocusEventStream::FocusEventStream()
+    : filter_(kDefaultDebounce), heartbeat_interval_(kDefaultHeartbeat) {}
+
+FocusEventStream::~FocusEventStream() {
+  StopTimers();
+  if (channel_ != nullptr) {
+    fl_event_channel_set_stream_handlers(channel_, nullptr, nullptr, nullptr,
+                                         nullptr);
+    g_object_unref(channel_);
+  }
+}
+
+void FocusEventStream::Attach(FlBinaryMessenger* messenger) {
+  if (channel_ != nullptr) {
+    return;
+  }
+
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  channel_ = fl_event_channel_new(messenger, APP_USAGE_FOCUS_EVENTS_CHANNEL,
+                                  FL_METHOD_CODEC(codec));
+  fl_event_channel_set_stream_handlers(channel_, OnListen, OnCancel, this,
+                                       nullptr);
+}
+
+void FocusEventStream::PushFromAnyThread(
+    std::weak_ptr<FocusEventStream> stream,
+    std::shared_ptr<const WindowSnapshot> snapshot) {
+  g_main_context_invoke_full(
+      nullptr, G_PRIORITY_DEFAULT, deliver_snapshot,
+      new SnapshotDelivery{std::move(stream), std::move(snapshot)},
+      snapshot_delivery_free);
+}
+
+void FocusEventStream::Push(std::shared_ptr<const WindowSnapshot> snapshot) {
+  latest_ = std::move(snapshot);
+  if (!listening_) {
+    return;
+  }
+
+  // Idle boundaries skip the debounce, and nothing pending or reported
+  // carries over them; without a reported window the heartbeat stays quiet.
+  if (latest_->idle) {
+    if (debounce_source_ != 0) {
+      g_source_remove(debounce_source_);
+      debounce_source_ = 0;
+    }
+    filter_.Reset();
+    Send(latest_->info, latest_->captured_at_boottime, false, true);
+    return;
+  }
+
+  filter_.Offer(latest_->info, latest_->captured_at_boottime);
+  Flush();
+}
+
+void FocusEventStream::Flush() {
+  WindowInfo info;
+  FocusChangeFilter::Time changed_at(0);
+  if (filter_.TakeReady(BootTimeNow(), &info, &changed_at)) {
+    Send(info, changed_at, false);
+    return;
+  }
+
+  // Check again once the pending change has been stable long enough.
+  if (filter_.HasPending() && debounce_source_ == 0) {
+    auto delay = filter_.TimeUntilReady(BootTimeNow());
+    debounce_source_ = g_timeout_add(static_cast<guint>(delay.count()),
+                                     OnDebounceTimeout, this);
+  }
+}
+
+void FocusEventStream::Send(const WindowInfo& info,
+                            std::chrono::nanoseconds timestamp, bool heartbeat,
+                            bool idle) {
+  if (channel_ == nullptr) {
+    return;
+  }
+
+  int64_t timestamp_ms =
+      std::chrono::duration_cast<std::chrono::milliseconds>(timestamp).count();
+
+  g_autoptr(FlValue) event = fl_value_new_map();
+  fl_value_set_string_take(event, "title",
+                           fl_value_new_string(info.title.c_str()));
+  fl_value_set_string_take(event, "application",
+                           fl_value_new_string(info.application.c_str()));
+  fl_value_set_string_take(event, "pid", fl_value_new_int(info.pid));
+  fl_value_set_string_take(event, "backend",
+                           fl_value_new_string(info.backend.c_str()));
+  fl_value_set_string_take(event, "timestampMs",
+                           fl_value_new_int(timestamp_ms));
+  fl_value_set_string_take(event, "heartbeat", fl_value_new_bool(heartbeat));
+  fl_value_set_string_take(event, "idle", fl_value_new_bool(idle));
+  app_usage_set_clock_mapping(event);
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_event_channel_send(channel_, event, nullptr, &error)) {
+    g_warning("Failed to send focus event: %s", error->message);
+  }
+}
+
+void FocusEventStream::StopTimers() {
+  if (debounce_source_ != 0) {
+    g_source_remove(debounce_source_);
+    debounce_source_ = 0;
+  }
+  if (heartbeat_source_ != 0) {
+    g_source_remove(heartbeat_source_);
+    heartbeat_source_ = 0;
+  }
+}
+
+FlMethodErrorResponse* FocusEventStream::OnListen(FlEventChannel* channel,
+                                                  FlValue* args,
+                                                  gpointer user_data) {
+  FocusEventStream* self = static_cast<FocusEventStream*>(user_data);
+
+  int64_t debounce_ms = lookup_int(args, "debounceMs", kDefaultDebounce.count());
+  int64_t heartbeat_seconds =
+      lookup_int(args, "heartbeatSeconds", kDefaultHeartbeat.count());
+
+  self->StopTimers();
+  self->filter_.SetDebounce(
+      std::chrono::milliseconds(debounce_ms > 0 ? debounce_ms : 0));
+  self->filter_.Reset();
+  self->heartbeat_interval_ =
+      std::chrono::seconds(heartbeat_seconds > 0 ? heartbeat_seconds : 0);
+  self->listening_ = true;
+
+  // A new subscriber gets the current window (or idle state) right away.
+  if (self->latest_ && self->latest_->idle) {
+    self->Send(self->latest_->info, self->latest_->captured_at_boottime, false,
+               true);
+  } else if (self->latest_) {
+    self->Send(self->latest_->info, self->latest_->captured_at_boottime,
+               false);
+    self->filter_.MarkReported(self->latest_->info);
+  }
+
+  // A heartbeat of zero disables it.
+  if (self->heartbeat_interval_.count() > 0) {
+    self->heartbeat_source_ = g_timeout_add_seconds(
+        static_cast<guint>(self->heartbeat_interval_.count()), OnHeartbeat,
+        self);
+  }
+
+  return nullptr;
+}
+
+FlMethodErrorResponse* FocusEventStream::OnCancel(FlEventChannel* channel,
+                                                  FlValue* args,
+                                                  gpointer user_data) {
+  FocusEventStream* self = static_cast<FocusEventStream*>(user_data);
+  self->listening_ = false;
+  self->StopTimers();
+  self->filter_.Reset();
+  return nullptr;
+}
+
+gboolean FocusEventStream::OnDebounceTimeout(gpointer user_data) {
+  FocusEventStream* self = static_cast<FocusEventStream*>(user_data);
+  self->debounce_source_ = 0;
+  self->Flush();
+  return G_SOURCE_REMOVE;
+}
+
+gboolean FocusEventStream::OnHeartbeat(gpointer user_data) {
+  FocusEventStream* self = static_cast<FocusEventStream*>(user_data);
+  if (self->filter_.HasReported()) {
+    self->Send(self->filter_.LastReported(), BootTimeNow(), true);
+  }
+  return G_SOURCE_CONTINUE;
+}
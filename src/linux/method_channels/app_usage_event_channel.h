@@ -0,0 +1,74 @@
+#ifndef APP_USAGE_EVENT_CHANNEL_H
+#define APP_USAGE_EVENT_CHANNEL_H
+
+#include <flutter_linux/flutter_linux.h>
+#include <chrono>
+#include <memory>
+
+#include "../active_window_sampler.h"
+#include "../focus_change_filter.h"
+
+// Adds "nowBoottimeMs" and "nowEpochMs" to map. Every time the app usage
+// channels send is CLOCK_BOOTTIME milliseconds, which keep counting during
+// suspend; these two let Dart map them to wall-clock time.
+void app_usage_set_clock_mapping(FlValue *map);
+
+// Pushes focus changes to Dart over APP_USAGE_FOCUS_EVENTS_CHANNEL. An event
+// is only sent when the (title, application) pair changes, after it has been
+// stable for the debounce period, plus an optional heartbeat repeating the
+// current window. Fed with sampler snapshots, so every backend can drive it:
+// polled backends through the sampler interval and event-driven ones
+// through WindowDetector::NotifyChanged().
+//
+// When the user goes idle, an event with "idle" set is sent right away,
+// timestamped with their last input; the window in use once they are back
+// is then reported as a change even if it is the same as before.
+//
+// Listen arguments (optional map): "debounceMs", "heartbeatSeconds".
+// Event payload map: "title", "application", "pid", "backend",
+// "timestampMs" (CLOCK_BOOTTIME time the window got focus), "heartbeat",
+// "idle", and "nowBoottimeMs"/"nowEpochMs" (see app_usage_set_clock_mapping).
+class FocusEventStream {
+public:
+  FocusEventStream();
+  ~FocusEventStream();
+
+  FocusEventStream(const FocusEventStream &) = delete;
+  FocusEventStream &operator=(const FocusEventStream &) = delete;
+
+  // Registers the event channel on messenger. Main thread only.
+  void Attach(FlBinaryMessenger *messenger);
+
+  // Feeds a snapshot. Main thread only.
+  void Push(std::shared_ptr<const WindowSnapshot> snapshot);
+
+  // Feeds a snapshot from any thread; it is delivered on the main context
+  // unless the stream has been destroyed by then.
+  static void PushFromAnyThread(std::weak_ptr<FocusEventStream> stream,
+                                std::shared_ptr<const WindowSnapshot> snapshot);
+
+private:
+  static FlMethodErrorResponse *OnListen(FlEventChannel *channel,
+                                         FlValue *args, gpointer user_data);
+  static FlMethodErrorResponse *OnCancel(FlEventChannel *channel,
+                                         FlValue *args, gpointer user_data);
+  static gboolean OnDebounceTimeout(gpointer user_data);
+  static gboolean OnHeartbeat(gpointer user_data);
+
+  void Flush();
+  // timestamp is CLOCK_BOOTTIME: when the change or idle period began, or
+  // now for heartbeats.
+  void Send(const WindowInfo &info, std::chrono::nanoseconds timestamp,
+            bool heartbeat, bool idle = false);
+  void StopTimers();
+
+  FlEventChannel *channel_ = nullptr;
+  bool listening_ = false;
+  FocusChangeFilter filter_;
+  std::chrono::seconds heartbeat_interval_;
+  guint debounce_source_ = 0;
+  guint heartbeat_source_ = 0;
+  std::shared_ptr<const WindowSnapshot> latest_;
+};
+
+#endif // APP_USAGE_EVENT_CHANNEL_H
@@ -1,24 +1,422 @@
 #include "app_usage_method_channel.h"
-#include "../window_detector.h"
+#include <algorithm>
 #include <cstring>
 #include <string>
 
+namespace {
+
+// The sampler's own interval. SampleScheduler requests every detection, so
+// this only matters if it stops doing so; kept below kFocusSessionMaxGap so
+// sessions are not split even then.
+constexpr std::chrono::milliseconds kSampleSafetyInterval(9000);
+
+// Input-free time after which the user counts as away and sampling pauses.
+// Callers can change it with setIdleThreshold.
+constexpr std::chrono::seconds kDefaultIdleThreshold(300);
+// How often the idle time is checked while away. One D-Bus or X round trip,
+// instead of a detection.
+constexpr std::chrono::milliseconds kIdlePollInterval(5000);
+
+// Focus sessions kept between two getFocusSessions calls. At one change per
+// few seconds this covers far more than the Dart side's drain period.
+constexpr size_t kFocusSessionCapacity = 4096;
+// Silence between detections after which a session is considered
+// interrupted (suspend, stalled backend) rather than continued. Twice the
+// longest interval SampleScheduler waits, so a detection that is slow on top
+// of it (a D-Bus timeout, a spawned fallback) does not end the session.
+constexpr std::chrono::seconds kFocusSessionMaxGap =
+    2 * std::max(AdaptiveSampleInterval::kMaxInterval,
+                 AdaptiveSampleInterval::kMaxIntervalOnBattery);
+static_assert(kSampleSafetyInterval < kFocusSessionMaxGap,
+              "the sampler's own interval must not split sessions");
+
+struct FocusWindowRequest {
+  AppUsageChannelState* state;
+  FlMethodCall* method_call;
+  std::string window_title;
+};
+
+void focus_window_request_free(gpointer data) {
+  FocusWindowRequest* request = static_cast<FocusWindowRequest*>(data);
+  g_object_unref(request->method_call);
+  delete request;
+}
+
+void window_info_free(gpointer data) {
+  delete static_cast<WindowInfo*>(data);
+}
+
+struct GetWindowsRequest {
+  AppUsageChannelState* state;
+  FlMethodCall* method_call;
+};
+
+void get_windows_request_free(gpointer data) {
+  GetWindowsRequest* request = static_cast<GetWindowsRequest*>(data);
+  g_object_unref(request->method_call);
+  delete request;
+}
+
+void window_list_free(gpointer data) {
+  delete static_cast<std::vector<ToplevelWindow>*>(data);
+}
+
+// Reply format of getActiveWindow. Callers opt into the structured reply
+// with {"version": 2}; anything else gets the legacy "title,application"
+// string, which breaks on titles containing commas.
+constexpr int64_t kLegacyReplyVersion = 1;
+constexpr int64_t kStructuredReplyVersion = 2;
+
+int64_t requested_reply_version(FlMethodCall* method_call) {
+  FlValue* args = fl_method_call_get_args(method_call);
+  if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* version = fl_value_lookup_string(args, "version");
+    if (version && fl_value_get_type(version) == FL_VALUE_TYPE_INT) {
+      return fl_value_get_int(version);
+    }
+  }
+  return kLegacyReplyVersion;
+}
+
+int64_t to_millis(std::chrono::nanoseconds time) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(time).count();
+}
+
+// captured_at is the CLOCK_BOOTTIME time of the detection. idle is true
+// while the user is away and detection is paused.
+FlMethodResponse* active_window_response_new(
+    const WindowInfo& info, std::chrono::nanoseconds captured_at, bool idle,
+    int64_t version) {
+  if (version < kStructuredReplyVersion) {
+    // Create result string in format: "title,application"
+    std::string window = info.title + "," + info.application;
+
+    g_autoptr(FlValue) flutter_result = fl_value_new_string(window.c_str());
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(flutter_result));
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "version",
+                           fl_value_new_int(kStructuredReplyVersion));
+  fl_value_set_string_take(result, "title",
+                           fl_value_new_string(info.title.c_str()));
+  fl_value_set_string_take(result, "application",
+                           fl_value_new_string(info.application.c_str()));
+  fl_value_set_string_take(result, "pid", fl_value_new_int(info.pid));
+  fl_value_set_string_take(result, "backend",
+                           fl_value_new_string(info.backend.c_str()));
+  fl_value_set_string_take(result, "timestampMs",
+                           fl_value_new_int(to_millis(captured_at)));
+  fl_value_set_string_take(result, "idle", fl_value_new_bool(idle));
+  app_usage_set_clock_mapping(result);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+// Called on the main thread when a worker task completes. Returns false if
+// the state was released meanwhile (and is now deleted), in which case
+// nothing must be responded.
+bool finish_task(AppUsageChannelState* state) {
+  state->tasks_in_flight--;
+  if (state->closing) {
+    if (state->tasks_in_flight == 0) {
+      for (FlMethodCall* call : state->pending_active_window_calls) {
+        g_object_unref(call);
+      }
+      delete state;
+    }
+    return false;
+  }
+  return true;
+}
+
+void get_active_window_thread(GTask* task, gpointer source_object,
+                              gpointer task_data, GCancellable* cancellable) {
+  AppUsageChannelState* state = static_cast<AppUsageChannelState*>(task_data);
+
+  WindowInfo* info;
+  {
+    std::lock_guard<std::mutex> lock(state->detector_mutex);
+    info = new WindowInfo(state->detector->GetActiveWindow());
+  }
+
+  g_task_return_pointer(task, info, window_info_free);
+}
+
+void get_active_window_ready(GObject* source_object, GAsyncResult* result,
+                             gpointer user_data) {
+  AppUsageChannelState* state = static_cast<AppUsageChannelState*>(user_data);
+  WindowInfo* info = static_cast<WindowInfo*>(
+      g_task_propagate_pointer(G_TASK(result), nullptr));
+  std::chrono::nanoseconds captured_at = BootTimeNow();
+
+  if (!finish_task(state)) {
+    window_info_free(info);
+    return;
+  }
+
+  // Every call that arrived while this detection ran gets the same answer.
+  std::vector<FlMethodCall*> calls;
+  calls.swap(state->pending_active_window_calls);
+  state->active_window_in_flight = false;
+
+  for (FlMethodCall* call : calls) {
+    g_autoptr(FlMethodResponse) response = active_window_response_new(
+        *info, captured_at, false, requested_reply_version(call));
+    fl_method_call_respond(call, response, nullptr);
+    g_object_unref(call);
+  }
+  window_info_free(info);
+}
+
+void start_get_active_window(AppUsageChannelState* state,
+                             FlMethodCall* method_call) {
+  state->pending_active_window_calls.push_back(
+      FL_METHOD_CALL(g_object_ref(method_call)));
+
+  // Attach to the detection already in flight instead of starting another
+  // full backend chain.
+  if (state->active_window_in_flight) {
+    return;
+  }
+
+  state->active_window_in_flight = true;
+  state->tasks_in_flight++;
+
+  g_autoptr(GTask) task =
+      g_task_new(nullptr, nullptr, get_active_window_ready, state);
+  g_task_set_task_data(task, state, nullptr);
+  g_task_run_in_thread(task, get_active_window_thread);
+}
+
+void focus_window_thread(GTask* task, gpointer source_object,
+                         gpointer task_data, GCancellable* cancellable) {
+  FocusWindowRequest* request = static_cast<FocusWindowRequest*>(task_data);
+  AppUsageChannelState* state = request->state;
+
+  bool success;
+  {
+    std::lock_guard<std::mutex> lock(state->detector_mutex);
+    success = state->detector->FocusWindow(request->window_title);
+  }
+
+  g_task_return_boolean(task, success);
+}
+
+void focus_window_ready(GObject* source_object, GAsyncResult* result,
+                        gpointer user_data) {
+  FocusWindowRequest* request = static_cast<FocusWindowRequest*>(
+      g_task_get_task_data(G_TASK(result)));
+  bool success = g_task_propagate_boolean(G_TASK(result), nullptr);
+
+  if (!finish_task(request->state)) {
+    return;
+  }
+
+  g_autoptr(FlValue) flutter_result = fl_value_new_bool(success);
+  g_autoptr(FlMethodResponse) response =
+      FL_METHOD_RESPONSE(fl_method_success_response_new(flutter_result));
+  fl_method_call_respond(request->method_call, response, nullptr);
+}
+
+void get_windows_thread(GTask* task, gpointer source_object,
+                        gpointer task_data, GCancellable* cancellable) {
+  GetWindowsRequest* request = static_cast<GetWindowsRequest*>(task_data);
+  AppUsageChannelState* state = request->state;
+
+  std::vector<ToplevelWindow>* windows;
+  {
+    std::lock_guard<std::mutex> lock(state->detector_mutex);
+    windows = new std::vector<ToplevelWindow>(state->detector->GetWindows());
+  }
+
+  g_task_return_pointer(task, windows, window_list_free);
+}
+
+void get_windows_ready(GObject* source_object, GAsyncResult* result,
+                       gpointer user_data) {
+  GetWindowsRequest* request = static_cast<GetWindowsRequest*>(
+      g_task_get_task_data(G_TASK(result)));
+  auto* windows = static_cast<std::vector<ToplevelWindow>*>(
+      g_task_propagate_pointer(G_TASK(result), nullptr));
+  std::chrono::nanoseconds captured_at = BootTimeNow();
+
+  if (!finish_task(request->state)) {
+    window_list_free(windows);
+    return;
+  }
+
+  g_autoptr(FlValue) window_list = fl_value_new_list();
+  for (const ToplevelWindow& window : *windows) {
+    FlValue* item = fl_value_new_map();
+    fl_value_set_string_take(item, "title",
+                             fl_value_new_string(window.title.c_str()));
+    fl_value_set_string_take(item, "application",
+                             fl_value_new_string(window.application.c_str()));
+    fl_value_set_string_take(item, "pid", fl_value_new_int(window.pid));
+    fl_value_set_string_take(item, "focused",
+                             fl_value_new_bool(window.focused));
+    fl_value_set_string_take(item, "minimized",
+                             fl_value_new_bool(window.minimized));
+    fl_value_append_take(window_list, item);
+  }
+  window_list_free(windows);
+
+  g_autoptr(FlValue) flutter_result = fl_value_new_map();
+  fl_value_set_string_take(flutter_result, "windows",
+                           fl_value_ref(window_list));
+  fl_value_set_string_take(flutter_result, "timestampMs",
+                           fl_value_new_int(to_millis(captured_at)));
+  app_usage_set_clock_mapping(flutter_result);
+  g_autoptr(FlMethodResponse) response =
+      FL_METHOD_RESPONSE(fl_method_success_response_new(flutter_result));
+  fl_method_call_respond(request->method_call, response, nullptr);
+}
+
+void start_get_windows(AppUsageChannelState* state,
+                       FlMethodCall* method_call) {
+  GetWindowsRequest* request = new GetWindowsRequest{
+      state, FL_METHOD_CALL(g_object_ref(method_call))};
+  state->tasks_in_flight++;
+
+  g_autoptr(GTask) task = g_task_new(nullptr, nullptr, get_windows_ready, nullptr);
+  g_task_set_task_data(task, request, get_windows_request_free);
+  g_task_run_in_thread(task, get_windows_thread);
+}
+
+// Drains completed focus sessions. Times are CLOCK_BOOTTIME milliseconds;
+// nowBoottimeMs/nowEpochMs let the caller map them to wall-clock time.
+FlMethodResponse* focus_sessions_response_new(AppUsageChannelState* state,
+                                              FlValue* args) {
+  bool include_current = true;
+  if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* value = fl_value_lookup_string(args, "includeCurrent");
+    if (value && fl_value_get_type(value) == FL_VALUE_TYPE_BOOL) {
+      include_current = fl_value_get_bool(value);
+    }
+  }
+
+  size_t dropped = 0;
+  std::vector<FocusSession> sessions =
+      state->focus_sessions->Drain(include_current, &dropped);
+
+  g_autoptr(FlValue) session_list = fl_value_new_list();
+  for (const FocusSession& session : sessions) {
+    FlValue* item = fl_value_new_map();
+    fl_value_set_string_take(item, "title",
+                             fl_value_new_string(session.title.c_str()));
+    fl_value_set_string_take(item, "application",
+                             fl_value_new_string(session.application.c_str()));
+    fl_value_set_string_take(item, "startMs",
+                             fl_value_new_int(to_millis(session.start)));
+    fl_value_set_string_take(item, "endMs",
+                             fl_value_new_int(to_millis(session.end)));
+    fl_value_append_take(session_list, item);
+  }
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "sessions", fl_value_ref(session_list));
+  fl_value_set_string_take(result, "dropped",
+                           fl_value_new_int(static_cast<int64_t>(dropped)));
+  app_usage_set_clock_mapping(result);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
+
+void start_focus_window(AppUsageChannelState* state, FlMethodCall* method_call,
+                        const gchar* window_title) {
+  FocusWindowRequest* request = new FocusWindowRequest{
+      state, FL_METHOD_CALL(g_object_ref(method_call)), window_title};
+  state->tasks_in_flight++;
+
+  g_autoptr(GTask) task = g_task_new(nullptr, nullptr, focus_window_ready, nullptr);
+  g_task_set_task_data(task, request, focus_window_request_free);
+  g_task_run_in_thread(task, focus_window_thread);
+}
+
+}  // namespace
+
+AppUsageChannelState* app_usage_channel_state_new() {
+  AppUsageChannelState* state = new AppUsageChannelState();
+  state->detector = WindowDetector::Create();
+  state->focus_sessions.reset(
+      new FocusSessionRecorder(kFocusSessionCapacity, kFocusSessionMaxGap));
+  state->focus_events = std::make_shared<FocusEventStream>();
+  state->sampler.reset(new ActiveWindowSampler(
+      *state->detector, state->detector_mutex, kSampleSafetyInterval));
+  state->sample_scheduler =
+      std::make_shared<SampleScheduler>(*state->sampler, *state->detector);
+
+  state->idle_monitor.reset(new IdleMonitor());
+  IdleMonitor* idle_monitor = state->idle_monitor.get();
+  state->sampler->SetIdleProbe(
+      [idle_monitor](std::chrono::milliseconds* idle) {
+        return idle_monitor->Query(idle);
+      },
+      kIdlePollInterval);
+  state->sampler->SetIdleThreshold(kDefaultIdleThreshold);
+
+  FocusSessionRecorder* focus_sessions = state->focus_sessions.get();
+  std::weak_ptr<FocusEventStream> focus_events = state->focus_events;
+  std::weak_ptr<SampleScheduler> sample_scheduler = state->sample_scheduler;
+  state->sampler->SetSnapshotListener(
+      [focus_sessions, focus_events,
+       sample_scheduler](std::shared_ptr<const WindowSnapshot> snapshot) {
+        if (snapshot->idle) {
+          focus_sessions->RecordIdle(snapshot->captured_at_boottime);
+        } else {
+          focus_sessions->Record(snapshot->info,
+                                 snapshot->captured_at_boottime);
+        }
+        SampleScheduler::OnSnapshotFromAnyThread(sample_scheduler, snapshot);
+        FocusEventStream::PushFromAnyThread(focus_events, std::move(snapshot));
+      });
+
+  // Event-driven backends wake the sampler instead of waiting for the next
+  // interval.
+  ActiveWindowSampler* sampler = state->sampler.get();
+  state->detector->SetChangeListener([sampler]() { sampler->RequestSample(); });
+
+  state->sampler->Start();
+  return state;
+}
+
+void app_usage_channel_state_attach(AppUsageChannelState* state,
+                                    FlBinaryMessenger* messenger) {
+  state->focus_events->Attach(messenger);
+}
+
+void app_usage_channel_state_free(AppUsageChannelState* state) {
+  state->sampler->Stop();
+  state->sample_scheduler.reset();
+  state->detector->SetChangeListener(nullptr);
+
+  // Worker tasks still reference the state; let the last one delete it.
+  if (state->tasks_in_flight > 0) {
+    state->closing = true;
+    return;
+  }
+  delete state;
+}
+
 void app_usage_method_call_cb(FlMethodChannel* channel,
                               FlMethodCall* method_call,
                               gpointer user_data) {
-  g_autoptr(FlMethodResponse) response = nullptr;
-
+  AppUsageChannelState* state = static_cast<AppUsageChannelState*>(user_data);
   const gchar* method = fl_method_call_get_name(method_call);
 
+  // Detection and focusing can spawn processes and block for hundreds of
+  // milliseconds, so both run on a worker and answer asynchronously.
   if (strcmp(method, "getActiveWindow") == 0) {
-    auto detector = WindowDetector::Create();
-    WindowInfo info = detector->GetActiveWindow();
-
-    // Create result string in format: "title,application"
-    std::string result = info.title + "," + info.application;
-
-    g_autoptr(FlValue) flutter_result = fl_value_new_string(result.c_str());
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(flutter_result));
+    // Answer from the sampler's newest snapshot; only detect on demand until
+    // the first one is available.
+    std::shared_ptr<const WindowSnapshot> snapshot = state->sampler->Latest();
+    if (snapshot) {
+      g_autoptr(FlMethodResponse) response = active_window_response_new(
+          snapshot->info, snapshot->captured_at_boottime, snapshot->idle,
+          requested_reply_version(method_call));
+      fl_method_call_respond(method_call, response, nullptr);
+    } else {
+      start_get_active_window(state, method_call);
+    }
   } else if (strcmp(method, "focusWindow") == 0) {
     // Get the window title parameter
     FlValue* args = fl_method_call_get_args(method_call);
@@ -28,14 +426,55 @@ void app_usage_method_call_cb(FlMethodChannel* channel,
       window_title = fl_value_get_string(args);
     }
 
-    auto detector = WindowDetector::Create();
-    bool success = detector->FocusWindow(window_title);
+    start_focus_window(state, method_call, window_title);
+  } else if (strcmp(method, "getWindows") == 0) {
+    // Every top-level window with its title, application, pid, and focused
+    // and minimized state, in one batch.
+    start_get_windows(state, method_call);
+  } else if (strcmp(method, "setIdleThreshold") == 0) {
+    // {"seconds": n}; zero turns idle detection off.
+    FlValue* args = fl_method_call_get_args(method_call);
+    FlValue* seconds = nullptr;
+    if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      seconds = fl_value_lookup_string(args, "seconds");
+    }
 
-    g_autoptr(FlValue) flutter_result = fl_value_new_bool(success);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(flutter_result));
+    g_autoptr(FlMethodResponse) response = nullptr;
+    if (seconds && fl_value_get_type(seconds) == FL_VALUE_TYPE_INT &&
+        fl_value_get_int(seconds) >= 0) {
+      state->sampler->SetIdleThreshold(
+          std::chrono::seconds(fl_value_get_int(seconds)));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "INVALID_ARGUMENT", "Expected {\"seconds\": int >= 0}", nullptr));
+    }
+    fl_method_call_respond(method_call, response, nullptr);
+  } else if (strcmp(method, "getSamplingStats") == 0) {
+    // How often the sampler currently detects; intervalMs is 0 while idle.
+    g_autoptr(FlMethodResponse) response = nullptr;
+    if (state->sample_scheduler) {
+      g_autoptr(FlValue) result = fl_value_new_map();
+      fl_value_set_string_take(
+          result, "intervalMs",
+          fl_value_new_int(state->sample_scheduler->CurrentInterval().count()));
+      fl_value_set_string_take(
+          result, "onBattery",
+          fl_value_new_bool(state->sample_scheduler->OnBattery()));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } else {
+      // The state is being released and only waits for its worker tasks
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "UNAVAILABLE", "Sampling has stopped", nullptr));
+    }
+    fl_method_call_respond(method_call, response, nullptr);
+  } else if (strcmp(method, "getFocusSessions") == 0) {
+    g_autoptr(FlMethodResponse) response = focus_sessions_response_new(
+        state, fl_method_call_get_args(method_call));
+    fl_method_call_respond(method_call, response, nullptr);
   } else {
-    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    g_autoptr(FlMethodResponse) response =
+        FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+    fl_method_call_respond(method_call, response, nullptr);
   }
-
-  fl_method_call_respond(method_call, response, nullptr);
 }
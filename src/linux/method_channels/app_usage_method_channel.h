@@ -2,7 +2,59 @@
 #define APP_USAGE_METHOD_CHANNEL_H
 
 #include <flutter_linux/flutter_linux.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 
+#include "../active_window_sampler.h"
+#include "../focus_session_recorder.h"
+#include "../idle_monitor.h"
+#include "../sample_scheduler.h"
+#include "../window_detector.h"
+#include "app_usage_event_channel.h"
+
+// State shared by every call on the app usage channel. Owned by MyApplication
+// so the detector (and whatever its backend has learned) lives as long as the
+// process instead of being recreated per method call.
+struct AppUsageChannelState {
+  std::unique_ptr<WindowDetector> detector;
+  // Detection and focusing run on GTask worker threads; backends are not
+  // thread-safe, so every detector call holds this lock.
+  std::mutex detector_mutex;
+  // Completed focus sessions waiting for getFocusSessions. Fed by the
+  // sampler, so it must outlive it.
+  std::unique_ptr<FocusSessionRecorder> focus_sessions;
+  // Fed by the sampler; shared so queued deliveries can tell whether it is
+  // still alive.
+  std::shared_ptr<FocusEventStream> focus_events;
+  // Tells the sampler when to pause; only queried on the sampler thread, so
+  // it must outlive it.
+  std::unique_ptr<IdleMonitor> idle_monitor;
+  // Keeps the newest active window snapshot ready for getActiveWindow.
+  std::unique_ptr<ActiveWindowSampler> sampler;
+  // Tells the sampler when to detect. Fed by the sampler; shared so queued
+  // deliveries can tell whether it is still alive.
+  std::shared_ptr<SampleScheduler> sample_scheduler;
+
+  // The fields below are only touched on the GTK main thread.
+  // getActiveWindow calls waiting for the detection currently in flight.
+  // Only used until the sampler has published its first snapshot.
+  std::vector<FlMethodCall *> pending_active_window_calls;
+  bool active_window_in_flight = false;
+  int tasks_in_flight = 0;
+  // Set when the application released the state while tasks were running;
+  // the last task to finish deletes it.
+  bool closing = false;
+};
+
+AppUsageChannelState *app_usage_channel_state_new();
+void app_usage_channel_state_free(AppUsageChannelState *state);
+
+// Registers the focus event channel. Call once the engine's messenger exists.
+void app_usage_channel_state_attach(AppUsageChannelState *state,
+                                    FlBinaryMessenger *messenger);
+
+// user_data must be the AppUsageChannelState owned by the application.
 void app_usage_method_call_cb(FlMethodChannel *channel,
                               FlMethodCall *method_call, gpointer user_data);
 
@@ -1,8 +1,9 @@
 #include "window_management_method_channel.h"
 #include <cstring>
 
-#ifdef GDK_WINDOWING_X11
+#if defined(GDK_WINDOWING_X11) && defined(HAVE_X11)
 #include <gdk/gdkx.h>
+#include "../x11_library.h"
 #endif
 
 // Helper to get the window from user_data
@@ -32,26 +33,30 @@ void window_management_method_call_cb(FlMethodChannel* channel,
 
     bool success = false;
 
-#ifdef GDK_WINDOWING_X11
-    if (window && GDK_IS_X11_WINDOW(gtk_widget_get_window(GTK_WIDGET(window)))) {
-      GdkWindow* gdk_window = gtk_widget_get_window(GTK_WIDGET(window));
-      if (GDK_IS_X11_WINDOW(gdk_window)) {
-        // Set the WM_CLASS property for X11 windows
-        gdk_window_set_role(gdk_window, window_class);
-
-        // Also set the class hint for better KDE integration
-        XClassHint* class_hint = XAllocClassHint();
-        if (class_hint) {
-          class_hint->res_name = const_cast<char*>(window_class);
-          class_hint->res_class = const_cast<char*>(window_class);
-
-          XSetClassHint(GDK_DISPLAY_XDISPLAY(gdk_display_get_default()),
-                        GDK_WINDOW_XID(gdk_window),
-                        class_hint);
-
-          XFree(class_hint);
-          success = true;
-        }
+#if defined(GDK_WINDOWING_X11) && defined(HAVE_X11)
+    GdkWindow* gdk_window =
+        window ? gtk_widget_get_window(GTK_WIDGET(window)) : nullptr;
+    // An X11 GDK window means GDK already has libX11 loaded; on Wayland the
+    // table is never loaded
+    const X11Library* x11 = gdk_window && GDK_IS_X11_WINDOW(gdk_window)
+                                ? LoadX11Library()
+                                : nullptr;
+    if (x11) {
+      // Set the WM_CLASS property for X11 windows
+      gdk_window_set_role(gdk_window, window_class);
+
+      // Also set the class hint for better KDE integration
+      XClassHint* class_hint = x11->XAllocClassHint();
+      if (class_hint) {
+        class_hint->res_name = const_cast<char*>(window_class);
+        class_hint->res_class = const_cast<char*>(window_class);
+
+        x11->XSetClassHint(GDK_DISPLAY_XDISPLAY(gdk_display_get_default()),
+                           GDK_WINDOW_XID(gdk_window),
+                           class_hint);
+
+        x11->XFree(class_hint);
+        success = true;
       }
     }
 #endif
@@ -14,6 +14,9 @@
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+  // Lives for the whole process so window detection backends can keep
+  // connections and probe results between method calls.
+  AppUsageChannelState* app_usage_state;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
@@ -40,7 +43,7 @@ std::string get_executable_dir() {
 }
 
 // Setup method channels
-static void setup_method_channels(FlView* view) {
+static void setup_method_channels(MyApplication* self, FlView* view) {
   FlEngine* engine = fl_view_get_engine(view);
   FlBinaryMessenger* messenger = fl_engine_get_binary_messenger(engine);
 
@@ -55,10 +58,13 @@ static void setup_method_channels(FlView* view) {
   fl_method_channel_set_method_call_handler(
     app_usage_channel,
     app_usage_method_call_cb,
-    nullptr,
+    self->app_usage_state,
     nullptr
   );
 
+  // Setup app usage focus event channel
+  app_usage_channel_state_attach(self->app_usage_state, messenger);
+
   // Setup window management method channel
   g_autoptr(FlStandardMethodCodec) window_management_codec = fl_standard_method_codec_new();
   g_autoptr(FlMethodChannel) window_management_channel = fl_method_channel_new(
@@ -195,7 +201,7 @@ static void my_application_activate(GApplication* application) {
   fl_register_plugins(FL_PLUGIN_REGISTRY(view));
 
   // Setup our method channels
-  setup_method_channels(view);
+  setup_method_channels(self, view);
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
   
@@ -225,18 +231,22 @@ static gboolean my_application_local_command_line(GApplication* application, gch
 
 // Implements GApplication::startup.
 static void my_application_startup(GApplication* application) {
-  //MyApplication* self = MY_APPLICATION(object);
+  MyApplication* self = MY_APPLICATION(application);
 
   // Perform any actions required at application startup.
+  if (self->app_usage_state == nullptr) {
+    self->app_usage_state = app_usage_channel_state_new();
+  }
 
   G_APPLICATION_CLASS(my_application_parent_class)->startup(application);
 }
 
 // Implements GApplication::shutdown.
 static void my_application_shutdown(GApplication* application) {
-  //MyApplication* self = MY_APPLICATION(object);
+  MyApplication* self = MY_APPLICATION(application);
 
   // Perform any actions required at application shutdown.
+  g_clear_pointer(&self->app_usage_state, app_usage_channel_state_free);
 
   G_APPLICATION_CLASS(my_application_parent_class)->shutdown(application);
 }
@@ -245,6 +255,7 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  g_clear_pointer(&self->app_usage_state, app_usage_channel_state_free);
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
@@ -0,0 +1,302 @@
+#include "process_runner.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <iostream>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+extern char **environ;
+
+namespace {
+
+// Large enough that typical probe output arrives in one read.
+constexpr size_t kReadChunkSize = 64 * 1024;
+
+// Longest sleep between checks while waiting for a child to exit.
+constexpr std::chrono::milliseconds kMaxExitPollInterval(50);
+
+int ExitStatus(int status) {
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+void KillProcessGroup(pid_t pid) {
+  // The child leads its own process group, so this also reaches anything
+  // it spawned (e.g. the stages of an `sh -c` pipeline).
+  if (kill(-pid, SIGKILL) != 0) {
+    kill(pid, SIGKILL);
+  }
+}
+
+// Reaps pid, which has been killed or is about to exit.
+int ReapProcess(pid_t pid) {
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      return -1;
+    }
+  }
+  return ExitStatus(status);
+}
+
+// Reaps pid once it exits on its own before deadline. A child that closed
+// or redirected its stdout can keep running after EOF; if it still runs at
+// deadline its process group is killed and *timed_out is set.
+int WaitForExit(pid_t pid, std::chrono::steady_clock::time_point deadline,
+                bool *timed_out) {
+  std::chrono::milliseconds interval(1);
+  while (true) {
+    int status = 0;
+    pid_t reaped = waitpid(pid, &status, WNOHANG);
+    if (reaped == pid) {
+      return ExitStatus(status);
+    }
+    if (reaped < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      *timed_out = true;
+      KillProcessGroup(pid);
+      return ReapProcess(pid);
+    }
+    std::this_thread::sleep_for(std::min(interval, remaining));
+    interval = std::min(interval * 2, kMaxExitPollInterval);
+  }
+}
+
+} // namespace
+
+ProcessResult RunProcessStreaming(const std::vector<std::string> &argv,
+                                  const OutputCallback &on_output,
+                                  const ProcessOptions &options) {
+  ProcessResult result;
+  if (argv.empty()) {
+    return result;
+  }
+
+  int pipe_fds[2];
+  if (pipe2(pipe_fds, O_CLOEXEC) != 0) {
+    return result;
+  }
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                   O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+  if (!options.inherit_stderr) {
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+  }
+
+  // Own process group, default signal dispositions and an empty signal mask,
+  // whatever the calling thread has blocked or ignored.
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  sigset_t all_signals, no_signals;
+  sigfillset(&all_signals);
+  sigemptyset(&no_signals);
+  posix_spawnattr_setsigdefault(&attr, &all_signals);
+  posix_spawnattr_setsigmask(&attr, &no_signals);
+  posix_spawnattr_setpgroup(&attr, 0);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP |
+                                      POSIX_SPAWN_SETSIGDEF |
+                                      POSIX_SPAWN_SETSIGMASK);
+
+  std::vector<char *> c_argv;
+  c_argv.reserve(argv.size() + 1);
+  for (const std::string &arg : argv) {
+    c_argv.push_back(const_cast<char *>(arg.c_str()));
+  }
+  c_argv.push_back(nullptr);
+
+  pid_t pid = 0;
+  int spawn_error = posix_spawnp(&pid, c_argv[0], &actions, &attr,
+                                 c_argv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  posix_spawnattr_destroy(&attr);
+  close(pipe_fds[1]);
+
+  if (spawn_error != 0) {
+    close(pipe_fds[0]);
+    return result;
+  }
+  result.started = true;
+
+  auto deadline = std::chrono::steady_clock::now() + options.timeout;
+  std::vector<char> buffer(kReadChunkSize);
+  size_t total = 0;
+
+  while (true) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      result.timed_out = true;
+      break;
+    }
+
+    struct pollfd pfd = {pipe_fds[0], POLLIN, 0};
+    int ready = poll(&pfd, 1, static_cast<int>(remaining.count()));
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (ready == 0) {
+      continue; // Deadline check at the top of the loop.
+    }
+
+    ssize_t count = read(pipe_fds[0], buffer.data(), buffer.size());
+    if (count < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      break;
+    }
+    if (count == 0) {
+      break; // EOF
+    }
+
+    size_t usable = static_cast<size_t>(count);
+    if (total + usable > options.max_output) {
+      usable = total < options.max_output ? options.max_output - total : 0;
+    }
+    total += usable;
+    if (usable > 0 && !on_output(buffer.data(), usable)) {
+      result.stopped = true;
+      break;
+    }
+  }
+
+  close(pipe_fds[0]);
+  if (result.timed_out || result.stopped) {
+    KillProcessGroup(pid);
+    result.exit_status = ReapProcess(pid);
+  } else {
+    // EOF, or a poll or read error: the child may still be running
+    result.exit_status = WaitForExit(pid, deadline, &result.timed_out);
+  }
+  return result;
+}
+
+ProcessResult RunProcess(const std::vector<std::string> &argv,
+                         const ProcessOptions &options) {
+  std::string output;
+  ProcessResult result =
+      RunProcessStreaming(argv,
+                          [&output](const char *data, size_t size) {
+                            output.append(data, size);
+                            return true;
+                          },
+                          options);
+  result.output = std::move(output);
+  return result;
+}
+
+ProcessResult RunProcessLines(const std::vector<std::string> &argv,
+                              const LineCallback &on_line,
+                              const ProcessOptions &options) {
+  std::string pending;
+  ProcessResult result = RunProcessStreaming(
+      argv,
+      [&pending, &on_line](const char *data, size_t size) {
+        const char *end = data + size;
+        const char *line_start = data;
+        for (const char *p = data; p != end; ++p) {
+          if (*p != '\n') {
+            continue;
+          }
+          pending.append(line_start, p);
+          line_start = p + 1;
+          std::string line;
+          line.swap(pending);
+          if (!on_line(line)) {
+            return false;
+          }
+        }
+        pending.append(line_start, end);
+        return true;
+      },
+      options);
+
+  if (!result.stopped && !pending.empty()) {
+    on_line(pending);
+  }
+  return result;
+}
+
+std::string RunProcessOutput(const std::vector<std::string> &argv,
+                             const ProcessOptions &options) {
+  ProcessResult result = RunProcess(argv, options);
+  if (!result.Succeeded()) {
+    return "";
+  }
+  if (!result.output.empty() && result.output.back() == '\n') {
+    result.output.pop_back();
+  }
+  return result.output;
+}
+
+bool RunProcessSucceeded(const std::vector<std::string> &argv,
+                         const ProcessOptions &options) {
+  return RunProcess(argv, options).Succeeded();
+}
+
+bool CommandExists(const std::string &name) {
+  if (name.empty()) {
+    return false;
+  }
+  if (name.find('/') != std::string::npos) {
+    return access(name.c_str(), X_OK) == 0;
+  }
+
+  const char *path_env = getenv("PATH");
+  std::string path = path_env ? path_env : "/usr/local/bin:/usr/bin:/bin";
+
+  size_t start = 0;
+  while (start <= path.size()) {
+    size_t end = path.find(':', start);
+    if (end == std::string::npos) {
+      end = path.size();
+    }
+    std::string dir = path.substr(start, end - start);
+    if (dir.empty()) {
+      dir = ".";
+    }
+    std::string candidate = dir + "/" + name;
+    struct stat st;
+    if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) &&
+        access(candidate.c_str(), X_OK) == 0) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+
+bool IsRunningInFlatpak() {
+  static const bool in_flatpak = access("/.flatpak-info", F_OK) == 0;
+  return in_flatpak;
+}
+
+std::vector<std::string> HostCommand(std::vector<std::string> argv) {
+  if (IsRunningInFlatpak()) {
+    argv.insert(argv.begin(), {"flatpak-spawn", "--host"});
+  }
+  return argv;
+}
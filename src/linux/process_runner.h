@@ -0,0 +1,79 @@
+#ifndef PROCESS_RUNNER_H_
+#define PROCESS_RUNNER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ProcessResult {
+  // False if the process could not be spawned at all.
+  bool started = false;
+  // True if the process was killed because it exceeded its deadline.
+  bool timed_out = false;
+  // True if the output callback ended the run early and the process was
+  // killed. The caller already has what it needed, so this is not a failure.
+  bool stopped = false;
+  // Exit code of the process, -1 if it did not exit normally.
+  int exit_status = -1;
+  std::string output;
+
+  bool Succeeded() const { return started && !timed_out && exit_status == 0; }
+};
+
+struct ProcessOptions {
+  // The process (and its process group) is killed once this expires.
+  std::chrono::milliseconds timeout{5000};
+  // Forward stderr to ours instead of discarding it.
+  bool inherit_stderr = false;
+  // Output beyond this many bytes is read and dropped.
+  size_t max_output = 16 * 1024 * 1024;
+};
+
+// Runs argv[0] (looked up in PATH) with the given arguments, without a shell,
+// and collects its stdout. Uses posix_spawn, so no copy of the parent's
+// address space is made.
+ProcessResult RunProcess(const std::vector<std::string> &argv,
+                         const ProcessOptions &options = ProcessOptions());
+
+// Stdout of a successful run without its trailing newline, empty otherwise.
+std::string RunProcessOutput(const std::vector<std::string> &argv,
+                             const ProcessOptions &options = ProcessOptions());
+
+// True if the process ran and exited with status 0.
+bool RunProcessSucceeded(const std::vector<std::string> &argv,
+                         const ProcessOptions &options = ProcessOptions());
+
+// Receives stdout as it arrives. Returning false stops reading and kills the
+// process (and its process group).
+using OutputCallback = std::function<bool(const char *data, size_t size)>;
+
+// Like RunProcess, but streams stdout to on_output instead of collecting it,
+// so large outputs never have to be held in memory at once.
+ProcessResult
+RunProcessStreaming(const std::vector<std::string> &argv,
+                    const OutputCallback &on_output,
+                    const ProcessOptions &options = ProcessOptions());
+
+// Receives one line of output without its trailing newline. Returning false
+// stops reading and kills the process.
+using LineCallback = std::function<bool(const std::string &line)>;
+
+// Like RunProcessStreaming, but splits stdout into lines. A final line without
+// a trailing newline is delivered at EOF.
+ProcessResult RunProcessLines(const std::vector<std::string> &argv,
+                              const LineCallback &on_line,
+                              const ProcessOptions &options = ProcessOptions());
+
+// PATH lookup without spawning `which`.
+bool CommandExists(const std::string &name);
+
+// True when running inside a Flatpak sandbox (cached after the first call).
+bool IsRunningInFlatpak();
+
+// Prefixes argv with `flatpak-spawn --host` when running inside Flatpak, so
+// the command runs on the host.
+std::vector<std::string> HostCommand(std::vector<std::string> argv);
+
+#endif // PROCESS_RUNNER_H_
@@ -0,0 +1,211 @@
+#include "sample_scheduler.h"
+#include <algorithm>
+
+namespace {
+
+constexpr const char *kUpowerBusName = "org.freedesktop.UPower";
+constexpr const char *kUpowerPath = "/org/freedesktop/UPower";
+constexpr gint kBusCallTimeoutMs = 500;
+
+// Cap on the steady sample count; enough steps to reach any maximum.
+constexpr int kMaxSteadySamples =
+    AdaptiveSampleInterval::kSamplesPerStep * 16;
+
+struct SnapshotDelivery {
+  std::weak_ptr<SampleScheduler> scheduler;
+  std::shared_ptr<const WindowSnapshot> snapshot;
+};
+
+gboolean deliver_snapshot(gpointer user_data) {
+  SnapshotDelivery *delivery = static_cast<SnapshotDelivery *>(user_data);
+  std::shared_ptr<SampleScheduler> scheduler = delivery->scheduler.lock();
+  if (scheduler) {
+    scheduler->OnSnapshot(*delivery->snapshot);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+void snapshot_delivery_free(gpointer user_data) {
+  delete static_cast<SnapshotDelivery *>(user_data);
+}
+
+} // namespace
+
+constexpr std::chrono::seconds AdaptiveSampleInterval::kMinInterval;
+constexpr std::chrono::seconds AdaptiveSampleInterval::kMaxInterval;
+constexpr std::chrono::seconds AdaptiveSampleInterval::kMaxIntervalOnBattery;
+constexpr int AdaptiveSampleInterval::kSamplesPerStep;
+constexpr int AdaptiveSampleInterval::kLatencyFactor;
+
+void AdaptiveSampleInterval::OnSample(bool changed,
+                                      std::chrono::microseconds latency) {
+  steady_samples_ = changed ? 0 : std::min(steady_samples_ + 1,
+                                           kMaxSteadySamples);
+  latency_ = latency;
+}
+
+std::chrono::seconds AdaptiveSampleInterval::Interval() const {
+  std::chrono::seconds max = on_battery_ ? kMaxIntervalOnBattery : kMaxInterval;
+  if (event_driven_) {
+    return max;
+  }
+
+  std::chrono::seconds interval = kMinInterval;
+  for (int steps = steady_samples_ / kSamplesPerStep; steps > 0; steps--) {
+    interval *= 2;
+  }
+  if (on_battery_) {
+    interval *= 2;
+  }
+
+  // Rounded up to whole seconds
+  auto latency_floor = std::chrono::duration_cast<std::chrono::seconds>(
+      latency_ * kLatencyFactor + std::chrono::seconds(1) -
+      std::chrono::microseconds(1));
+  return std::min(max, std::max(interval, latency_floor));
+}
+
+SampleScheduler::SampleScheduler(ActiveWindowSampler &sampler,
+                                 WindowDetector &detector)
+    : sampler_(sampler), detector_(detector),
+      cancellable_(g_cancellable_new()) {
+  GError *error = nullptr;
+  system_bus_ = g_bus_get_sync(G_BUS_TYPE_SYSTEM, nullptr, &error);
+  if (!system_bus_) {
+    g_clear_error(&error);
+    return;
+  }
+
+  upower_subscription_ = g_dbus_connection_signal_subscribe(
+      system_bus_, kUpowerBusName, "org.freedesktop.DBus.Properties",
+      "PropertiesChanged", kUpowerPath, kUpowerBusName,
+      G_DBUS_SIGNAL_FLAGS_NONE, OnUpowerPropertiesChanged, this, nullptr);
+  g_dbus_connection_call(
+      system_bus_, kUpowerBusName, kUpowerPath,
+      "org.freedesktop.DBus.Properties", "Get",
+      g_variant_new("(ss)", kUpowerBusName, "OnBattery"),
+      G_VARIANT_TYPE("(v)"), G_DBUS_CALL_FLAGS_NONE, kBusCallTimeoutMs,
+      cancellable_, OnUpowerPropertiesReady, this);
+}
+
+SampleScheduler::~SampleScheduler() {
+  g_cancellable_cancel(cancellable_);
+  g_object_unref(cancellable_);
+  if (timeout_source_ != 0) {
+    g_source_remove(timeout_source_);
+  }
+  if (system_bus_) {
+    g_dbus_connection_signal_unsubscribe(system_bus_, upower_subscription_);
+    g_object_unref(system_bus_);
+  }
+}
+
+void SampleScheduler::OnSnapshotFromAnyThread(
+    std::weak_ptr<SampleScheduler> scheduler,
+    std::shared_ptr<const WindowSnapshot> snapshot) {
+  g_main_context_invoke_full(
+      nullptr, G_PRIORITY_DEFAULT, deliver_snapshot,
+      new SnapshotDelivery{std::move(scheduler), std::move(snapshot)},
+      snapshot_delivery_free);
+}
+
+void SampleScheduler::OnSnapshot(const WindowSnapshot &snapshot) {
+  if (snapshot.idle) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      idle_ = true;
+    }
+    has_previous_ = false;
+    if (timeout_source_ != 0) {
+      g_source_remove(timeout_source_);
+      timeout_source_ = 0;
+    }
+    return;
+  }
+
+  bool changed = !has_previous_ ||
+                 snapshot.info.title != previous_.title ||
+                 snapshot.info.application != previous_.application;
+  previous_ = snapshot.info;
+  has_previous_ = true;
+
+  std::chrono::seconds interval;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_ = false;
+    interval_.SetEventDriven(detector_.ReportsChanges());
+    interval_.OnSample(changed, snapshot.detection_time);
+    interval = interval_.Interval();
+  }
+  Arm(interval);
+}
+
+std::chrono::milliseconds SampleScheduler::CurrentInterval() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (idle_) {
+    return std::chrono::milliseconds(0);
+  }
+  return interval_.Interval();
+}
+
+bool SampleScheduler::OnBattery() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return interval_.OnBattery();
+}
+
+void SampleScheduler::Arm(std::chrono::seconds interval) {
+  if (timeout_source_ != 0) {
+    g_source_remove(timeout_source_);
+  }
+  timeout_source_ = g_timeout_add_seconds(
+      static_cast<guint>(interval.count()), OnTimeout, this);
+}
+
+void SampleScheduler::SetOnBattery(bool on_battery) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  interval_.SetOnBattery(on_battery);
+}
+
+gboolean SampleScheduler::OnTimeout(gpointer user_data) {
+  SampleScheduler *self = static_cast<SampleScheduler *>(user_data);
+  self->timeout_source_ = 0;
+  // The resulting snapshot arms the next timeout
+  self->sampler_.RequestSample();
+  return G_SOURCE_REMOVE;
+}
+
+void SampleScheduler::OnUpowerPropertiesReady(GObject *source,
+                                              GAsyncResult *result,
+                                              gpointer user_data) {
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_finish(
+      G_DBUS_CONNECTION(source), result, &error);
+  if (!reply) {
+    // Cancelled means the scheduler is gone; otherwise there is no UPower,
+    // e.g. on a desktop, and AC is assumed
+    g_clear_error(&error);
+    return;
+  }
+
+  GVariant *value = nullptr;
+  g_variant_get(reply, "(v)", &value);
+  if (g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN)) {
+    static_cast<SampleScheduler *>(user_data)->SetOnBattery(
+        g_variant_get_boolean(value));
+  }
+  g_variant_unref(value);
+  g_variant_unref(reply);
+}
+
+void SampleScheduler::OnUpowerPropertiesChanged(
+    GDBusConnection *connection, const gchar *sender_name,
+    const gchar *object_path, const gchar *interface_name,
+    const gchar *signal_name, GVariant *parameters, gpointer user_data) {
+  GVariant *changed = nullptr;
+  g_variant_get(parameters, "(s@a{sv}as)", nullptr, &changed, nullptr);
+  gboolean on_battery;
+  if (g_variant_lookup(changed, "OnBattery", "b", &on_battery)) {
+    static_cast<SampleScheduler *>(user_data)->SetOnBattery(on_battery);
+  }
+  g_variant_unref(changed);
+}
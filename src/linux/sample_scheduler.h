@@ -0,0 +1,114 @@
+#ifndef SAMPLE_SCHEDULER_H_
+#define SAMPLE_SCHEDULER_H_
+
+#include "active_window_sampler.h"
+#include <gio/gio.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+// Picks the time until the next active window detection from what recent
+// detections looked like: fast right after a focus change, backing off
+// while focus stays put, never spending more than a small share of the time
+// inside the backend, and slower on battery or while the backend reports
+// changes itself. Whole seconds, so the timer can be coalesced.
+//
+// Not thread-safe; SampleScheduler serializes access.
+class AdaptiveSampleInterval {
+public:
+  // Shortest interval, used right after a change.
+  static constexpr std::chrono::seconds kMinInterval{1};
+  // Longest interval on AC and on battery. The focus session recorder's
+  // maximum gap is derived from these, so steady focus is not split into
+  // sessions.
+  static constexpr std::chrono::seconds kMaxInterval{4};
+  static constexpr std::chrono::seconds kMaxIntervalOnBattery{8};
+  // Unchanged detections at one interval before it doubles.
+  static constexpr int kSamplesPerStep = 5;
+  // The interval is at least this many times the last detection's latency.
+  static constexpr int kLatencyFactor = 20;
+
+  // Feeds one detection; changed is true if the window differs from the
+  // previous detection.
+  void OnSample(bool changed, std::chrono::microseconds latency);
+
+  void SetOnBattery(bool on_battery) { on_battery_ = on_battery; }
+  bool OnBattery() const { return on_battery_; }
+  // The backend reports changes itself; polling is only a safety net.
+  void SetEventDriven(bool event_driven) { event_driven_ = event_driven; }
+
+  std::chrono::seconds Interval() const;
+
+private:
+  int steady_samples_ = 0;
+  std::chrono::microseconds latency_{0};
+  bool on_battery_ = false;
+  bool event_driven_ = false;
+};
+
+// Requests detections from an ActiveWindowSampler at the rate chosen by
+// AdaptiveSampleInterval, with one-shot g_timeout_add_seconds timers on the
+// main context so the wakeups coalesce with the process's other second
+// timers. Each detection re-arms the timer with the new interval. While the
+// user is idle no timer runs; the sampler's own idle polling resumes it.
+//
+// Reads the power source from UPower's OnBattery property and follows its
+// changes.
+//
+// Lives on the main thread; OnSnapshotFromAnyThread() may be called from
+// any thread.
+class SampleScheduler {
+public:
+  SampleScheduler(ActiveWindowSampler &sampler, WindowDetector &detector);
+  ~SampleScheduler();
+
+  SampleScheduler(const SampleScheduler &) = delete;
+  SampleScheduler &operator=(const SampleScheduler &) = delete;
+
+  // Feeds a snapshot and re-arms the timer. Main thread only.
+  void OnSnapshot(const WindowSnapshot &snapshot);
+
+  // Feeds a snapshot from any thread; it is delivered on the main context
+  // unless the scheduler has been destroyed by then.
+  static void
+  OnSnapshotFromAnyThread(std::weak_ptr<SampleScheduler> scheduler,
+                          std::shared_ptr<const WindowSnapshot> snapshot);
+
+  // Current time between detections, zero while idle. Any thread.
+  std::chrono::milliseconds CurrentInterval() const;
+  bool OnBattery() const;
+
+private:
+  void Arm(std::chrono::seconds interval);
+  void SetOnBattery(bool on_battery);
+
+  static gboolean OnTimeout(gpointer user_data);
+  static void OnUpowerPropertiesReady(GObject *source, GAsyncResult *result,
+                                      gpointer user_data);
+  static void OnUpowerPropertiesChanged(GDBusConnection *connection,
+                                        const gchar *sender_name,
+                                        const gchar *object_path,
+                                        const gchar *interface_name,
+                                        const gchar *signal_name,
+                                        GVariant *parameters,
+                                        gpointer user_data);
+
+  ActiveWindowSampler &sampler_;
+  WindowDetector &detector_;
+
+  mutable std::mutex mutex_;
+  AdaptiveSampleInterval interval_;
+  bool idle_ = false;
+
+  // Main thread only.
+  bool has_previous_ = false;
+  WindowInfo previous_;
+  guint timeout_source_ = 0;
+
+  GDBusConnection *system_bus_ = nullptr;
+  guint upower_subscription_ = 0;
+  GCancellable *cancellable_ = nullptr;
+};
+
+#endif // SAMPLE_SCHEDULER_H_
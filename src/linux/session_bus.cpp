@@ -0,0 +1,53 @@
+#include "session_bus.h"
+#include <mutex>
+
+namespace {
+
+GDBusConnection *g_session_bus = nullptr;
+std::once_flag g_connect_once;
+
+} // namespace
+
+GDBusConnection *SessionBus() {
+  std::call_once(g_connect_once, [] {
+    GError *error = nullptr;
+    g_session_bus = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr, &error);
+    g_clear_error(&error);
+  });
+  return g_session_bus;
+}
+
+GVariant *SessionBusCall(const char *name, const char *path,
+                         const char *interface, const char *method,
+                         GVariant *parameters, const char *reply_type,
+                         gint timeout_ms) {
+  GDBusConnection *bus = SessionBus();
+  if (!bus) {
+    if (parameters) {
+      g_variant_unref(g_variant_ref_sink(parameters));
+    }
+    return nullptr;
+  }
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_sync(
+      bus, name, path, interface, method, parameters,
+      G_VARIANT_TYPE(reply_type), G_DBUS_CALL_FLAGS_NONE, timeout_ms, nullptr,
+      &error);
+  g_clear_error(&error);
+  return reply;
+}
+
+void SessionBusCallNoReply(const char *name, const char *path,
+                           const char *interface, const char *method,
+                           GVariant *parameters) {
+  GDBusConnection *bus = SessionBus();
+  if (!bus) {
+    if (parameters) {
+      g_variant_unref(g_variant_ref_sink(parameters));
+    }
+    return;
+  }
+  g_dbus_connection_call(bus, name, path, interface, method, parameters,
+                         nullptr, G_DBUS_CALL_FLAGS_NONE, -1, nullptr,
+                         nullptr, nullptr);
+}
@@ -0,0 +1,28 @@
+#ifndef SESSION_BUS_H_
+#define SESSION_BUS_H_
+
+#include <gio/gio.h>
+
+// Default time a session bus call may take before it is abandoned.
+constexpr gint kSessionBusCallTimeoutMs = 500;
+
+// The process's connection to the session bus, opened on the first call and
+// kept for the rest of the process; nullptr if there is no session bus. The
+// caller does not own a reference. Thread-safe, like the connection itself.
+GDBusConnection *SessionBus();
+
+// Calls a method on the session bus and waits for the reply, which must have
+// type reply_type, e.g. "(s)". Returns the reply, to be unreffed by the
+// caller, or nullptr if there is no session bus or the call failed.
+// parameters is consumed if it is floating.
+GVariant *SessionBusCall(const char *name, const char *path,
+                         const char *interface, const char *method,
+                         GVariant *parameters, const char *reply_type,
+                         gint timeout_ms = kSessionBusCallTimeoutMs);
+
+// Sends a method call without waiting for, or looking at, the reply.
+void SessionBusCallNoReply(const char *name, const char *path,
+                           const char *interface, const char *method,
+                           GVariant *parameters);
+
+#endif // SESSION_BUS_H_
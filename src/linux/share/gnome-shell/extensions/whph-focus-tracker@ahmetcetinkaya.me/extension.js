@@ -0,0 +1,100 @@
+// Exports the focused window on the session bus for WHPH's Linux runner
+// (src/linux/gnome_focus_tracker.h). BUS_NAME, OBJECT_PATH and the interface
+// must match GnomeFocusTracker::kBusName, kObjectPath and kInterface there.
+
+import GLib from 'gi://GLib';
+import Gio from 'gi://Gio';
+import {Extension} from 'resource:///org/gnome/shell/extensions/extension.js';
+import * as Main from 'resource:///org/gnome/shell/ui/main.js';
+
+const BUS_NAME = 'me.ahmetcetinkaya.whph.FocusTracker';
+const OBJECT_PATH = '/me/ahmetcetinkaya/whph/FocusTracker';
+
+const INTERFACE_XML = `
+<node>
+  <interface name="me.ahmetcetinkaya.whph.FocusTracker">
+    <method name="GetFocus">
+      <arg type="s" name="title" direction="out"/>
+      <arg type="s" name="app_id" direction="out"/>
+      <arg type="u" name="pid" direction="out"/>
+    </method>
+    <method name="Activate">
+      <arg type="s" name="title" direction="in"/>
+      <arg type="b" name="activated" direction="out"/>
+    </method>
+    <signal name="FocusChanged">
+      <arg type="s" name="title"/>
+      <arg type="s" name="app_id"/>
+      <arg type="u" name="pid"/>
+    </signal>
+  </interface>
+</node>`;
+
+function describe(window) {
+    if (!window)
+        return ['', '', 0];
+    return [
+        window.get_title() ?? '',
+        window.get_gtk_application_id() ?? window.get_wm_class() ?? '',
+        Math.max(window.get_pid(), 0),
+    ];
+}
+
+export default class FocusTrackerExtension extends Extension {
+    enable() {
+        this._window = null;
+        this._titleChangedId = 0;
+
+        this._object = Gio.DBusExportedObject.wrapJSObject(INTERFACE_XML, this);
+        this._object.export(Gio.DBus.session, OBJECT_PATH);
+        this._nameId = Gio.bus_own_name_on_connection(Gio.DBus.session,
+            BUS_NAME, Gio.BusNameOwnerFlags.NONE, null, null);
+
+        this._focusChangedId = global.display.connect('notify::focus-window',
+            () => this._onFocusChanged());
+        this._onFocusChanged();
+    }
+
+    disable() {
+        global.display.disconnect(this._focusChangedId);
+        this._watchTitle(null);
+        Gio.bus_unown_name(this._nameId);
+        this._object.unexport();
+        this._object = null;
+    }
+
+    GetFocus() {
+        return describe(global.display.focus_window);
+    }
+
+    Activate(title) {
+        const window = global.get_window_actors()
+            .map(actor => actor.get_meta_window())
+            .find(w => (w.get_title() ?? '').includes(title));
+        if (!window)
+            return false;
+        Main.activateWindow(window);
+        return true;
+    }
+
+    _onFocusChanged() {
+        this._watchTitle(global.display.focus_window);
+        this._emitFocusChanged();
+    }
+
+    // Follows title changes of the focused window only; others do not matter
+    // until they get focus.
+    _watchTitle(window) {
+        if (this._window && this._titleChangedId)
+            this._window.disconnect(this._titleChangedId);
+        this._window = window;
+        this._titleChangedId = window
+            ? window.connect('notify::title', () => this._emitFocusChanged())
+            : 0;
+    }
+
+    _emitFocusChanged() {
+        this._object.emit_signal('FocusChanged',
+            new GLib.Variant('(ssu)', describe(this._window)));
+    }
+}
@@ -0,0 +1,524 @@
+#include "sway_ipc.h"
+#include "window_utils.h"
+#include <glib-unix.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr char kMagic[] = "i3-ipc";
+constexpr size_t kMagicSize = sizeof(kMagic) - 1;
+constexpr size_t kHeaderSize = kMagicSize + 2 * sizeof(uint32_t);
+
+// Connects a non-blocking stream socket to path. -1 on failure.
+int ConnectSocket(const std::string &path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+    return -1;
+  }
+  memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) !=
+      0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Waits until fd is ready for events or deadline passes. Hangups count as
+// ready; the following read or write reports them.
+bool WaitFor(int fd, short events, Clock::time_point deadline) {
+  while (true) {
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - Clock::now());
+    if (remaining.count() <= 0) {
+      return false;
+    }
+    pollfd entry = {fd, events, 0};
+    int ready = poll(&entry, 1, static_cast<int>(remaining.count()));
+    if (ready > 0) {
+      return true;
+    }
+    if (ready == 0 || errno != EINTR) {
+      return false;
+    }
+  }
+}
+
+bool SendAll(int fd, const std::string &data, Clock::time_point deadline) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    // A compositor that went away must not kill us with SIGPIPE
+    ssize_t written =
+        send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (written >= 0) {
+      sent += static_cast<size_t>(written);
+    } else if (errno != EINTR &&
+               ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+                !WaitFor(fd, POLLOUT, deadline))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads from fd until a message of type is complete, skipping others.
+bool ReceiveReply(int fd, SwayIpcDecoder *decoder, uint32_t type,
+                  Clock::time_point deadline, std::string *payload) {
+  char buffer[16384];
+  SwayIpcMessage message;
+  while (true) {
+    while (decoder->Next(&message)) {
+      if (message.type == type) {
+        *payload = std::move(message.payload);
+        return true;
+      }
+    }
+    if (decoder->Failed()) {
+      return false;
+    }
+
+    ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+    if (size > 0) {
+      decoder->Feed(buffer, static_cast<size_t>(size));
+    } else if (size == 0) {
+      return false;
+    } else if (errno != EINTR && ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+                                  !WaitFor(fd, POLLIN, deadline))) {
+      return false;
+    }
+  }
+}
+
+void CollectViews(const JsonValue &container, std::vector<SwayView> *views) {
+  SwayView view;
+  if (ParseSwayView(container, &view)) {
+    views->push_back(std::move(view));
+  }
+  for (const JsonValue &child : container.Get("nodes").Items()) {
+    CollectViews(child, views);
+  }
+  for (const JsonValue &child : container.Get("floating_nodes").Items()) {
+    CollectViews(child, views);
+  }
+}
+
+std::string ToLower(std::string value) {
+  std::transform(value.begin(), value.end(), value.begin(), [](char c) {
+    return static_cast<char>(tolower(static_cast<unsigned char>(c)));
+  });
+  return value;
+}
+
+} // namespace
+
+constexpr uint32_t SwayIpcDecoder::kMaxPayloadSize;
+constexpr std::chrono::seconds SwayIpcClient::kReconnectInterval;
+constexpr std::chrono::milliseconds SwayIpcClient::kRequestTimeout;
+
+std::string EncodeSwayIpcMessage(uint32_t type, const std::string &payload) {
+  uint32_t header[2] = {static_cast<uint32_t>(payload.size()), type};
+  std::string message(kMagic, kMagicSize);
+  message.append(reinterpret_cast<const char *>(header), sizeof(header));
+  message += payload;
+  return message;
+}
+
+void SwayIpcDecoder::Feed(const char *data, size_t size) {
+  if (!failed_) {
+    buffer_.append(data, size);
+  }
+}
+
+bool SwayIpcDecoder::Next(SwayIpcMessage *message) {
+  if (failed_ || buffer_.size() < kHeaderSize) {
+    return false;
+  }
+  uint32_t header[2];
+  memcpy(header, buffer_.data() + kMagicSize, sizeof(header));
+  if (buffer_.compare(0, kMagicSize, kMagic) != 0 ||
+      header[0] > kMaxPayloadSize) {
+    failed_ = true;
+    buffer_.clear();
+    return false;
+  }
+  if (buffer_.size() - kHeaderSize < header[0]) {
+    return false;
+  }
+
+  message->type = header[1];
+  message->payload = buffer_.substr(kHeaderSize, header[0]);
+  buffer_.erase(0, kHeaderSize + header[0]);
+  return true;
+}
+
+bool ParseSwayView(const JsonValue &container, SwayView *view) {
+  std::string type = container.Get("type").AsString();
+  if (type != "con" && type != "floating_con") {
+    return false;
+  }
+  // Sway reports a PID for views only, i3 an X11 window ID
+  const JsonValue &pid = container.Get("pid");
+  if (pid.type() != JsonValue::Type::kNumber &&
+      container.Get("window").type() != JsonValue::Type::kNumber) {
+    return false;
+  }
+
+  view->id = static_cast<int64_t>(container.Get("id").AsNumber());
+  view->name = container.Get("name").AsString();
+  view->app_id = container.Get("app_id").AsString();
+  if (view->app_id.empty()) {
+    view->app_id =
+        container.Get("window_properties").Get("class").AsString();
+  }
+  view->pid = std::max(0, static_cast<int>(pid.AsNumber()));
+  view->focused = container.Get("focused").AsBool();
+  return true;
+}
+
+std::vector<SwayView> CollectSwayViews(const JsonValue &tree) {
+  std::vector<SwayView> views;
+  CollectViews(tree, &views);
+  return views;
+}
+
+const SwayView *FindSwayFocusTarget(const std::vector<SwayView> &views,
+                                    const std::string &title) {
+  if (!title.empty()) {
+    for (const SwayView &view : views) {
+      if (view.name.find(title) != std::string::npos) {
+        return &view;
+      }
+    }
+  }
+  for (const SwayView &view : views) {
+    if (ToLower(view.app_id).find("whph") != std::string::npos) {
+      return &view;
+    }
+  }
+  return nullptr;
+}
+
+bool ParseSwayWindowEvent(const std::string &payload, std::string *change,
+                          SwayView *view) {
+  JsonValue event;
+  if (!JsonValue::Parse(payload, &event)) {
+    return false;
+  }
+  *change = event.Get("change").AsString();
+  return ParseSwayView(event.Get("container"), view);
+}
+
+bool SwayCommandSucceeded(const std::string &payload) {
+  JsonValue results;
+  if (!JsonValue::Parse(payload, &results) || results.Items().empty()) {
+    return false;
+  }
+  for (const JsonValue &result : results.Items()) {
+    if (!result.Get("success").AsBool()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string SwayIpcClient::SocketPathFromEnvironment() {
+  const char *path = getenv("SWAYSOCK");
+  if (!path || !*path) {
+    path = getenv("I3SOCK");
+  }
+  return path ? path : "";
+}
+
+SwayIpcClient::SwayIpcClient(const std::string &socket_path,
+                             ChangeCallback on_change)
+    : socket_path_(socket_path), on_change_(std::move(on_change)) {
+  if (!socket_path_.empty() && !Connect()) {
+    ScheduleReconnect();
+  }
+}
+
+SwayIpcClient::~SwayIpcClient() {
+  Disconnect();
+  if (reconnect_source_id_ != 0) {
+    g_source_remove(reconnect_source_id_);
+  }
+  if (command_fd_ >= 0) {
+    close(command_fd_);
+  }
+}
+
+bool SwayIpcClient::IsActive() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return active_;
+}
+
+bool SwayIpcClient::Current(WindowInfo *info) const {
+  SwayView view;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!active_ || !has_focus_) {
+      return false;
+    }
+    view = focus_;
+  }
+
+  info->title = WindowDetector::ValidateUtf8(view.name);
+  info->application = WindowDetector::ValidateUtf8(
+      !view.app_id.empty() ? view.app_id : ReadProcessName(view.pid));
+  if (info->application.empty()) {
+    info->application = "unknown";
+  }
+  info->pid = view.pid;
+  info->backend = "sway-ipc";
+  return true;
+}
+
+std::vector<ToplevelWindow> SwayIpcClient::Windows() {
+  std::string reply;
+  JsonValue tree;
+  if (!Request(SwayIpcType::kGetTree, "", &reply) ||
+      !JsonValue::Parse(reply, &tree)) {
+    return {};
+  }
+
+  // Sway has no minimized state; scratchpad windows count as visible
+  std::vector<ToplevelWindow> windows;
+  for (const SwayView &view : CollectSwayViews(tree)) {
+    ToplevelWindow window;
+    window.title = WindowDetector::ValidateUtf8(view.name);
+    window.application = WindowDetector::ValidateUtf8(view.app_id);
+    window.pid = view.pid;
+    window.focused = view.focused;
+    windows.push_back(std::move(window));
+  }
+  return windows;
+}
+
+bool SwayIpcClient::Focus(const std::string &title) {
+  std::string reply;
+  JsonValue tree;
+  if (!Request(SwayIpcType::kGetTree, "", &reply) ||
+      !JsonValue::Parse(reply, &tree)) {
+    return false;
+  }
+  std::vector<SwayView> views = CollectSwayViews(tree);
+  const SwayView *target = FindSwayFocusTarget(views, title);
+  if (!target) {
+    return false;
+  }
+
+  // By ID, so titles need no escaping for sway's criteria syntax
+  std::string command = "[con_id=" + std::to_string(target->id) + "] focus";
+  return Request(SwayIpcType::kRunCommand, command, &reply) &&
+         SwayCommandSucceeded(reply);
+}
+
+bool SwayIpcClient::Connect() {
+  event_fd_ = ConnectSocket(socket_path_);
+  if (event_fd_ < 0) {
+    return false;
+  }
+
+  // Replies and events arrive in the order sway handled them, so the tree
+  // is older than every event after it
+  std::string greeting =
+      EncodeSwayIpcMessage(SwayIpcType::kSubscribe, "[\"window\"]") +
+      EncodeSwayIpcMessage(SwayIpcType::kGetTree, "");
+  if (!SendAll(event_fd_, greeting, Clock::now() + kRequestTimeout)) {
+    Disconnect();
+    return false;
+  }
+
+  fd_source_id_ = g_unix_fd_add(
+      event_fd_, static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR),
+      OnFdReady, this);
+  return true;
+}
+
+void SwayIpcClient::Disconnect() {
+  if (fd_source_id_ != 0) {
+    g_source_remove(fd_source_id_);
+    fd_source_id_ = 0;
+  }
+  if (event_fd_ >= 0) {
+    close(event_fd_);
+    event_fd_ = -1;
+  }
+  event_decoder_ = SwayIpcDecoder();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  active_ = false;
+  has_focus_ = false;
+}
+
+void SwayIpcClient::ScheduleReconnect() {
+  if (reconnect_source_id_ == 0) {
+    reconnect_source_id_ = g_timeout_add_seconds(
+        static_cast<guint>(kReconnectInterval.count()), OnReconnect, this);
+  }
+}
+
+bool SwayIpcClient::ProcessMessage(const SwayIpcMessage &message) {
+  switch (message.type) {
+  case SwayIpcType::kSubscribe: {
+    JsonValue reply;
+    return JsonValue::Parse(message.payload, &reply) &&
+           reply.Get("success").AsBool();
+  }
+  case SwayIpcType::kGetTree: {
+    JsonValue tree;
+    if (!JsonValue::Parse(message.payload, &tree)) {
+      return false;
+    }
+    std::vector<SwayView> views = CollectSwayViews(tree);
+    auto focused = std::find_if(views.begin(), views.end(),
+                                [](const SwayView &view) {
+                                  return view.focused;
+                                });
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      active_ = true;
+    }
+    SetFocus(focused != views.end() ? &*focused : nullptr);
+    return true;
+  }
+  case SwayIpcType::kWindowEvent: {
+    std::string change;
+    SwayView view;
+    if (!ParseSwayWindowEvent(message.payload, &change, &view)) {
+      return true;
+    }
+    bool is_focus = view.focused;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_focus = is_focus || (has_focus_ && focus_.id == view.id);
+    }
+    if (change == "focus" || (change == "title" && is_focus)) {
+      SetFocus(&view);
+    } else if (change == "close" && is_focus) {
+      // Sway sends a focus event for whatever comes next, if anything
+      SetFocus(nullptr);
+    }
+    return true;
+  }
+  default:
+    return true;
+  }
+}
+
+void SwayIpcClient::SetFocus(const SwayView *view) {
+  bool active;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_focus_ = view != nullptr;
+    focus_ = view ? *view : SwayView();
+    active = active_;
+  }
+  // Events queued ahead of the tree reply are superseded by it
+  if (active) {
+    on_change_();
+  }
+}
+
+bool SwayIpcClient::Request(uint32_t type, const std::string &payload,
+                            std::string *reply) {
+  if (socket_path_.empty()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(command_mutex_);
+  std::string message = EncodeSwayIpcMessage(type, payload);
+
+  // A connection kept from an earlier request may belong to a compositor
+  // that has since restarted; only a fresh one is trusted to fail for real
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool fresh = command_fd_ < 0;
+    if (fresh) {
+      command_fd_ = ConnectSocket(socket_path_);
+      if (command_fd_ < 0) {
+        return false;
+      }
+    }
+
+    Clock::time_point deadline = Clock::now() + kRequestTimeout;
+    SwayIpcDecoder decoder;
+    if (SendAll(command_fd_, message, deadline) &&
+        ReceiveReply(command_fd_, &decoder, type, deadline, reply)) {
+      return true;
+    }
+    // A late reply must not be taken for the next request's
+    close(command_fd_);
+    command_fd_ = -1;
+    if (fresh) {
+      return false;
+    }
+  }
+  return false;
+}
+
+gboolean SwayIpcClient::OnFdReady(gint fd, GIOCondition condition,
+                                  gpointer user_data) {
+  SwayIpcClient *self = static_cast<SwayIpcClient *>(user_data);
+
+  // Whatever arrived before a hangup is still read; recv then returns 0
+  bool ok = !(condition & G_IO_ERR);
+  char buffer[16384];
+  while (ok) {
+    ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+    if (size > 0) {
+      self->event_decoder_.Feed(buffer, static_cast<size_t>(size));
+    } else if (size == 0 || (errno != EINTR && errno != EAGAIN &&
+                             errno != EWOULDBLOCK)) {
+      ok = false;
+    } else if (errno != EINTR) {
+      break;
+    }
+  }
+
+  SwayIpcMessage message;
+  while (self->event_decoder_.Next(&message)) {
+    if (!self->ProcessMessage(message)) {
+      ok = false;
+      break;
+    }
+  }
+
+  if (!ok || self->event_decoder_.Failed()) {
+    bool was_active = self->IsActive();
+    // Returning G_SOURCE_REMOVE removes the source; don't remove it twice
+    self->fd_source_id_ = 0;
+    self->Disconnect();
+    self->ScheduleReconnect();
+    if (was_active) {
+      self->on_change_();
+    }
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean SwayIpcClient::OnReconnect(gpointer user_data) {
+  SwayIpcClient *self = static_cast<SwayIpcClient *>(user_data);
+  if (!self->Connect()) {
+    return G_SOURCE_CONTINUE;
+  }
+  // The tree reply reports the focus found after reconnecting
+  self->reconnect_source_id_ = 0;
+  return G_SOURCE_REMOVE;
+}
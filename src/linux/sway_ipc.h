@@ -0,0 +1,165 @@
+#ifndef SWAY_IPC_H_
+#define SWAY_IPC_H_
+
+#include "json_value.h"
+#include "window_detector.h"
+#include <glib.h>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Message and event types of the i3 IPC protocol, which sway implements.
+namespace SwayIpcType {
+constexpr uint32_t kRunCommand = 0;
+constexpr uint32_t kSubscribe = 2;
+constexpr uint32_t kGetTree = 4;
+// Events have the high bit set
+constexpr uint32_t kWindowEvent = 0x80000003;
+} // namespace SwayIpcType
+
+struct SwayIpcMessage {
+  uint32_t type = 0;
+  std::string payload;
+};
+
+// Frames a message: the "i3-ipc" magic, the payload length and the type as
+// 32-bit integers in native byte order, then the payload.
+std::string EncodeSwayIpcMessage(uint32_t type, const std::string &payload);
+
+// Splits the bytes read from an IPC socket into messages.
+class SwayIpcDecoder {
+public:
+  // Larger payloads are taken as a corrupt stream. Trees of a few hundred
+  // windows stay well below this.
+  static constexpr uint32_t kMaxPayloadSize = 64 * 1024 * 1024;
+
+  void Feed(const char *data, size_t size);
+
+  // Takes the next complete message. False until one is complete, and for
+  // good once the stream turned out not to be i3 IPC.
+  bool Next(SwayIpcMessage *message);
+
+  bool Failed() const { return failed_; }
+
+private:
+  std::string buffer_;
+  bool failed_ = false;
+};
+
+// A container holding an application window.
+struct SwayView {
+  int64_t id = 0;
+  std::string name;
+  // The Wayland app_id, or the class of XWayland and i3 windows.
+  std::string app_id;
+  // 0 on i3, which does not report it.
+  int pid = 0;
+  bool focused = false;
+};
+
+// The container as a view. False for outputs, workspaces and split
+// containers.
+bool ParseSwayView(const JsonValue &container, SwayView *view);
+
+// Every view in a GET_TREE reply, tiling and floating, in tree order.
+std::vector<SwayView> CollectSwayViews(const JsonValue &tree);
+
+// The view a focus request for title should go to: the first whose name
+// contains title, else WHPH's own window. nullptr if neither exists.
+const SwayView *FindSwayFocusTarget(const std::vector<SwayView> &views,
+                                    const std::string &title);
+
+// Reads a window event. change is e.g. "focus", "title" or "close"; false
+// if the event carries no view.
+bool ParseSwayWindowEvent(const std::string &payload, std::string *change,
+                          SwayView *view);
+
+// True if a RUN_COMMAND reply reports success for every command.
+bool SwayCommandSucceeded(const std::string &payload);
+
+// Follows the focused window on sway (and i3) over the compositor's IPC
+// socket, without spawning swaymsg or jq.
+//
+// One connection subscribes to window events and is read from a GLib fd
+// source on the main context; it is seeded with a GET_TREE sent right after
+// the subscription, so the focused view is known before the first event. A
+// second connection to the same socket serves GetWindows() and focus
+// requests from worker threads, so they never wait for the main loop.
+//
+// Construct and destroy on the main thread; the other methods may be called
+// from any thread except the main one.
+class SwayIpcClient {
+public:
+  static constexpr std::chrono::seconds kReconnectInterval{5};
+  // How long a request on the command connection may take.
+  static constexpr std::chrono::milliseconds kRequestTimeout{500};
+
+  // Called on the main context whenever the focused window or its title
+  // changes, and when the compositor goes away.
+  using ChangeCallback = std::function<void()>;
+
+  // $SWAYSOCK, else $I3SOCK; empty if neither is set.
+  static std::string SocketPathFromEnvironment();
+
+  // Connects to socket_path, retrying every kReconnectInterval while that
+  // fails. With an empty path the client never becomes active.
+  SwayIpcClient(const std::string &socket_path, ChangeCallback on_change);
+  ~SwayIpcClient();
+
+  SwayIpcClient(const SwayIpcClient &) = delete;
+  SwayIpcClient &operator=(const SwayIpcClient &) = delete;
+
+  // True once the subscription is confirmed and the tree has arrived, until
+  // the connection is lost.
+  bool IsActive() const;
+
+  // The focused window as of the last event. False while inactive or while
+  // no window has focus, e.g. on an empty workspace.
+  bool Current(WindowInfo *info) const;
+
+  // Every view, fetched with GET_TREE. Empty if the request fails.
+  std::vector<ToplevelWindow> Windows();
+
+  // Focuses the view FindSwayFocusTarget() picks with a
+  // "[con_id=N] focus" command. False if there is none or sway refused.
+  bool Focus(const std::string &title);
+
+private:
+  bool Connect();
+  void Disconnect();
+  void ScheduleReconnect();
+  // False if the event connection has to be dropped.
+  bool ProcessMessage(const SwayIpcMessage &message);
+  void SetFocus(const SwayView *view);
+
+  // Sends a message on the command connection and waits for the reply of
+  // the same type, reconnecting once if the connection has gone stale.
+  bool Request(uint32_t type, const std::string &payload, std::string *reply);
+
+  static gboolean OnFdReady(gint fd, GIOCondition condition,
+                            gpointer user_data);
+  static gboolean OnReconnect(gpointer user_data);
+
+  const std::string socket_path_;
+  ChangeCallback on_change_;
+
+  // Event connection, main thread only.
+  int event_fd_ = -1;
+  SwayIpcDecoder event_decoder_;
+  guint fd_source_id_ = 0;
+  guint reconnect_source_id_ = 0;
+
+  mutable std::mutex mutex_;
+  bool active_ = false;
+  bool has_focus_ = false;
+  SwayView focus_;
+
+  std::mutex command_mutex_;
+  int command_fd_ = -1;
+};
+
+#endif // SWAY_IPC_H_
@@ -24,6 +24,22 @@ std::unique_ptr<WindowDetector> WindowDetector::Create() {
   return std::make_unique<FallbackWindowDetector>();
 }
 
+void WindowDetector::SetChangeListener(ChangeListener listener) {
+  std::lock_guard<std::mutex> lock(listener_mutex_);
+  change_listener_ = std::move(listener);
+}
+
+void WindowDetector::NotifyChanged() {
+  ChangeListener listener;
+  {
+    std::lock_guard<std::mutex> lock(listener_mutex_);
+    listener = change_listener_;
+  }
+  if (listener) {
+    listener();
+  }
+}
+
 // Helper function to clean quotes from strings
 std::string WindowDetector::CleanQuotes(const std::string &input) {
   std::string result = input;
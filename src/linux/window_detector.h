@@ -1,12 +1,38 @@
 #ifndef WINDOW_DETECTOR_H_
 #define WINDOW_DETECTOR_H_
 
+#include "backend_health.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 struct WindowInfo {
   std::string title;
   std::string application;
+  // Process ID of the window's client, 0 when unknown.
+  int pid = 0;
+  // Backend that produced the result (e.g. "x11", "sway"), empty if none.
+  std::string backend;
+  // CLOCK_BOOTTIME time at which the change that led to this result
+  // happened, when the backend knows it (e.g. from an X event timestamp).
+  // Zero for polled results.
+  std::chrono::nanoseconds changed_at{0};
+};
+
+// One top-level window, as listed by WindowDetector::GetWindows().
+struct ToplevelWindow {
+  std::string title;
+  std::string application;
+  // Process ID of the window's client, 0 when unknown.
+  int pid = 0;
+  bool focused = false;
+  bool minimized = false;
 };
 
 class WindowDetector {
@@ -16,29 +42,81 @@ public:
   virtual WindowInfo GetActiveWindow() = 0;
   virtual bool FocusWindow(const std::string &windowTitle) = 0;
 
+  // Every top-level window in one batch, in the order the window manager or
+  // compositor lists them. Empty when the backend cannot list windows.
+  virtual std::vector<ToplevelWindow> GetWindows() { return {}; }
+
+  // Invoked when a backend learns that the active window or its title
+  // changed, so the caller can detect again right away instead of waiting
+  // for its next poll. May be called from any thread.
+  using ChangeListener = std::function<void()>;
+  void SetChangeListener(ChangeListener listener);
+
+  // True while the backend reports every change through the change listener,
+  // so callers only need to poll as a safety net. May be called from any
+  // thread.
+  virtual bool ReportsChanges() const { return false; }
+
   // Helper utilities (exposed for testing)
   static std::string CleanQuotes(const std::string &input);
   static std::string ValidateUtf8(const std::string &input);
+
+protected:
+  // Called by event-driven backends; a no-op when nobody listens.
+  void NotifyChanged();
+
+private:
+  std::mutex listener_mutex_;
+  ChangeListener change_listener_;
 };
 
 // X11 implementation
+class X11ClientPidResolver;
+class X11Connection;
+class X11EventWatcher;
+
 class X11WindowDetector : public WindowDetector {
 public:
+  X11WindowDetector();
+  ~X11WindowDetector() override;
+
   WindowInfo GetActiveWindow() override;
   bool FocusWindow(const std::string &windowTitle) override;
+  std::vector<ToplevelWindow> GetWindows() override;
+  bool ReportsChanges() const override;
 
   // Exposed for testing
   static std::string ParseXpropWmClass(const std::string &input);
 
 private:
-  bool IsX11Available();
+  // One display connection and atom table for the detector's lifetime. Only
+  // used with HAVE_X11.
+  std::unique_ptr<X11Connection> connection_;
+  // Window PIDs from the X server. Only used with HAVE_X11.
+  std::unique_ptr<X11ClientPidResolver> pid_resolver_;
+  // Wakes the caller on focus and title changes. Only used with HAVE_X11.
+  std::unique_ptr<X11EventWatcher> watcher_;
+  // Time of the last change reported by watcher_ that no GetActiveWindow()
+  // has picked up yet, in CLOCK_BOOTTIME nanoseconds; 0 if none.
+  std::atomic<int64_t> pending_change_{0};
 };
 
 // Wayland implementations
+class CompositorFingerprint;
+class GnomeFocusTracker;
+class GnomeIntrospectWindows;
+class KwinFocusTracker;
+class SwayIpcClient;
+
 class WaylandWindowDetector : public WindowDetector {
 public:
+  WaylandWindowDetector();
+  ~WaylandWindowDetector() override;
+
   WindowInfo GetActiveWindow() override;
   bool FocusWindow(const std::string &windowTitle) override;
+  std::vector<ToplevelWindow> GetWindows() override;
+  bool ReportsChanges() const override;
 
 private:
   WindowInfo TryGnomeWayland();
@@ -47,13 +125,60 @@ private:
   WindowInfo TryKdeWaylandScript();
   WindowInfo TryKdeWaylandDebugInfo();
   WindowInfo TryWlrootsWayland();
+  WindowInfo TryXWayland();
+
+  // Runs attempt unless backend is quarantined, and records the outcome.
+  WindowInfo TryTracked(const std::string &backend,
+                        const std::function<WindowInfo()> &attempt);
+
+  // Which of the Try* methods are worth calling in this session.
+  std::unique_ptr<CompositorFingerprint> fingerprint_;
+  // Which of them actually answer.
+  BackendHealthTracker health_;
+  // Focus pushed by the bundled GNOME Shell extension, when it runs.
+  std::unique_ptr<GnomeFocusTracker> gnome_focus_;
+  // GNOME Shell's window list through Introspect, where Shell allows it.
+  std::unique_ptr<GnomeIntrospectWindows> gnome_windows_;
+  // Focus pushed by the script loaded into KWin, once it has reported.
+  std::unique_ptr<KwinFocusTracker> kwin_focus_;
+  // Focus followed over the sway IPC socket, when $SWAYSOCK is set.
+  std::unique_ptr<SwayIpcClient> sway_;
+  // Connection to XWayland, for X11 clients on the Wayland session. Only
+  // used with HAVE_X11.
+  std::unique_ptr<X11Connection> xwayland_;
 
 public:
   static WindowInfo ParseKdeJournalOutput(const std::string &journal_out,
                                           const std::string &request_token);
-  static WindowInfo ParseGnomeEval(const std::string &title_res,
-                                   const std::string &app_res);
+  // The org.gnome.Shell.Eval result of the focus window script, a JSON
+  // array of title, application ID and PID.
+  static WindowInfo ParseGnomeEval(const std::string &json);
+  // The focused view in a sway GET_TREE reply; empty fields if none.
   static WindowInfo ParseSwayTree(const std::string &tree_json);
+  // Lines of "focused\tminimized\tpid\tapplication\ttitle" as written by
+  // jq's @tsv, booleans as true/false.
+  static std::vector<ToplevelWindow>
+  ParseWindowListTsv(const std::string &output);
+};
+
+// Incremental parser for the output of org.kde.KWin.supportInformation. Only
+// the last kContextLines lines are kept; the Resource Class and Caption of the
+// active window are taken from them once the "Active: true" line arrives.
+class KdeSupportInfoScanner {
+public:
+  static constexpr size_t kContextLines = 25;
+
+  // Returns false once the active window has been found and no further lines
+  // are needed.
+  bool AddLine(const std::string &line);
+
+  bool Found() const { return found_; }
+  const WindowInfo &Result() const { return result_; }
+
+private:
+  std::deque<std::string> recent_lines_;
+  bool found_ = false;
+  WindowInfo result_{"unknown", "unknown"};
 };
 
 // Fallback implementation
@@ -1,25 +1,69 @@
+#include "process_runner.h"
 #include "window_detector.h"
 #include "window_utils.h"
+#include <algorithm>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <vector>
 
+namespace {
+
+// Background processes that are never the foreground application.
+const char *const kExcludedProcessNames[] = {
+    "bash", "ps",       "grep",       "systemd",       "init",
+    "dbus", "journald", "pulseaudio", "NetworkManager"};
+
+// First line of `ps -eo pid,pcpu,comm` output whose command does not contain
+// one of kExcludedProcessNames.
+std::string SelectForegroundCandidate(const std::string &ps_output) {
+  std::istringstream lines(ps_output);
+  std::string line;
+  while (std::getline(lines, line)) {
+    std::istringstream fields(line);
+    std::string pid, pcpu, comm;
+    if (!(fields >> pid >> pcpu >> comm)) {
+      continue;
+    }
+    bool excluded = std::any_of(
+        std::begin(kExcludedProcessNames), std::end(kExcludedProcessNames),
+        [&comm](const char *name) {
+          return comm.find(name) != std::string::npos;
+        });
+    if (!excluded) {
+      return line;
+    }
+  }
+  return "";
+}
+
+// /proc/<pid>/cmdline with the NUL separators replaced by spaces.
+std::string ReadCmdline(const std::string &pid) {
+  std::ifstream file("/proc/" + pid + "/cmdline", std::ios::binary);
+  if (!file.is_open()) {
+    return "";
+  }
+  std::string cmdline((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  std::replace(cmdline.begin(), cmdline.end(), '\0', ' ');
+  while (!cmdline.empty() && cmdline.back() == ' ') {
+    cmdline.pop_back();
+  }
+  return cmdline;
+}
+
+} // namespace
+
 WindowInfo FallbackWindowDetector::GetActiveWindow() {
   WindowInfo info{"unknown", "unknown"};
+  info.backend = "ps";
 
   // Get top processes by CPU usage, excluding common background processes
-  std::string cmd = "ps -eo pid,pcpu,comm --sort=-pcpu | grep -v -E "
-                    "\"bash|ps|grep|systemd|init|dbus|journald|pulseaudio|"
-                    "NetworkManager\" | head -n 1";
-  std::string result = ExecuteCommand(cmd);
-
-  /*
-   We fetch information via ExecuteCommand usually, but for testing we want to
-   exercise the parsing logic. The original logic:
-   1. Get PS output: pid pcpu comm
-   2. Get cmdline output (optional)
-   */
+  std::string ps_output = RunProcessOutput(
+      {"ps", "-eo", "pid,pcpu,comm", "--sort=-pcpu", "--no-headers"});
+  std::string result = SelectForegroundCandidate(ps_output);
 
   if (!result.empty()) {
     std::string pid;
@@ -28,18 +72,13 @@ WindowInfo FallbackWindowDetector::GetActiveWindow() {
       iss >> pid;
     }
 
-    // We need 'cmdline' content (simulated here by reading the file if we are
-    // live) But for static method we pass strings. Let's refactor the live code
-    // to read strings then call Parser.
-
     std::string cmdline_content;
     if (!pid.empty()) {
-      std::string cmdline_cmd =
-          "tr '\\0' ' ' < /proc/" + pid + "/cmdline 2>/dev/null";
-      cmdline_content = ExecuteCommand(cmdline_cmd);
+      cmdline_content = ReadCmdline(pid);
     }
 
     WindowInfo parsed = ParsePsOutput(result, cmdline_content);
+    info.pid = parsed.pid;
     if (parsed.application != "unknown")
       info.application = parsed.application;
     if (parsed.title != "unknown")
@@ -60,6 +99,7 @@ FallbackWindowDetector::ParsePsOutput(const std::string &ps_output,
   std::istringstream iss(ps_output);
   std::string pid, pcpu, comm;
   if (iss >> pid >> pcpu >> comm) {
+    info.pid = std::atoi(pid.c_str());
     info.application = WindowDetector::ValidateUtf8(comm);
     info.title = WindowDetector::ValidateUtf8(
         comm); // Use process name as title fallback
@@ -86,15 +126,13 @@ FallbackWindowDetector::ParsePsOutput(const std::string &ps_output,
 // FallbackWindowDetector focus implementation
 bool FallbackWindowDetector::FocusWindow(const std::string &windowTitle) {
   // Try wmctrl as fallback
-  std::vector<std::string> commands = {
-      "wmctrl -a \"" + windowTitle + "\" 2>/dev/null",
-      "wmctrl -x -a \"whph\" 2>/dev/null",
-      "xdotool search --name \"" + windowTitle +
-          "\" windowactivate 2>/dev/null"};
+  std::vector<std::vector<std::string>> commands = {
+      {"wmctrl", "-a", windowTitle},
+      {"wmctrl", "-x", "-a", "whph"},
+      {"xdotool", "search", "--name", windowTitle, "windowactivate"}};
 
   for (const auto &command : commands) {
-    int result = system(command.c_str());
-    if (result == 0) {
+    if (RunProcessSucceeded(command)) {
       return true;
     }
   }
@@ -1,131 +1,297 @@
+#include "compositor_fingerprint.h"
+#include "gnome_focus_tracker.h"
+#include "gnome_introspect_windows.h"
+#include "kwin_focus_tracker.h"
+#include "json_value.h"
+#include "process_runner.h"
+#include "session_bus.h"
+#include "sway_ipc.h"
 #include "window_detector.h"
 #include "window_utils.h"
+#include "x11_connection.h"
+#include "x11_property_fetch.h"
 #include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <vector>
 
-WindowInfo WaylandWindowDetector::GetActiveWindow() {
-  WindowInfo info = TryGnomeWayland();
-  if (info.title != "unknown" || info.application != "unknown") {
-    return info;
+namespace {
+
+constexpr const char *kKwinBusName = "org.kde.KWin";
+constexpr const char *kKwinScriptingInterface = "org.kde.kwin.Scripting";
+// supportInformation builds a dump of hundreds of KB before replying.
+constexpr gint kSupportInformationTimeoutMs = 5000;
+
+// Title, application ID and PID of the focused window in a single Eval, as
+// a JSON array; null if nothing has focus.
+constexpr const char *kGnomeFocusWindowScript =
+    "(() => { const w = global.display.focus_window; "
+    "return w ? [w.get_title(), "
+    "w.get_gtk_application_id() || w.get_wm_class(), w.get_pid()] : null; "
+    "})()";
+
+// Runs a script through org.gnome.Shell.Eval. True if Shell ran it, in which
+// case *result receives the JSON of its value.
+bool GnomeShellEval(const std::string &script, std::string *result) {
+  GVariant *reply = SessionBusCall(
+      "org.gnome.Shell", "/org/gnome/Shell", "org.gnome.Shell", "Eval",
+      g_variant_new("(s)", script.c_str()), "(bs)");
+  if (!reply) {
+    return false;
   }
+  gboolean success = FALSE;
+  const gchar *value = nullptr;
+  g_variant_get(reply, "(b&s)", &success, &value);
+  result->assign(value);
+  g_variant_unref(reply);
+  return success;
+}
 
-  info = TrySwayWayland();
-  if (info.title != "unknown" || info.application != "unknown") {
-    return info;
+// Loads the script at path under plugin_name and starts it. False if KWin
+// refused either step.
+bool RunKwinScript(const std::string &path, const char *plugin_name) {
+  GVariant *loaded = SessionBusCall(
+      kKwinBusName, "/Scripting", kKwinScriptingInterface, "loadScript",
+      g_variant_new("(ss)", path.c_str(), plugin_name), "(i)");
+  if (!loaded) {
+    return false;
   }
+  g_variant_unref(loaded);
 
-  info = TryKdeWayland();
-  if (info.title != "unknown" || info.application != "unknown") {
-    return info;
+  GVariant *started = SessionBusCall(kKwinBusName, "/Scripting",
+                                     kKwinScriptingInterface, "start",
+                                     nullptr, "()");
+  if (!started) {
+    return false;
   }
+  g_variant_unref(started);
+  return true;
+}
 
-  info = TryWlrootsWayland();
-  if (info.title != "unknown" || info.application != "unknown") {
-    return info;
+void UnloadKwinScript(const char *plugin_name) {
+  SessionBusCallNoReply(kKwinBusName, "/Scripting", kKwinScriptingInterface,
+                        "unloadScript", g_variant_new("(s)", plugin_name));
+}
+
+// XWayland's active window through xprop, for builds without Xlib and
+// sandboxes without access to the X socket.
+WindowInfo XpropXWaylandWindow() {
+  WindowInfo info{"unknown", "unknown"};
+
+  bool has_xprop = IsRunningInFlatpak()
+                       ? RunProcessSucceeded(HostCommand({"which", "xprop"}))
+                       : CommandExists("xprop");
+  if (has_xprop) {
+    // Output: "_NET_ACTIVE_WINDOW(WINDOW): window id # 0x1234567"
+    std::string root_prop =
+        RunProcessOutput(HostCommand({"xprop", "-root", "_NET_ACTIVE_WINDOW"}));
+    size_t id_pos = root_prop.rfind(' ');
+    std::string xprop_result =
+        id_pos != std::string::npos ? root_prop.substr(id_pos + 1) : "";
+
+    if (!xprop_result.empty() && xprop_result != "0x0" &&
+        xprop_result.find("0x") != std::string::npos) {
+      std::string raw_title = RunProcessOutput(
+          HostCommand({"xprop", "-id", xprop_result, "WM_NAME"}));
+      std::string raw_class = RunProcessOutput(
+          HostCommand({"xprop", "-id", xprop_result, "WM_CLASS"}));
+
+      bool title_ok = !raw_title.empty() &&
+                      raw_title.find("not found") == std::string::npos &&
+                      raw_title.find("no such property") == std::string::npos;
+      bool class_ok = !raw_class.empty() &&
+                      raw_class.find("not found") == std::string::npos &&
+                      raw_class.find("no such property") == std::string::npos &&
+                      raw_class.find("\"") != std::string::npos;
+
+      if (title_ok) {
+        std::string title = "";
+        size_t first_quote = raw_title.find('"');
+        if (first_quote != std::string::npos) {
+          size_t last_quote = raw_title.rfind('"');
+          if (last_quote > first_quote) {
+            title =
+                raw_title.substr(first_quote + 1, last_quote - first_quote - 1);
+          }
+        }
+
+        std::string app_class = "";
+        if (class_ok) {
+          size_t last_quote = raw_class.rfind('"');
+          if (last_quote != std::string::npos) {
+            size_t prev_quote = raw_class.rfind('"', last_quote - 1);
+            if (prev_quote != std::string::npos) {
+              app_class =
+                  raw_class.substr(prev_quote + 1, last_quote - prev_quote - 1);
+            }
+          }
+        }
+
+        if (!title.empty()) {
+          info.title = WindowDetector::ValidateUtf8(title);
+          info.application = WindowDetector::ValidateUtf8(
+              !app_class.empty() ? app_class : title);
+          return info;
+        }
+      }
+    }
   }
 
+  return info;
+}
+
+} // namespace
+
+WaylandWindowDetector::WaylandWindowDetector()
+    : fingerprint_(std::make_unique<CompositorFingerprint>()),
+      gnome_focus_(std::make_unique<GnomeFocusTracker>(
+          SessionBus(), [this] { NotifyChanged(); })),
+      gnome_windows_(std::make_unique<GnomeIntrospectWindows>(
+          SessionBus(), [this] { NotifyChanged(); })),
+      kwin_focus_(std::make_unique<KwinFocusTracker>(
+          SessionBus(), [this] { NotifyChanged(); })),
+      sway_(std::make_unique<SwayIpcClient>(
+          SwayIpcClient::SocketPathFromEnvironment(),
+          [this] { NotifyChanged(); })),
+      xwayland_(std::make_unique<X11Connection>()) {}
+
+WaylandWindowDetector::~WaylandWindowDetector() = default;
+
+bool WaylandWindowDetector::ReportsChanges() const {
+  return gnome_focus_->IsActive() || gnome_windows_->IsActive() ||
+         kwin_focus_->IsActive() || sway_->IsActive();
+}
+
+WindowInfo WaylandWindowDetector::GetActiveWindow() {
+  std::vector<WaylandBackend> plan = fingerprint_->Plan();
+  std::vector<std::string> names;
+  for (WaylandBackend backend : plan) {
+    names.push_back(WaylandBackendName(backend));
+  }
+
+  // Last working backend first, quarantined ones skipped
+  for (const std::string &name :
+       health_.Order(names, BackendHealthTracker::Clock::now())) {
+    WaylandBackend backend =
+        plan[std::find(names.begin(), names.end(), name) - names.begin()];
+    WindowInfo info = TryTracked(name, [this, backend] {
+      switch (backend) {
+      case WaylandBackend::kGnomeShell:
+        return TryGnomeWayland();
+      case WaylandBackend::kSway:
+        return TrySwayWayland();
+      case WaylandBackend::kKwin:
+        return TryKdeWayland();
+      case WaylandBackend::kWlroots:
+        return TryWlrootsWayland();
+      }
+      return WindowInfo{"unknown", "unknown"};
+    });
+
+    if (info.title != "unknown" || info.application != "unknown") {
+      if (info.backend.empty()) {
+        info.backend = name;
+      }
+      return info;
+    }
+  }
+
+  fingerprint_->ReportFailure();
   return {"unknown", "unknown"};
 }
 
+WindowInfo
+WaylandWindowDetector::TryTracked(const std::string &backend,
+                                  const std::function<WindowInfo()> &attempt) {
+  auto start = BackendHealthTracker::Clock::now();
+  if (!health_.ShouldTry(backend, start)) {
+    return {"unknown", "unknown"};
+  }
+
+  WindowInfo info = attempt();
+
+  auto end = BackendHealthTracker::Clock::now();
+  if (info.title != "unknown" || info.application != "unknown") {
+    health_.RecordSuccess(backend, end - start);
+  } else {
+    health_.RecordFailure(backend, end - start, end);
+  }
+  return info;
+}
+
 WindowInfo WaylandWindowDetector::TryGnomeWayland() {
   WindowInfo info{"unknown", "unknown"};
 
+  // Both are kept current by signals, so their answers need no round trip.
+  // The extension also knows the PID, and sees focus move within an app.
+  if (gnome_focus_->Current(&info) || gnome_windows_->Current(&info)) {
+    return info;
+  }
+
   // In Flatpak, pgrep won't work. Just try to call GNOME Shell via D-Bus.
   // If it fails, we assume GNOME Shell is not running or not accessible.
+  std::string result;
+  if (!GnomeShellEval(kGnomeFocusWindowScript, &result)) {
+    return info;
+  }
 
-  // Get window title
-  std::string title_cmd =
-      "gdbus call --session --dest org.gnome.Shell --object-path "
-      "/org/gnome/Shell --method org.gnome.Shell.Eval "
-      "\"global.display.focus_window?.get_title()\" 2>/dev/null";
-  std::string title_result = ExecuteCommand(title_cmd);
-
-  // Get application ID
-  std::string app_cmd =
-      "gdbus call --session --dest org.gnome.Shell --object-path "
-      "/org/gnome/Shell --method org.gnome.Shell.Eval "
-      "\"global.display.focus_window?.get_gtk_application_id() || "
-      "global.display.focus_window?.get_wm_class()\" 2>/dev/null";
-  std::string app_result = ExecuteCommand(app_cmd);
-
-  WindowInfo parsed = ParseGnomeEval(title_result, app_result);
+  WindowInfo parsed = ParseGnomeEval(result);
   if (!parsed.title.empty())
     info.title = parsed.title;
   if (!parsed.application.empty())
     info.application = parsed.application;
+  info.pid = parsed.pid;
 
   return info;
 }
 
 WindowInfo WaylandWindowDetector::TrySwayWayland() {
+  // Kept current by window events, so the answer needs no round trip
   WindowInfo info{"unknown", "unknown"};
-
-  // In Flatpak, pgrep won't work.
-  // Check if swaymsg is available.
-  if (ExecuteCommand("which swaymsg 2>/dev/null").empty()) {
-    return info;
-  }
-
-  std::string cmd = "swaymsg -t get_tree 2>/dev/null | jq -r '.. | "
-                    "select(.focused? == true)' 2>/dev/null";
-  std::string result = ExecuteCommand(cmd);
-
-  if (!result.empty()) {
-    // Extract title
-    std::string title_cmd = "echo '" + result + "' | jq -r '.name' 2>/dev/null";
-    info.title = WindowDetector::ValidateUtf8(ExecuteCommand(title_cmd));
-
-    // Extract app_id
-    std::string app_cmd =
-        "echo '" + result +
-        "' | jq -r '.app_id // .window_properties.class' 2>/dev/null";
-    info.application = WindowDetector::ValidateUtf8(ExecuteCommand(app_cmd));
-
-    // Fallback to PID if app_id is null
-    if (info.application == "null" || info.application.empty()) {
-      std::string pid_cmd = "echo '" + result + "' | jq -r '.pid' 2>/dev/null";
-      std::string pid = ExecuteCommand(pid_cmd);
-      if (!pid.empty() && pid != "null") {
-        std::string comm_cmd = "cat /proc/" + pid + "/comm 2>/dev/null";
-        info.application =
-            WindowDetector::ValidateUtf8(ExecuteCommand(comm_cmd));
-      }
-    }
-  }
-
+  sway_->Current(&info);
   return info;
 }
 
 WindowInfo WaylandWindowDetector::TryKdeWayland() {
-  // Priority 1: KWin Scripting (Most robust for native Wayland)
-  WindowInfo info = TryKdeWaylandScript();
+  // The tracker script reports every change, so its answer needs no round
+  // trip
+  WindowInfo info;
+  if (kwin_focus_->Current(&info)) {
+    return info;
+  }
+
+  // Priority 1: One-shot KWin script, until the tracker script has
+  // reported. Fails on every call where journalctl is missing, which the
+  // health tracker notices.
+  info =
+      TryTracked("kwin-script", [this] { return TryKdeWaylandScript(); });
   if (info.application != "unknown") {
+    info.backend = "kwin-script";
     return info;
   }
 
   // Priority 2: supportInformation Parsing (Fallback)
-  return TryKdeWaylandDebugInfo();
+  info = TryTracked("kwin-support-info",
+                    [this] { return TryKdeWaylandDebugInfo(); });
+  info.backend = "kwin-support-info";
+  return info;
 }
 
 WindowInfo WaylandWindowDetector::TryKdeWaylandScript() {
   WindowInfo info{"unknown", "unknown"};
 
   // Logic:
-  // 1. Write a KWin script to /tmp.
-  // 2. Load it via DBus (gdbus).
-  // 3. Start it (executes the script logic).
-  // 4. Script prints active window details to journal.
-  // 5. Grep journal for output.
-  // 6. Unload script.
-
-  // Check if we are inside Flatpak by checking for .flatpak-info
-  bool has_flatpak_spawn = (system("test -f /.flatpak-info") == 0);
-  std::string prefix =
-      has_flatpak_spawn ? "/usr/bin/flatpak-spawn --host " : "";
+  // 1. Write a KWin script where KWin can read it.
+  // 2. Load and start it over D-Bus.
+  // 3. Script prints active window details to journal.
+  // 4. Read the journal for output.
+  // 5. Unload script.
+  const char *plugin_name = "whph_detector_v1";
 
   // Unique delimiter to avoid parsing issues
   std::string delim = "WHPH_KWIN_da39a3ee";
@@ -142,41 +308,34 @@ WindowInfo WaylandWindowDetector::TryKdeWaylandScript() {
                                "|null|null'); "
                                "}";
 
-  // Composite Shell Command
-  std::string cmd =
-      prefix +
-      "sh -c \""
-      // 1. Write Script
-      "echo \\\"" +
-      script_content +
-      "\\\" > /tmp/whph_kwin.js; "
-      // 2. Unload previous if stuck
-      "gdbus call --session --dest org.kde.KWin --object-path /Scripting "
-      "--method org.kde.kwin.Scripting.unloadScript 'whph_detector_v1' "
-      ">/dev/null 2>&1; "
-      // 3. Load Script
-      "gdbus call --session --dest org.kde.KWin --object-path /Scripting "
-      "--method org.kde.kwin.Scripting.loadScript '/tmp/whph_kwin.js' "
-      "'whph_detector_v1' >/dev/null; "
-      // 4. Start
-      "gdbus call --session --dest org.kde.KWin --object-path /Scripting "
-      "--method org.kde.kwin.Scripting.start >/dev/null; "
-      // 5. Sleep
-      "sleep 0.1; "
-      // 6. Read Log
-      "if command -v journalctl >/dev/null 2>&1; then journalctl --user "
-      "--no-pager -n 50 | grep '" +
-      delim +
-      "' | tail -1; fi; "
-      // 7. Cleanup
-      "gdbus call --session --dest org.kde.KWin --object-path /Scripting "
-      "--method org.kde.kwin.Scripting.unloadScript 'whph_detector_v1' "
-      ">/dev/null; "
-      "rm -f /tmp/whph_kwin.js"
-      "\"";
-
-  std::string output = ExecuteCommand(cmd);
-  // Debug logs removed for production
+  std::string script_path = KwinScriptPath("whph_kwin.js");
+  if (!WriteKwinScript(script_path, script_content)) {
+    return info;
+  }
+
+  // Unload previous if stuck
+  GVariant *unloaded = SessionBusCall(kKwinBusName, "/Scripting",
+                                      kKwinScriptingInterface, "unloadScript",
+                                      g_variant_new("(s)", plugin_name), "(b)");
+  if (unloaded) {
+    g_variant_unref(unloaded);
+  }
+
+  std::string output;
+  if (RunKwinScript(script_path, plugin_name)) {
+    g_usleep(100 * 1000);
+    RunProcessLines(
+        HostCommand({"journalctl", "--user", "--no-pager", "-n", "50"}),
+        [&output, &delim](const std::string &line) {
+          if (line.find(delim) != std::string::npos) {
+            output = line;
+          }
+          return true;
+        });
+  }
+
+  UnloadKwinScript(plugin_name);
+  std::remove(script_path.c_str());
 
   if (!output.empty()) {
     return ParseKdeJournalOutput(output, delim);
@@ -228,159 +387,91 @@ WaylandWindowDetector::ParseKdeJournalOutput(const std::string &journal_out,
   return info;
 }
 
-WindowInfo WaylandWindowDetector::TryKdeWaylandDebugInfo() {
-  WindowInfo info{"unknown", "unknown"};
+constexpr size_t KdeSupportInfoScanner::kContextLines;
 
-  // Method 1: Use supportInformation method (built-in KWin debug info)
-  // We utilize host-side grep to avoid truncating the massive output in the
-  // dbus/flatpak buffer.
-  std::string output;
+bool KdeSupportInfoScanner::AddLine(const std::string &line) {
+  if (found_) {
+    return false;
+  }
 
-  bool has_flatpak_spawn = (system("test -f /.flatpak-info") == 0);
-
-  if (has_flatpak_spawn) {
-    // Construct command: qdbus ... | grep ...
-    // We look for "Active: true" and 25 lines before it to capture Class and
-    // Caption. We wrap in sh -c to use pipes on host.
-    std::string host_cmd = "flatpak-spawn --host sh -c \"qdbus org.kde.KWin "
-                           "/KWin org.kde.KWin.supportInformation 2>/dev/null "
-                           "| grep -i -B 25 'Active: true'\"";
-    output = ExecuteCommand(host_cmd);
-
-    if (output.empty()) {
-      // Fallback to gdbus if qdbus is missing
-      host_cmd = "flatpak-spawn --host sh -c \"gdbus call --session --dest "
-                 "org.kde.KWin --object-path /KWin --method "
-                 "org.kde.KWin.supportInformation 2>/dev/null | grep -i -B 25 "
-                 "'Active: true'\"";
-      output = ExecuteCommand(host_cmd);
+  // "Active: true" marker
+  if (line.find("Active: true") == std::string::npos &&
+      line.find("active: true") == std::string::npos) {
+    recent_lines_.push_back(line);
+    if (recent_lines_.size() > kContextLines) {
+      recent_lines_.pop_front();
     }
-  } else {
-    std::string cmd = "gdbus call --session --dest org.kde.KWin --object-path "
-                      "/KWin --method org.kde.KWin.supportInformation";
-    output = ExecuteCommand(cmd);
+    return true;
   }
 
-  if (!output.empty()) {
-    std::string unescaped = output;
-
-    // If output looks like GVariant (starting with (' ), unescape it.
-    if (output.rfind("('", 0) == 0) {
-      unescaped = UnescapeGVariantString(output);
+  // The nearest preceding values belong to the active window
+  auto value_of = [](const std::string &field_line) {
+    std::string value = field_line.substr(field_line.find(':') + 1);
+    value.erase(0, value.find_first_not_of(" \t"));
+    value.erase(value.find_last_not_of(" \t") + 1);
+    return value;
+  };
+  bool has_app = false;
+  bool has_title = false;
+  std::string app;
+  std::string title;
+  for (auto it = recent_lines_.rbegin();
+       it != recent_lines_.rend() && !(has_app && has_title); ++it) {
+    if (!has_app && it->find("Resource Class:") != std::string::npos) {
+      app = value_of(*it);
+      has_app = true;
+    } else if (!has_title && it->find("Caption:") != std::string::npos) {
+      title = value_of(*it);
+      has_title = true;
     }
+  }
 
-    // Parse loop
-    std::istringstream stream(unescaped);
-    std::string line;
-    std::string current_app = "";
-    std::string current_title = "";
-
-    while (std::getline(stream, line)) {
-      if (line.find("Resource Class:") != std::string::npos) {
-        size_t pos = line.find(":");
-        if (pos != std::string::npos) {
-          current_app = line.substr(pos + 1);
-          current_app.erase(0, current_app.find_first_not_of(" \t"));
-          current_app.erase(current_app.find_last_not_of(" \t") + 1);
-        }
-      }
-
-      if (line.find("Caption:") != std::string::npos) {
-        size_t pos = line.find(":");
-        if (pos != std::string::npos) {
-          current_title = line.substr(pos + 1);
-          current_title.erase(0, current_title.find_first_not_of(" \t"));
-          current_title.erase(current_title.find_last_not_of(" \t") + 1);
-        }
-      }
+  result_.application = WindowDetector::ValidateUtf8(app);
+  result_.title = WindowDetector::ValidateUtf8(title);
+  found_ = true;
+  recent_lines_.clear();
+  return false;
+}
 
-      // "Active: true" marker
-      if (line.find("Active: true") != std::string::npos ||
-          line.find("active: true") != std::string::npos) {
+WindowInfo WaylandWindowDetector::TryKdeWaylandDebugInfo() {
+  WindowInfo info{"unknown", "unknown"};
 
-        info.application = current_app;
-        info.title = current_title;
-        return info;
+  // Method 1: Use supportInformation method (built-in KWin debug info).
+  // The dump is often hundreds of KB; it is scanned in place, line by line,
+  // until the active window is found.
+  KdeSupportInfoScanner scanner;
+  GVariant *reply =
+      SessionBusCall(kKwinBusName, "/KWin", "org.kde.KWin",
+                     "supportInformation", nullptr, "(s)",
+                     kSupportInformationTimeoutMs);
+  if (reply) {
+    const gchar *dump = nullptr;
+    g_variant_get(reply, "(&s)", &dump);
+    for (const char *line = dump; line;) {
+      const char *newline = strchr(line, '\n');
+      std::string text = newline ? std::string(line, newline - line) : line;
+      if (!scanner.AddLine(text)) {
+        break;
       }
+      line = newline ? newline + 1 : nullptr;
     }
+    g_variant_unref(reply);
   }
 
-  // Method 2: Try using xprop even on Wayland (sometimes works with XWayland)
-  std::string check_xprop = has_flatpak_spawn
-                                ? "flatpak-spawn --host which xprop 2>/dev/null"
-                                : "which xprop 2>/dev/null";
-  if (!ExecuteCommand(check_xprop).empty()) {
-    std::string xprop_cmd =
-        has_flatpak_spawn
-            ? "flatpak-spawn --host xprop -root _NET_ACTIVE_WINDOW 2>/dev/null "
-              "| cut -d' ' -f5"
-            : "xprop -root _NET_ACTIVE_WINDOW 2>/dev/null | cut -d' ' -f5";
-
-    std::string xprop_result = ExecuteCommand(xprop_cmd);
-
-    if (!xprop_result.empty() && xprop_result != "0x0" &&
-        xprop_result.find("0x") != std::string::npos) {
-      std::string title_cmd, class_cmd;
-      if (has_flatpak_spawn) {
-        title_cmd = "flatpak-spawn --host xprop -id " +
-                    ShellEscape(xprop_result) + " WM_NAME 2>/dev/null";
-        class_cmd = "flatpak-spawn --host xprop -id " +
-                    ShellEscape(xprop_result) + " WM_CLASS 2>/dev/null";
-      } else {
-        title_cmd =
-            "xprop -id " + ShellEscape(xprop_result) + " WM_NAME 2>/dev/null";
-        class_cmd =
-            "xprop -id " + ShellEscape(xprop_result) + " WM_CLASS 2>/dev/null";
-      }
-
-      std::string raw_title = ExecuteCommand(title_cmd);
-      std::string raw_class = ExecuteCommand(class_cmd);
-
-      bool title_ok = !raw_title.empty() &&
-                      raw_title.find("not found") == std::string::npos &&
-                      raw_title.find("no such property") == std::string::npos;
-      bool class_ok = !raw_class.empty() &&
-                      raw_class.find("not found") == std::string::npos &&
-                      raw_class.find("no such property") == std::string::npos &&
-                      raw_class.find("\"") != std::string::npos;
-
-      if (title_ok) {
-        std::string title = "";
-        size_t first_quote = raw_title.find('"');
-        if (first_quote != std::string::npos) {
-          size_t last_quote = raw_title.rfind('"');
-          if (last_quote > first_quote) {
-            title =
-                raw_title.substr(first_quote + 1, last_quote - first_quote - 1);
-          }
-        }
-
-        std::string app_class = "";
-        if (class_ok) {
-          size_t last_quote = raw_class.rfind('"');
-          if (last_quote != std::string::npos) {
-            size_t prev_quote = raw_class.rfind('"', last_quote - 1);
-            if (prev_quote != std::string::npos) {
-              app_class =
-                  raw_class.substr(prev_quote + 1, last_quote - prev_quote - 1);
-            }
-          }
-        }
+  if (scanner.Found()) {
+    return scanner.Result();
+  }
 
-        if (!title.empty()) {
-          info.title = WindowDetector::ValidateUtf8(title);
-          info.application = WindowDetector::ValidateUtf8(
-              !app_class.empty() ? app_class : title);
-          return info;
-        }
-      }
-    }
+  // Method 2: The active window may be an XWayland client
+  info = TryXWayland();
+  if (info.title != "unknown") {
+    return info;
   }
 
   // Method 3: Process-based detection via host heuristics
   // This is a last resort for native Wayland apps that don't expose info via
   // KWin.
-  if (has_flatpak_spawn) {
+  if (IsRunningInFlatpak()) {
     std::vector<std::string> gui_process_commands = {
         // Check for common GUI apps in list, sorted by start time (most recent
         // last)
@@ -421,21 +512,42 @@ WindowInfo WaylandWindowDetector::TryKdeWaylandDebugInfo() {
   return info;
 }
 
+WindowInfo WaylandWindowDetector::TryXWayland() {
+#ifdef HAVE_X11
+  // XWayland clients are ordinary X11 clients: read their properties over a
+  // persistent connection, one round trip instead of four xprop spawns
+  if (getenv("DISPLAY") && xwayland_->Get()) {
+    WindowInfo info{"unknown", "unknown"};
+    X11WindowProperties properties;
+    if (FetchWindowProperties(*xwayland_, FetchActiveWindow(*xwayland_),
+                              &properties) &&
+        !properties.title.empty()) {
+      info.title = WindowDetector::ValidateUtf8(properties.title);
+      info.application = WindowDetector::ValidateUtf8(
+          !properties.wm_class.empty() ? properties.wm_class
+                                       : properties.title);
+      info.pid = properties.pid;
+    }
+    return info;
+  }
+#endif
+  return XpropXWaylandWindow();
+}
+
 WindowInfo WaylandWindowDetector::TryWlrootsWayland() {
   WindowInfo info{"unknown", "unknown"};
 
   // Try Hyprland
-  if (!ExecuteCommand("which hyprctl 2>/dev/null").empty()) {
-    std::string cmd = "hyprctl activewindow -j 2>/dev/null";
-    std::string result = ExecuteCommand(cmd);
+  if (CommandExists("hyprctl")) {
+    std::string result = RunProcessOutput({"hyprctl", "activewindow", "-j"});
 
-    if (!result.empty() && !ExecuteCommand("which jq 2>/dev/null").empty()) {
+    if (!result.empty() && CommandExists("jq")) {
       std::string title_cmd =
-          "echo '" + result + "' | jq -r '.title' 2>/dev/null";
+          "echo " + ShellEscape(result) + " | jq -r '.title' 2>/dev/null";
       info.title = WindowDetector::ValidateUtf8(ExecuteCommand(title_cmd));
 
       std::string class_cmd =
-          "echo '" + result + "' | jq -r '.class' 2>/dev/null";
+          "echo " + ShellEscape(result) + " | jq -r '.class' 2>/dev/null";
       info.application =
           WindowDetector::ValidateUtf8(ExecuteCommand(class_cmd));
 
@@ -446,183 +558,202 @@ WindowInfo WaylandWindowDetector::TryWlrootsWayland() {
   }
 
   // Try wayinfo for river and other wlroots compositors
-  if (!ExecuteCommand("which wayinfo 2>/dev/null").empty()) {
+  if (CommandExists("wayinfo")) {
     info.title = WindowDetector::ValidateUtf8(
-        ExecuteCommand("wayinfo active-window-title 2>/dev/null"));
+        RunProcessOutput({"wayinfo", "active-window-title"}));
     info.application = WindowDetector::ValidateUtf8(
-        ExecuteCommand("wayinfo active-window-app-id 2>/dev/null"));
+        RunProcessOutput({"wayinfo", "active-window-app-id"}));
   }
 
   return info;
 }
 
+std::vector<ToplevelWindow> WaylandWindowDetector::GetWindows() {
+  // GNOME Shell lists its windows through Introspect, sway and Hyprland over
+  // their IPC. KWin offers no listing outside of scripts, and the wlr foreign
+  // toplevel protocol would need a Wayland client of our own.
+  for (WaylandBackend backend : fingerprint_->Plan()) {
+    if (backend == WaylandBackend::kGnomeShell && gnome_windows_->IsActive()) {
+      return gnome_windows_->Windows();
+    }
+    if (backend == WaylandBackend::kSway && sway_->IsActive()) {
+      return sway_->Windows();
+    }
+    if (!CommandExists("jq")) {
+      continue;
+    }
+
+    std::string output;
+    if (backend == WaylandBackend::kWlroots && CommandExists("hyprctl")) {
+      output = ExecuteCommand(
+          "hyprctl clients -j 2>/dev/null | jq -r '.[] | "
+          "[(.focusHistoryID == 0 | tostring), (.hidden | tostring), "
+          "(.pid | tostring), .class, .title] | @tsv' 2>/dev/null");
+    }
+
+    std::vector<ToplevelWindow> windows = ParseWindowListTsv(output);
+    if (!windows.empty()) {
+      return windows;
+    }
+  }
+  return {};
+}
+
 // WaylandWindowDetector focus implementation
 bool WaylandWindowDetector::FocusWindow(const std::string &windowTitle) {
-  // Detect which compositor is running and use appropriate method
+  // Only compositors found by the fingerprint are tried
 
   // Try GNOME/Mutter first
-  if (!ExecuteCommand("pgrep -f gnome-shell 2>/dev/null").empty()) {
-    std::string gnome_cmd =
-        "gdbus call --session --dest org.gnome.Shell --object-path "
-        "/org/gnome/Shell --method org.gnome.Shell.Eval "
-        "\"global.get_window_actors().find(w => "
-        "w.get_meta_window().get_title().includes('" +
-        windowTitle +
-        "')).get_meta_window().activate(global.get_current_time())\" "
-        "2>/dev/null";
-    if (system(gnome_cmd.c_str()) == 0) {
+  if (fingerprint_->Includes(WaylandBackend::kGnomeShell)) {
+    if (gnome_focus_->Activate(windowTitle)) {
+      return true;
+    }
+
+    std::string gnome_script =
+        "global.get_window_actors().find(w => "
+        "w.get_meta_window().get_title().includes(" +
+        JsString(windowTitle) +
+        ")).get_meta_window().activate(global.get_current_time())";
+    std::string result;
+    if (GnomeShellEval(gnome_script, &result)) {
       return true;
     }
 
     // Fallback for GNOME
     std::string gnome_fallback =
-        "gdbus call --session --dest org.gnome.Shell --object-path "
-        "/org/gnome/Shell --method org.gnome.Shell.Eval "
-        "\"global.get_window_actors().find(w => "
+        "global.get_window_actors().find(w => "
         "w.get_meta_window().get_wm_class().toLowerCase().includes('whph'))."
-        "get_meta_window().activate(global.get_current_time())\" 2>/dev/null";
-    if (system(gnome_fallback.c_str()) == 0) {
+        "get_meta_window().activate(global.get_current_time())";
+    if (GnomeShellEval(gnome_fallback, &result)) {
       return true;
     }
   }
 
   // Try Sway
-  if (!ExecuteCommand("pgrep -f sway 2>/dev/null").empty()) {
-    std::vector<std::string> sway_commands = {
-        "swaymsg '[title=\"" + windowTitle + "\"] focus' 2>/dev/null",
-        "swaymsg '[app_id=\"whph\"] focus' 2>/dev/null",
-        "swaymsg '[class=\"whph\"] focus' 2>/dev/null"};
-
-    for (const auto &cmd : sway_commands) {
-      if (system(cmd.c_str()) == 0) {
-        return true;
-      }
+  if (fingerprint_->Includes(WaylandBackend::kSway)) {
+    if (sway_->Focus(windowTitle)) {
+      return true;
     }
   }
 
   // Try KDE/KWin with safer methods
-  if (!ExecuteCommand("pgrep -f plasmashell 2>/dev/null").empty()) {
-    // Method 1: Try using wmctrl first (sometimes works on KDE Wayland)
-    std::vector<std::string> wmctrl_commands = {
-        "wmctrl -a \"" + windowTitle + "\" 2>/dev/null",
-        "wmctrl -x -a \"whph\" 2>/dev/null"};
-
-    for (const auto &cmd : wmctrl_commands) {
-      if (system(cmd.c_str()) == 0) {
-        return true;
-      }
+  if (fingerprint_->Includes(WaylandBackend::kKwin)) {
+    // Method 1: Ask the tracker script loaded into KWin
+    if (kwin_focus_->Activate(windowTitle)) {
+      return true;
     }
 
-    // Method 2: Try KWin D-Bus methods if available
-    if (!ExecuteCommand("which qdbus 2>/dev/null").empty()) {
-      // Check if KWin scripting is available
-      std::string kwin_check =
-          ExecuteCommand("qdbus org.kde.KWin /Scripting 2>/dev/null");
-      if (!kwin_check.empty()) {
-        // Create a temporary script file for window focusing
-        std::string temp_script = "/tmp/kwin_focus_window.js";
-        std::string script_content =
-            "var clients = workspace.clientList();\n"
-            "for (var i = 0; i < clients.length; i++) {\n"
-            "    var client = clients[i];\n"
-            "    if (client.caption.indexOf('" +
-            windowTitle +
-            "') !== -1 || \n"
-            "        client.resourceClass.indexOf('whph') !== -1) {\n"
-            "        workspace.activeClient = client;\n"
-            "        client.desktop = workspace.currentDesktop;\n"
-            "        break;\n"
-            "    }\n"
-            "}\n";
-
-        std::ofstream script_file(temp_script);
-        if (script_file.is_open()) {
-          script_file << script_content;
-          script_file.close();
-
-          // Load and run the script
-          std::string load_cmd = "qdbus org.kde.KWin /Scripting "
-                                 "org.kde.kwin.Scripting.loadScript " +
-                                 temp_script + " 2>/dev/null";
-          std::string script_id = ExecuteCommand(load_cmd);
-
-          if (!script_id.empty()) {
-            std::string run_cmd = "qdbus org.kde.KWin /" + script_id +
-                                  " org.kde.kwin.Script.run 2>/dev/null";
-            int result = system(run_cmd.c_str());
-
-            // Clean up
-            std::string stop_cmd = "qdbus org.kde.KWin /" + script_id +
-                                   " org.kde.kwin.Script.stop 2>/dev/null";
-            (void)system(stop_cmd.c_str());
-            std::remove(temp_script.c_str());
-
-            if (result == 0) {
-              return true;
-            }
-          } else {
-            std::remove(temp_script.c_str());
-          }
-        }
-      }
+    // Method 2: Try using wmctrl (sometimes works on KDE Wayland)
+    if (RunProcessSucceeded({"wmctrl", "-a", windowTitle}) ||
+        RunProcessSucceeded({"wmctrl", "-x", "-a", "whph"})) {
+      return true;
     }
   }
 
   // Try Hyprland
-  if (!ExecuteCommand("pgrep -f Hyprland 2>/dev/null").empty()) {
-    std::vector<std::string> hypr_commands = {
-        "hyprctl dispatch focuswindow title:\"" + windowTitle +
-            "\" 2>/dev/null",
-        "hyprctl dispatch focuswindow class:whph 2>/dev/null"};
-
-    for (const auto &cmd : hypr_commands) {
-      if (system(cmd.c_str()) == 0) {
-        return true;
-      }
+  if (fingerprint_->Includes(WaylandBackend::kWlroots)) {
+    if (RunProcessSucceeded({"hyprctl", "dispatch", "focuswindow",
+                             "title:" + windowTitle}) ||
+        RunProcessSucceeded(
+            {"hyprctl", "dispatch", "focuswindow", "class:whph"})) {
+      return true;
     }
   }
 
   // Generic fallbacks that might work on some Wayland compositors
-  std::vector<std::string> fallback_commands = {
-      "wmctrl -a \"" + windowTitle + "\" 2>/dev/null",
-      "wmctrl -x -a \"whph\" 2>/dev/null",
-      "xdotool search --name \"" + windowTitle +
-          "\" windowactivate 2>/dev/null"};
-
-  for (const auto &command : fallback_commands) {
-    if (system(command.c_str()) == 0) {
-      return true;
-    }
+  return RunProcessSucceeded({"wmctrl", "-a", windowTitle}) ||
+         RunProcessSucceeded({"wmctrl", "-x", "-a", "whph"}) ||
+         RunProcessSucceeded(
+             {"xdotool", "search", "--name", windowTitle, "windowactivate"});
+}
+
+WindowInfo WaylandWindowDetector::ParseGnomeEval(const std::string &json) {
+  WindowInfo info{"", ""};
+
+  JsonValue fields;
+  if (!JsonValue::Parse(json, &fields) || fields.Items().size() != 3) {
+    return info;
   }
+  info.title = WindowDetector::ValidateUtf8(fields.Items()[0].AsString());
+  info.application =
+      WindowDetector::ValidateUtf8(fields.Items()[1].AsString());
+  info.pid = std::max(0, static_cast<int>(fields.Items()[2].AsNumber()));
 
-  return false;
+  return info;
 }
 
-WindowInfo WaylandWindowDetector::ParseGnomeEval(const std::string &title_res,
-                                                 const std::string &app_res) {
+WindowInfo WaylandWindowDetector::ParseSwayTree(const std::string &tree_json) {
   WindowInfo info{"", ""};
 
-  auto parse_val = [](const std::string &res) -> std::string {
-    if (res.find("true") != std::string::npos) {
-      size_t start = res.find("(true, ");
-      if (start != std::string::npos) {
-        start += 7;
-        size_t end = res.find(")", start);
-        if (end != std::string::npos) {
-          return WindowDetector::ValidateUtf8(
-              WindowDetector::CleanQuotes(res.substr(start, end - start)));
-        }
+  JsonValue tree;
+  if (!JsonValue::Parse(tree_json, &tree)) {
+    return info;
+  }
+  for (const SwayView &view : CollectSwayViews(tree)) {
+    if (view.focused) {
+      info.title = WindowDetector::ValidateUtf8(view.name);
+      info.application = WindowDetector::ValidateUtf8(view.app_id);
+      info.pid = view.pid;
+      break;
+    }
+  }
+  return info;
+}
+
+std::vector<ToplevelWindow>
+WaylandWindowDetector::ParseWindowListTsv(const std::string &output) {
+  // Reverses the escaping @tsv applies to tabs, newlines and backslashes
+  auto unescape = [](const std::string &field) {
+    std::string result;
+    result.reserve(field.size());
+    for (size_t i = 0; i < field.size(); i++) {
+      if (field[i] != '\\' || i + 1 == field.size()) {
+        result += field[i];
+        continue;
+      }
+      switch (field[++i]) {
+      case 't':
+        result += '\t';
+        break;
+      case 'n':
+        result += '\n';
+        break;
+      case 'r':
+        result += '\r';
+        break;
+      default:
+        result += field[i];
+        break;
       }
     }
-    return "";
+    return result;
   };
 
-  info.title = parse_val(title_res);
-  info.application = parse_val(app_res);
-
-  return info;
-}
+  std::vector<ToplevelWindow> windows;
+  std::istringstream lines(output);
+  std::string line;
+  while (std::getline(lines, line)) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (int i = 0; i < 4; i++) {
+      size_t tab = line.find('\t', start);
+      if (tab == std::string::npos) {
+        break;
+      }
+      fields.push_back(line.substr(start, tab - start));
+      start = tab + 1;
+    }
+    if (fields.size() < 4) {
+      continue;
+    }
 
-WindowInfo WaylandWindowDetector::ParseSwayTree(const std::string &tree_json) {
-  return {"", ""};
+    ToplevelWindow window;
+    window.focused = fields[0] == "true";
+    window.minimized = fields[1] == "true";
+    window.pid = std::max(0, std::atoi(fields[2].c_str()));
+    window.application = WindowDetector::ValidateUtf8(unescape(fields[3]));
+    window.title = WindowDetector::ValidateUtf8(unescape(line.substr(start)));
+    windows.push_back(std::move(window));
+  }
+  return windows;
 }
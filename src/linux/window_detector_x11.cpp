@@ -1,8 +1,15 @@
+#include "process_runner.h"
 #include "window_detector.h"
 #include "window_utils.h"
+#include "x11_client_pid.h"
+#include "x11_connection.h"
+#include "x11_event_watcher.h"
+#include "x11_library.h"
+#include "x11_property_fetch.h"
+#include "x11_window_table.h"
 #include <algorithm>
+#include <cstdlib>
 #include <cstring>
-#include <fstream>
 #include <iostream>
 #include <vector>
 
@@ -14,139 +21,192 @@
 #endif
 
 #ifdef HAVE_X11
-WindowInfo X11WindowDetector::GetActiveWindow() {
-  WindowInfo info{"unknown", "unknown"};
+namespace {
+
+// Title, PID and application of window, from its properties.
+void DescribeWindow(X11Connection &connection,
+                    X11ClientPidResolver &pid_resolver, Window window,
+                    const X11WindowProperties &properties, WindowInfo *info) {
+  // _NET_WM_NAME is UTF-8 already, so ValidateUtf8 only has to check it;
+  // a WM_NAME fallback in Latin-1 is what takes the repair path
+  if (properties.has_title) {
+    info->title = WindowDetector::ValidateUtf8(properties.title);
+  }
 
-  Display *display = XOpenDisplay(nullptr);
-  if (!display) {
-    return info;
+  // The server knows which process owns the window, while _NET_WM_PID is
+  // only what the client claims. The claim remains the fallback for remote
+  // clients and servers without X-Resource.
+  int pid = pid_resolver.Resolve(connection, window);
+  if (pid <= 0) {
+    pid = properties.pid;
   }
 
-  Window root = DefaultRootWindow(display);
-  Atom net_active_window = XInternAtom(display, "_NET_ACTIVE_WINDOW", False);
-  Atom actual_type;
-  int actual_format;
-  unsigned long nitems, bytes_after;
-  unsigned char *prop = nullptr;
-
-  // Get active window
-  if (XGetWindowProperty(display, root, net_active_window, 0, 1, False,
-                         XA_WINDOW, &actual_type, &actual_format, &nitems,
-                         &bytes_after, &prop) == Success &&
-      prop) {
-    Window active_window = *(Window *)prop;
-    XFree(prop);
-
-    // Get window title
-    Atom wm_name = XInternAtom(display, "WM_NAME", False);
-    if (XGetWindowProperty(display, active_window, wm_name, 0, 1024, False,
-                           AnyPropertyType, &actual_type, &actual_format,
-                           &nitems, &bytes_after, &prop) == Success &&
-        prop) {
-      info.title = WindowDetector::ValidateUtf8(
-          std::string(reinterpret_cast<char *>(prop)));
-      XFree(prop);
+  if (pid > 0) {
+    info->pid = pid;
+
+    // Get process name from /proc/pid/comm
+    std::string comm = ReadProcessName(pid);
+    if (!comm.empty()) {
+      info->application = WindowDetector::ValidateUtf8(comm);
     }
+  }
 
-    // Get process ID
-    Atom net_wm_pid = XInternAtom(display, "_NET_WM_PID", False);
-    if (XGetWindowProperty(display, active_window, net_wm_pid, 0, 1, False,
-                           XA_CARDINAL, &actual_type, &actual_format, &nitems,
-                           &bytes_after, &prop) == Success &&
-        prop) {
-      pid_t pid = *(pid_t *)prop;
-      XFree(prop);
-
-      // Get process name from /proc/pid/comm
-      std::string comm_path = "/proc/" + std::to_string(pid) + "/comm";
-      std::ifstream comm_file(comm_path);
-      if (comm_file.is_open()) {
-        std::getline(comm_file, info.application);
-        info.application = WindowDetector::ValidateUtf8(info.application);
-        comm_file.close();
-      }
+  // If application name is still unknown (e.g. running in Flatpak where
+  // /proc is hidden), use WM_CLASS. Prefer class name, fallback to
+  // instance name.
+  if (info->application == "unknown" || info->application.empty()) {
+    if (!properties.wm_class.empty()) {
+      info->application = WindowDetector::ValidateUtf8(properties.wm_class);
+    } else if (!properties.wm_instance.empty()) {
+      info->application = WindowDetector::ValidateUtf8(properties.wm_instance);
     }
+  }
+}
 
-    // If application name is still unknown (e.g. running in Flatpak where /proc
-    // is hidden), try to get it from WM_CLASS
-    if (info.application == "unknown" || info.application.empty()) {
-      Atom wm_class = XInternAtom(display, "WM_CLASS", False);
-      if (XGetWindowProperty(display, active_window, wm_class, 0, 1024, False,
-                             XA_STRING, &actual_type, &actual_format, &nitems,
-                             &bytes_after, &prop) == Success &&
-          prop) {
-        // WM_CLASS contains two strings: instance name and class name.
-        // We usually want the class name (second string), but sometimes
-        // instance name is useful. The strings are null-terminated and
-        // sequential in the buffer.
-
-        char *str = (char *)prop;
-        std::string res_name = str;
-        std::string res_class = "";
-
-        // Advance to next string if available
-        size_t len = res_name.length();
-        if (len <
-            nitems * (actual_format / 8) - 1) { // Check if there's more data
-          res_class = std::string(str + len + 1);
-        }
+} // namespace
+
+X11WindowDetector::X11WindowDetector()
+    : connection_(std::make_unique<X11Connection>()),
+      pid_resolver_(std::make_unique<X11ClientPidResolver>()) {
+  watcher_ = std::make_unique<X11EventWatcher>(
+      [this](std::chrono::nanoseconds changed_at) {
+        pending_change_ = changed_at.count();
+        NotifyChanged();
+      },
+      [this](const std::vector<Window> &windows) {
+        pid_resolver_->Retain(windows);
+      });
+  watcher_->Start();
+}
 
-        XFree(prop);
+X11WindowDetector::~X11WindowDetector() = default;
 
-        // Prefer class name, fallback to instance name
-        if (!res_class.empty()) {
-          info.application = WindowDetector::ValidateUtf8(res_class);
-        } else if (!res_name.empty()) {
-          info.application = WindowDetector::ValidateUtf8(res_name);
-        }
-      }
-    }
+bool X11WindowDetector::ReportsChanges() const {
+  return watcher_->IsActive();
+}
+
+WindowInfo X11WindowDetector::GetActiveWindow() {
+  WindowInfo info{"unknown", "unknown"};
+
+  if (!connection_->Get()) {
+    return info;
   }
 
-  XCloseDisplay(display);
+  // The event watcher already tracks the active window, which saves the
+  // round trip for _NET_ACTIVE_WINDOW
+  Window active_window = watcher_->IsActive()
+                             ? watcher_->ActiveWindow()
+                             : FetchActiveWindow(*connection_);
+
+  X11WindowProperties properties;
+  if (FetchWindowProperties(*connection_, active_window, &properties)) {
+    DescribeWindow(*connection_, *pid_resolver_, active_window, properties,
+                   &info);
+  }
+
+  info.backend = "x11";
+  info.changed_at = std::chrono::nanoseconds(pending_change_.exchange(0));
   return info;
 }
 
-bool X11WindowDetector::IsX11Available() {
-  Display *display = XOpenDisplay(nullptr);
-  if (display) {
-    XCloseDisplay(display);
-    return true;
+std::vector<ToplevelWindow> X11WindowDetector::GetWindows() {
+  std::vector<ToplevelWindow> result;
+  if (!connection_->Get()) {
+    return result;
+  }
+
+  // Straight from the watcher's table when it runs, otherwise one batch
+  std::vector<std::pair<uint64_t, X11WindowProperties>> windows;
+  Window active_window;
+  if (watcher_->IsActive()) {
+    windows = watcher_->Windows().Snapshot();
+    active_window = watcher_->ActiveWindow();
+  } else {
+    std::vector<Window> client_list = FetchClientList(*connection_);
+    std::vector<X11WindowProperties> properties =
+        FetchWindowPropertiesBatch(*connection_, client_list);
+    for (size_t i = 0; i < client_list.size(); i++) {
+      windows.emplace_back(client_list[i], std::move(properties[i]));
+    }
+    active_window = FetchActiveWindow(*connection_);
   }
-  return false;
+
+  result.reserve(windows.size());
+  for (const auto &window : windows) {
+    WindowInfo info{"", "unknown"};
+    DescribeWindow(*connection_, *pid_resolver_, window.first, window.second,
+                   &info);
+
+    ToplevelWindow toplevel;
+    toplevel.title = std::move(info.title);
+    toplevel.application = std::move(info.application);
+    toplevel.pid = info.pid;
+    toplevel.focused = window.first == active_window;
+    toplevel.minimized = window.second.hidden;
+    result.push_back(std::move(toplevel));
+  }
+  return result;
 }
 #else
+X11WindowDetector::X11WindowDetector() = default;
+
+X11WindowDetector::~X11WindowDetector() = default;
+
+std::vector<ToplevelWindow> X11WindowDetector::GetWindows() {
+  // Listing through xprop would cost several spawns per window
+  return {};
+}
+
+bool X11WindowDetector::ReportsChanges() const { return false; }
+
 WindowInfo X11WindowDetector::GetActiveWindow() {
   // Fallback to command execution if X11 headers not available
   WindowInfo info{"unknown", "unknown"};
-
-  std::string window_id = ExecuteCommand(
-      "xprop -root | grep '_NET_ACTIVE_WINDOW(WINDOW)' | awk '{print $5}'");
-  if (window_id.empty() || window_id == "0x0") {
+  info.backend = "xprop";
+
+  // Output: "_NET_ACTIVE_WINDOW(WINDOW): window id # 0x1234567"
+  std::string root_prop =
+      RunProcessOutput({"xprop", "-root", "_NET_ACTIVE_WINDOW"});
+  size_t id_pos = root_prop.rfind(' ');
+  std::string window_id =
+      id_pos != std::string::npos ? root_prop.substr(id_pos + 1) : "";
+  if (window_id.empty() || window_id == "0x0" ||
+      window_id.find("0x") != 0) {
     return info;
   }
 
-  std::string title_cmd =
-      "xprop -id " + window_id + " | grep '^WM_NAME' | cut -d '\"' -f 2";
-  info.title = WindowDetector::ValidateUtf8(ExecuteCommand(title_cmd));
+  // Output: WM_NAME(STRING) = "title"
+  std::string name_prop =
+      RunProcessOutput({"xprop", "-id", window_id, "WM_NAME"});
+  size_t first_quote = name_prop.find('"');
+  if (first_quote != std::string::npos) {
+    size_t second_quote = name_prop.find('"', first_quote + 1);
+    info.title = WindowDetector::ValidateUtf8(name_prop.substr(
+        first_quote + 1, second_quote == std::string::npos
+                             ? std::string::npos
+                             : second_quote - first_quote - 1));
+  }
 
-  std::string pid_cmd = "xprop -id " + window_id +
-                        " | grep '^_NET_WM_PID' | awk -F '= ' '{print $2}'";
-  std::string pid_str = ExecuteCommand(pid_cmd);
+  // Output: _NET_WM_PID(CARDINAL) = 1234
+  std::string pid_prop =
+      RunProcessOutput({"xprop", "-id", window_id, "_NET_WM_PID"});
+  size_t equals_pos = pid_prop.find("= ");
+  std::string pid_str =
+      equals_pos != std::string::npos ? pid_prop.substr(equals_pos + 2) : "";
 
   if (!pid_str.empty()) {
-    std::string comm_cmd = "cat /proc/" + pid_str + "/comm 2>/dev/null";
-    info.application = WindowDetector::ValidateUtf8(ExecuteCommand(comm_cmd));
+    info.pid = std::atoi(pid_str.c_str());
+    info.application = WindowDetector::ValidateUtf8(ReadProcessName(info.pid));
     if (info.application.empty()) {
-      std::string ps_cmd = "ps -p " + pid_str + " -o comm= 2>/dev/null";
-      info.application = WindowDetector::ValidateUtf8(ExecuteCommand(ps_cmd));
+      info.application = WindowDetector::ValidateUtf8(
+          RunProcessOutput({"ps", "-p", pid_str, "-o", "comm="}));
     }
   }
 
   // Fallback to WM_CLASS if /proc failed (e.g. inside Flatpak)
   if (info.application.empty() || info.application == "unknown") {
-    std::string class_cmd = "xprop -id " + window_id + " WM_CLASS 2>/dev/null";
-    std::string class_res = ExecuteCommand(class_cmd);
+    std::string class_res =
+        RunProcessOutput({"xprop", "-id", window_id, "WM_CLASS"});
 
     std::string parsed_app = ParseXpropWmClass(class_res);
     if (!parsed_app.empty()) {
@@ -185,87 +245,56 @@ std::string X11WindowDetector::ParseXpropWmClass(const std::string &input) {
   }
   return app_name;
 }
-
-bool X11WindowDetector::IsX11Available() {
-  return !ExecuteCommand("which xprop 2>/dev/null").empty();
-}
 #endif
 
 // X11WindowDetector focus implementation
 bool X11WindowDetector::FocusWindow(const std::string &windowTitle) {
 #ifdef HAVE_X11
-  if (!IsX11Available()) {
-    return false;
-  }
-
-  Display *display = XOpenDisplay(nullptr);
+  Display *display = connection_->Get();
   if (!display) {
     return false;
   }
 
-  Window root = DefaultRootWindow(display);
-  Atom net_client_list = XInternAtom(display, "_NET_CLIENT_LIST", False);
-  Atom net_wm_name = XInternAtom(display, "_NET_WM_NAME", False);
-  Atom utf8_string = XInternAtom(display, "UTF8_STRING", False);
-
-  Atom actual_type;
-  int actual_format;
-  unsigned long nitems, bytes_after;
-  Window *windows = nullptr;
-
-  // Get list of all windows
-  int status = XGetWindowProperty(
-      display, root, net_client_list, 0, 1024, False, XA_WINDOW, &actual_type,
-      &actual_format, &nitems, &bytes_after, (unsigned char **)&windows);
-
-  if (status != Success || !windows) {
-    XCloseDisplay(display);
-    return false;
-  }
-
-  bool found = false;
-
-  for (unsigned long i = 0; i < nitems; i++) {
-    Window window = windows[i];
-
-    // Try _NET_WM_NAME first (UTF-8)
-    unsigned char *name_prop = nullptr;
-    status = XGetWindowProperty(display, window, net_wm_name, 0, 1024, False,
-                                utf8_string, &actual_type, &actual_format,
-                                &nitems, &bytes_after, &name_prop);
-
-    std::string title;
-    if (status == Success && name_prop) {
-      title = std::string((char *)name_prop);
-      XFree(name_prop);
-    } else {
-      // Fallback to WM_NAME
-      char *window_name = nullptr;
-      if (XFetchName(display, window, &window_name) && window_name) {
-        title = std::string(window_name);
-        XFree(window_name);
-      }
-    }
-
-    // Check if this is our target window
-    if (title.find(windowTitle) != std::string::npos || title == "whph") {
-      // Focus the window
-      XRaiseWindow(display, window);
-      XSetInputFocus(display, window, RevertToParent, CurrentTime);
-      XFlush(display);
-      found = true;
-      break;
+  // The watcher keeps every client's title up to date. Without it, fall back
+  // to reading all of them now, still in a single batch.
+  uint64_t window;
+  if (watcher_->IsActive()) {
+    window = watcher_->Windows().Find(windowTitle);
+  } else {
+    X11WindowTable table;
+    std::vector<Window> windows = FetchClientList(*connection_);
+    table.SetWindows(std::vector<uint64_t>(windows.begin(), windows.end()));
+    std::vector<X11WindowProperties> properties =
+        FetchWindowPropertiesBatch(*connection_, windows);
+    for (size_t i = 0; i < windows.size(); i++) {
+      table.Update(windows[i], properties[i]);
     }
+    window = table.Find(windowTitle);
+  }
+  if (window == 0) {
+    return false;
   }
 
-  XFree(windows);
-  XCloseDisplay(display);
-  return found;
+  // Ask the window manager to activate the window (EWMH), which also
+  // unminimizes it and switches desktops; XSetInputFocus does neither.
+  // Source indication 2 (pager) marks the request as coming from the user,
+  // so focus stealing prevention lets it through.
+  XEvent event = {};
+  event.xclient.type = ClientMessage;
+  event.xclient.window = static_cast<Window>(window);
+  event.xclient.message_type = connection_->GetAtom(X11Atom::kNetActiveWindow);
+  event.xclient.format = 32;
+  event.xclient.data.l[0] = 2;
+  event.xclient.data.l[1] = CurrentTime;
+  event.xclient.data.l[2] = None;
+  Status sent = X11Lib().XSendEvent(
+      display, connection_->Root(), False,
+      SubstructureRedirectMask | SubstructureNotifyMask, &event);
+  X11Lib().XFlush(display);
+  return sent != 0;
 #else
   // Fallback to wmctrl if X11 headers not available
-  std::string command = "wmctrl -a \"" + windowTitle +
-                        "\" 2>/dev/null || wmctrl -x -a \"whph\" 2>/dev/null";
-  int result = system(command.c_str());
-  return result == 0;
+  return RunProcessSucceeded({"wmctrl", "-a", windowTitle}) ||
+         RunProcessSucceeded({"wmctrl", "-x", "-a", "whph"});
 #endif
 }
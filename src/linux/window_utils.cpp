@@ -1,8 +1,10 @@
 #include "window_utils.h"
-#include <array>
+#include "process_runner.h"
 #include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <glib.h>
 #include <iostream>
-#include <memory>
 #include <vector>
 
 // Helper function to escape shell arguments to prevent command injection
@@ -23,37 +25,58 @@ std::string ShellEscape(const std::string &input) {
   return escaped;
 }
 
+std::string JsString(const std::string &input) {
+  std::string quoted = "\"";
+  for (char c : input) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      // Line breaks would end the literal; other controls are escaped alike
+      char escape[7];
+      snprintf(escape, sizeof(escape), "\\u%04x", c);
+      quoted += escape;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
 // Helper function to execute shell command and get output
 std::string ExecuteCommand(const std::string &command) {
-  std::string result;
-  FILE *pipe = popen(command.c_str(), "r");
-  if (!pipe) {
-    // Only log popen failures for non-probe commands (not 'which' or 'pgrep')
+  // Shell pipelines still need /bin/sh; prefer RunProcess with an argv for
+  // single commands.
+  ProcessOptions options;
+  options.inherit_stderr = true;
+  ProcessResult process = RunProcess({"/bin/sh", "-c", command}, options);
+
+  if (!process.started) {
+    // Only log spawn failures for non-probe commands (not 'which' or 'pgrep')
     if (command.find("which ") != 0 && command.find("pgrep ") != 0) {
-      std::cerr << "ExecuteCommand: popen failed for command: " << command
+      std::cerr << "ExecuteCommand: spawn failed for command: " << command
                 << std::endl;
     }
-    return result;
+    return "";
   }
 
-  char buffer[128];
-  while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-    result += buffer;
-  }
-  int status = pclose(pipe);
-
-  // Only log unexpected failures (not probe commands like 'which' or 'pgrep')
-  if (status != 0) {
+  if (process.timed_out) {
+    std::cerr << "ExecuteCommand: command timed out: " << command << std::endl;
+  } else if (process.exit_status != 0) {
+    // Only log unexpected failures (not probe commands like 'which' or
+    // 'pgrep')
     bool is_probe_command =
         (command.find("which ") == 0 || command.find("pgrep ") == 0 ||
          command.find("2>/dev/null") != std::string::npos ||
          command.find("2>&1") != std::string::npos);
     if (!is_probe_command) {
-      std::cerr << "ExecuteCommand: command exited with status " << status
-                << ": " << command << std::endl;
+      std::cerr << "ExecuteCommand: command exited with status "
+                << process.exit_status << ": " << command << std::endl;
     }
   }
 
+  std::string result = std::move(process.output);
+
   // Remove trailing newline
   if (!result.empty() && result.back() == '\n') {
     result.pop_back();
@@ -62,40 +85,42 @@ std::string ExecuteCommand(const std::string &command) {
   return result;
 }
 
-// Helper function to unescape GVariant strings (e.g. from qdbus)
-std::string UnescapeGVariantString(const std::string &input) {
-  std::string result = input;
-
-  // Check for GVariant string wrapper: ('string content',) or ('string
-  // content')
-  if (result.size() >= 5 && result.substr(0, 2) == "('" &&
-      result.substr(result.size() - 3) == "',)") {
-    result = result.substr(2, result.size() - 5);
-  } else if (result.size() >= 4 && result.substr(0, 2) == "('" &&
-             result.substr(result.size() - 2) == "')") {
-    result = result.substr(2, result.size() - 4);
+std::string ReadProcessName(int pid) {
+  if (pid <= 0) {
+    return "";
   }
-  // Check for simpler GVariant string wrapper: 'string content'
-  else if (result.size() >= 2 && result.front() == '\'' &&
-           result.back() == '\'') {
-    result = result.substr(1, result.size() - 2);
+
+  std::ifstream comm_file("/proc/" + std::to_string(pid) + "/comm");
+  std::string name;
+  if (comm_file.is_open()) {
+    std::getline(comm_file, name);
   }
+  return name;
+}
 
-  // Helper to replace all occurrences of a substring
-  auto replaceAll = [](std::string &str, const std::string &from,
-                       const std::string &to) {
-    size_t start_pos = 0;
-    while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
-      str.replace(start_pos, from.length(), to);
-      start_pos += to.length();
-    }
-  };
+std::string KwinScriptPath(const std::string &name) {
+  const char *app_id = getenv("FLATPAK_ID");
+  if (IsRunningInFlatpak() && app_id && *app_id) {
+    return std::string(g_get_user_runtime_dir()) + "/app/" + app_id + "/" +
+           name;
+  }
+  // Not /tmp: another user could create the file first, or swap its content
+  // before KWin runs it
+  return std::string(g_get_user_runtime_dir()) + "/whph/" + name;
+}
 
-  // Unescape common sequences
-  replaceAll(result, "\\'", "'");
-  replaceAll(result, "\\\"", "\"");
-  replaceAll(result, "\\\\", "\\");
-  replaceAll(result, "\\n", "\n");
+bool WriteKwinScript(const std::string &path, const std::string &content) {
+  gchar *directory = g_path_get_dirname(path.c_str());
+  bool created = g_mkdir_with_parents(directory, 0700) == 0;
+  g_free(directory);
+  if (!created) {
+    return false;
+  }
 
-  return result;
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    return false;
+  }
+  file << content;
+  return static_cast<bool>(file);
 }
@@ -9,7 +9,22 @@ std::string ExecuteCommand(const std::string &command);
 // Helper function to escape shell arguments to prevent command injection
 std::string ShellEscape(const std::string &input);
 
-// Helper function to unescape GVariant strings (e.g. from qdbus)
-std::string UnescapeGVariantString(const std::string &input);
+// Quotes input as a JavaScript (and JSON) string literal, for splicing into
+// scripts run by GNOME Shell or KWin
+std::string JsString(const std::string &input);
+
+// Reads the process name from /proc/<pid>/comm, empty if unavailable (e.g.
+// inside Flatpak, where host processes are hidden)
+std::string ReadProcessName(int pid);
+
+// Where to write a KWin script so that KWin, which runs on the host, can read
+// it: a directory under XDG_RUNTIME_DIR, which only the user can access.
+// Inside Flatpak only the app's directory there is shared with the host, at
+// the same path.
+std::string KwinScriptPath(const std::string &name);
+
+// Writes content to path, replacing the file and creating its directory
+// (mode 0700) if needed. False on any error.
+bool WriteKwinScript(const std::string &path, const std::string &content);
 
 #endif // WINDOW_UTILS_H_
@@ -0,0 +1,122 @@
+#include "x11_client_pid.h"
+#include <algorithm>
+#include <unordered_set>
+
+constexpr size_t WindowPidCache::kMaxEntries;
+
+bool WindowPidCache::Lookup(uint64_t window, int *pid) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = pids_.find(window);
+  if (it == pids_.end()) {
+    return false;
+  }
+  *pid = it->second;
+  return true;
+}
+
+void WindowPidCache::Store(uint64_t window, int pid) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (pids_.size() >= kMaxEntries && pids_.count(window) == 0) {
+    pids_.clear();
+  }
+  pids_[window] = pid;
+}
+
+void WindowPidCache::Retain(const std::vector<uint64_t> &live) {
+  std::unordered_set<uint64_t> keep(live.begin(), live.end());
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = pids_.begin(); it != pids_.end();) {
+    if (keep.count(it->first) == 0) {
+      it = pids_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void WindowPidCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pids_.clear();
+}
+
+size_t WindowPidCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pids_.size();
+}
+
+#ifdef HAVE_X11
+#include "x11_library.h"
+
+namespace {
+
+#ifdef HAVE_XRES
+// XResQueryClientIds arrived with X-Resource 1.2.
+bool SupportsClientIds(Display *display) {
+  const X11Library &x11 = X11Lib();
+  int event_base, error_base;
+  int major = 0, minor = 0;
+  return x11.has_xres &&
+         x11.XResQueryExtension(display, &event_base, &error_base) &&
+         x11.XResQueryVersion(display, &major, &minor) &&
+         (major > 1 || (major == 1 && minor >= 2));
+}
+
+int QueryClientPid(Display *display, Window window) {
+  const X11Library &x11 = X11Lib();
+  XResClientIdSpec spec;
+  spec.client = window;
+  spec.mask = XRES_CLIENT_ID_PID_MASK;
+
+  long count = 0;
+  XResClientIdValue *values = nullptr;
+  if (x11.XResQueryClientIds(display, 1, &spec, &count, &values) != Success) {
+    return 0;
+  }
+  int pid = 0;
+  for (long i = 0; i < count; i++) {
+    if (x11.XResGetClientIdType(&values[i]) == XRES_CLIENT_ID_PID) {
+      // -1 when the server does not know, e.g. for a TCP client
+      pid = std::max(0, static_cast<int>(x11.XResGetClientPid(&values[i])));
+      break;
+    }
+  }
+  x11.XResClientIdsDestroy(count, values);
+  return pid;
+}
+#endif // HAVE_XRES
+
+} // namespace
+
+int X11ClientPidResolver::Resolve(X11Connection &connection, Window window) {
+#ifdef HAVE_XRES
+  Display *display = connection.Get();
+  if (!display || window == None) {
+    return 0;
+  }
+
+  // Window IDs from an earlier server mean nothing on this one
+  if (connection.Generation() != generation_) {
+    generation_ = connection.Generation();
+    supported_ = SupportsClientIds(display);
+    cache_.Clear();
+  }
+  if (!supported_) {
+    return 0;
+  }
+
+  int pid = 0;
+  if (!cache_.Lookup(window, &pid)) {
+    pid = QueryClientPid(display, window);
+    cache_.Store(window, pid);
+  }
+  return pid;
+#else
+  return 0;
+#endif
+}
+
+void X11ClientPidResolver::Retain(const std::vector<Window> &live) {
+  cache_.Retain(std::vector<uint64_t>(live.begin(), live.end()));
+}
+
+#endif // HAVE_X11
@@ -0,0 +1,74 @@
+#ifndef X11_CLIENT_PID_H_
+#define X11_CLIENT_PID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// PIDs resolved per window ID, including "no PID" (0) results so a remote
+// client is not asked about again on every poll.
+//
+// Entries are dropped by Retain() once a window leaves the window manager's
+// client list, which is where destroyed windows go. Without a window manager
+// nothing prunes the cache, so it is also cleared when it grows past
+// kMaxEntries.
+//
+// Thread-safe: lookups happen on detector worker threads while the event
+// watcher prunes from the main thread.
+class WindowPidCache {
+public:
+  static constexpr size_t kMaxEntries = 1024;
+
+  // False if window has no entry.
+  bool Lookup(uint64_t window, int *pid) const;
+  void Store(uint64_t window, int pid);
+
+  // Drops every window that is not in live.
+  void Retain(const std::vector<uint64_t> &live);
+  void Clear();
+  size_t Size() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::unordered_map<uint64_t, int> pids_;
+};
+
+#ifdef HAVE_X11
+#include "x11_connection.h"
+
+// Asks the X server which process owns a window, through the X-Resource
+// extension (XResQueryClientIds, version 1.2). Unlike _NET_WM_PID, which the
+// client sets about itself and may omit or get wrong (e.g. inside a PID
+// namespace), this is the PID of the process at the other end of the
+// connection that created the window.
+//
+// Needs libXRes at build time (HAVE_XRES) and run time; without it Resolve()
+// always returns 0.
+class X11ClientPidResolver {
+public:
+  // PID of the client that created window, memoized per window. 0 if the
+  // server cannot tell, e.g. for a client connected over TCP or a server
+  // without X-Resource 1.2. Serialize calls like every other detector call.
+  int Resolve(X11Connection &connection, Window window);
+
+  // Forgets windows that are no longer in _NET_CLIENT_LIST. Safe to call
+  // from any thread.
+  void Retain(const std::vector<Window> &live);
+
+private:
+  WindowPidCache cache_;
+  // X11Connection::Generation() supported_ was checked for.
+  uint64_t generation_ = 0;
+  bool supported_ = false;
+};
+
+#else
+
+// Without Xlib the X11 detector reads _NET_WM_PID through xprop.
+class X11ClientPidResolver {};
+
+#endif // HAVE_X11
+
+#endif // X11_CLIENT_PID_H_
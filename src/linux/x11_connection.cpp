@@ -0,0 +1,120 @@
+#include "x11_connection.h"
+
+#ifdef HAVE_X11
+#include "x11_library.h"
+#include <mutex>
+#include <set>
+
+namespace {
+
+// Displays opened by X11Connection, whose errors OnError swallows.
+std::mutex g_displays_mutex;
+std::set<Display *> g_displays;
+XErrorHandler g_previous_error_handler = nullptr;
+
+// Indexed by X11Atom.
+const char *const kAtomNames[] = {
+    "_NET_ACTIVE_WINDOW", "_NET_CLIENT_LIST",        "_NET_WM_NAME",
+    "_NET_WM_PID",        "_NET_WM_STATE",           "_NET_WM_STATE_HIDDEN",
+    "UTF8_STRING",        "WM_CLASS",                "WM_NAME"};
+
+static_assert(sizeof(kAtomNames) / sizeof(kAtomNames[0]) ==
+                  static_cast<size_t>(X11Atom::kCount),
+              "kAtomNames must list every X11Atom");
+
+} // namespace
+
+constexpr std::chrono::seconds X11Connection::kReconnectInterval;
+
+X11Connection::~X11Connection() { Close(); }
+
+Display *X11Connection::Get() {
+  if (display_ && !lost_) {
+    return display_;
+  }
+  Close();
+
+  auto now = std::chrono::steady_clock::now();
+  if (attempted_ && now - last_attempt_ < kReconnectInterval) {
+    return nullptr;
+  }
+  attempted_ = true;
+  last_attempt_ = now;
+
+  // The first connection is what loads libX11
+  const X11Library *x11 = LoadX11Library();
+  if (!x11) {
+    return nullptr;
+  }
+  Display *display = x11->XOpenDisplay(nullptr);
+  if (!display) {
+    return nullptr;
+  }
+#ifdef HAVE_XSETIOERROREXITHANDLER
+  if (x11->XSetIOErrorExitHandler) {
+    x11->XSetIOErrorExitHandler(display, OnIOErrorExit, this);
+  }
+#endif
+  {
+    std::lock_guard<std::mutex> lock(g_displays_mutex);
+    if (g_displays.empty()) {
+      XErrorHandler previous = x11->XSetErrorHandler(OnError);
+      if (previous != OnError) {
+        g_previous_error_handler = previous;
+      }
+    }
+    g_displays.insert(display);
+  }
+  display_ = display;
+
+  // All atoms in a single round trip
+  char *names[static_cast<int>(X11Atom::kCount)];
+  for (int i = 0; i < static_cast<int>(X11Atom::kCount); i++) {
+    names[i] = const_cast<char *>(kAtomNames[i]);
+  }
+  if (!x11->XInternAtoms(display, names, static_cast<int>(X11Atom::kCount),
+                         False, atoms_)) {
+    Close();
+    return nullptr;
+  }
+
+  lost_ = false;
+  generation_++;
+  return display_;
+}
+
+Atom X11Connection::GetAtom(X11Atom atom) const {
+  return atoms_[static_cast<int>(atom)];
+}
+
+Window X11Connection::Root() const { return DefaultRootWindow(display_); }
+
+void X11Connection::Close() {
+  if (display_) {
+    X11Lib().XCloseDisplay(display_);
+    std::lock_guard<std::mutex> lock(g_displays_mutex);
+    g_displays.erase(display_);
+    display_ = nullptr;
+  }
+  lost_ = false;
+}
+
+void X11Connection::OnIOErrorExit(Display *display, void *user_data) {
+  // Returning instead of exiting leaves the display closed for I/O; Get()
+  // reconnects on the next call.
+  static_cast<X11Connection *>(user_data)->lost_ = true;
+}
+
+int X11Connection::OnError(Display *display, XErrorEvent *event) {
+  XErrorHandler previous;
+  {
+    std::lock_guard<std::mutex> lock(g_displays_mutex);
+    if (g_displays.count(display) > 0) {
+      return 0;
+    }
+    previous = g_previous_error_handler;
+  }
+  return previous ? previous(display, event) : 0;
+}
+
+#endif // HAVE_X11
@@ -0,0 +1,88 @@
+#ifndef X11_CONNECTION_H_
+#define X11_CONNECTION_H_
+
+#ifdef HAVE_X11
+#include <X11/Xlib.h>
+
+#include <chrono>
+#include <cstdint>
+
+// Atoms interned once per connection.
+enum class X11Atom {
+  kNetActiveWindow,
+  kNetClientList,
+  kNetWmName,
+  kNetWmPid,
+  kNetWmState,
+  kNetWmStateHidden,
+  kUtf8String,
+  kWmClass,
+  kWmName,
+  kCount
+};
+
+// Long-lived Xlib connection with its interned atoms, so a poll only costs
+// the property fetches.
+//
+// When the X server goes away (e.g. an on-demand Xwayland exits) the
+// connection is dropped and reopened by the next Get(). That needs
+// XSetIOErrorExitHandler (libX11 >= 1.7) at build and run time; older libX11
+// exits the process on a lost connection as before.
+//
+// The first Get() loads libX11 (see x11_library.h); without it there is no
+// display, as if no X server were running.
+//
+// Protocol errors on these connections (e.g. BadWindow for a window that was
+// destroyed between two requests) are ignored instead of hitting Xlib's
+// default handler, which exits the process. Errors on other connections,
+// such as GDK's, still reach the handler that was installed before.
+//
+// Not thread-safe; callers serialize access like every other detector call.
+class X11Connection {
+public:
+  X11Connection() = default;
+  ~X11Connection();
+
+  X11Connection(const X11Connection &) = delete;
+  X11Connection &operator=(const X11Connection &) = delete;
+
+  // The open display, connecting first if needed. nullptr if there is no X
+  // server; reconnecting is then retried at most every kReconnectInterval.
+  Display *Get();
+
+  // Only valid while Get() returns the same display.
+  Atom GetAtom(X11Atom atom) const;
+  Window Root() const;
+
+  void Close();
+
+  // The server went away; the next Get() reconnects.
+  bool IsLost() const { return lost_; }
+
+  // Incremented by every successful connect. Anything remembered about the
+  // server (window IDs, extension support) is stale once it changes.
+  uint64_t Generation() const { return generation_; }
+
+  static constexpr std::chrono::seconds kReconnectInterval{5};
+
+private:
+  static void OnIOErrorExit(Display *display, void *user_data);
+  static int OnError(Display *display, XErrorEvent *event);
+
+  Display *display_ = nullptr;
+  // Set by OnIOErrorExit once the server is gone.
+  bool lost_ = false;
+  uint64_t generation_ = 0;
+  Atom atoms_[static_cast<int>(X11Atom::kCount)] = {};
+  std::chrono::steady_clock::time_point last_attempt_;
+  bool attempted_ = false;
+};
+
+#else
+
+// Without Xlib the X11 detector falls back to xprop and never connects.
+class X11Connection {};
+
+#endif // HAVE_X11
+
+#endif // X11_CONNECTION_H_
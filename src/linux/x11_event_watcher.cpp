@@ -0,0 +1,222 @@
+#include "x11_event_watcher.h"
+#include "active_window_sampler.h"
+#include <algorithm>
+
+constexpr std::chrono::milliseconds ServerTimeMapper::kMaxDeliveryDelay;
+
+std::chrono::nanoseconds
+ServerTimeMapper::ToBootTime(uint32_t server_time,
+                             std::chrono::nanoseconds received_at) {
+  std::chrono::nanoseconds offset =
+      received_at - std::chrono::milliseconds(server_time);
+  if (!has_offset_ || offset < offset_ ||
+      offset - offset_ > kMaxDeliveryDelay) {
+    offset_ = offset;
+    has_offset_ = true;
+  }
+  return std::min(received_at,
+                  offset_ + std::chrono::milliseconds(server_time));
+}
+
+#ifdef HAVE_X11
+#include "x11_library.h"
+#include "x11_property_fetch.h"
+#include <set>
+
+X11EventWatcher::X11EventWatcher(ChangeCallback on_change,
+                                 ClientListCallback on_client_list)
+    : on_change_(std::move(on_change)),
+      on_client_list_(std::move(on_client_list)) {}
+
+X11EventWatcher::~X11EventWatcher() {
+  Disconnect();
+  if (reconnect_source_id_ != 0) {
+    g_source_remove(reconnect_source_id_);
+  }
+}
+
+void X11EventWatcher::Start() {
+  if (!Connect()) {
+    ScheduleReconnect();
+  }
+}
+
+bool X11EventWatcher::Connect() {
+  Display *display = connection_.Get();
+  if (!display) {
+    return false;
+  }
+
+  X11Lib().XSelectInput(display, connection_.Root(), PropertyChangeMask);
+  WatchWindow(FetchActiveWindow(connection_));
+  SyncClientList();
+  X11Lib().XFlush(display);
+
+  fd_source_id_ =
+      g_unix_fd_add(ConnectionNumber(display),
+                    static_cast<GIOCondition>(G_IO_IN | G_IO_HUP | G_IO_ERR),
+                    OnFdReady, this);
+  active_ = true;
+  return true;
+}
+
+void X11EventWatcher::Disconnect() {
+  active_ = false;
+  if (fd_source_id_ != 0) {
+    g_source_remove(fd_source_id_);
+    fd_source_id_ = 0;
+  }
+  active_window_ = None;
+  windows_.Clear();
+  connection_.Close();
+}
+
+void X11EventWatcher::ScheduleReconnect() {
+  if (reconnect_source_id_ == 0) {
+    reconnect_source_id_ = g_timeout_add_seconds(
+        X11Connection::kReconnectInterval.count(), OnReconnect, this);
+  }
+}
+
+void X11EventWatcher::WatchWindow(Window window) {
+  Display *display = CurrentDisplay();
+  if (!display) {
+    return;
+  }
+  // The previous window may already be gone; X11Connection ignores the
+  // resulting BadWindow error. Listed windows stay selected for the table.
+  if (active_window_ != None && !windows_.Contains(active_window_)) {
+    X11Lib().XSelectInput(display, active_window_, NoEventMask);
+  }
+  active_window_ = window;
+  if (active_window_ != None) {
+    X11Lib().XSelectInput(display, active_window_, PropertyChangeMask);
+  }
+}
+
+Display *X11EventWatcher::CurrentDisplay() {
+  // Once the server is gone OnFdReady disconnects; Get() would instead
+  // reconnect underneath the fd source
+  if (connection_.IsLost()) {
+    return nullptr;
+  }
+  return connection_.Get();
+}
+
+void X11EventWatcher::ProcessEvents() {
+  Display *display = connection_.Get();
+  Window root = connection_.Root();
+  Atom net_active_window = connection_.GetAtom(X11Atom::kNetActiveWindow);
+  Atom net_client_list = connection_.GetAtom(X11Atom::kNetClientList);
+  Atom net_wm_name = connection_.GetAtom(X11Atom::kNetWmName);
+  Atom wm_name = connection_.GetAtom(X11Atom::kWmName);
+  Atom net_wm_state = connection_.GetAtom(X11Atom::kNetWmState);
+
+  bool changed = false;
+  bool client_list_changed = false;
+  std::set<Window> stale;
+  Time changed_at = CurrentTime;
+
+  while (!connection_.IsLost() && X11Lib().XPending(display) > 0) {
+    XEvent event;
+    X11Lib().XNextEvent(display, &event);
+    if (event.type != PropertyNotify) {
+      continue;
+    }
+
+    const XPropertyEvent &property = event.xproperty;
+    if (property.window == root && property.atom == net_active_window) {
+      Window window = FetchActiveWindow(connection_);
+      if (window != active_window_) {
+        WatchWindow(window);
+        changed = true;
+        changed_at = property.time;
+      }
+    } else if (property.window == root && property.atom == net_client_list) {
+      client_list_changed = true;
+    } else if (property.atom == net_wm_name || property.atom == wm_name) {
+      if (property.window == active_window_) {
+        changed = true;
+        changed_at = property.time;
+      }
+      stale.insert(property.window);
+    } else if (property.atom == net_wm_state) {
+      // Minimized or restored
+      stale.insert(property.window);
+    }
+  }
+  // A burst of mapped, destroyed or changed windows costs a single batch
+  if (client_list_changed && !connection_.IsLost()) {
+    SyncClientList();
+  }
+  if (!stale.empty() && !connection_.IsLost()) {
+    RefreshWindows(std::vector<Window>(stale.begin(), stale.end()));
+  }
+  if (!connection_.IsLost()) {
+    X11Lib().XFlush(display);
+  }
+
+  if (changed) {
+    on_change_(time_mapper_.ToBootTime(static_cast<uint32_t>(changed_at),
+                                       BootTimeNow()));
+  }
+}
+
+void X11EventWatcher::SyncClientList() {
+  Display *display = CurrentDisplay();
+  if (!display) {
+    return;
+  }
+  std::vector<Window> windows = FetchClientList(connection_);
+  std::vector<uint64_t> added =
+      windows_.SetWindows(std::vector<uint64_t>(windows.begin(), windows.end()));
+
+  // Select before fetching, so a title set in between is not missed
+  for (uint64_t window : added) {
+    X11Lib().XSelectInput(display, window, PropertyChangeMask);
+  }
+  RefreshWindows(std::vector<Window>(added.begin(), added.end()));
+
+  if (on_client_list_) {
+    on_client_list_(windows);
+  }
+}
+
+void X11EventWatcher::RefreshWindows(const std::vector<Window> &windows) {
+  std::vector<X11WindowProperties> properties =
+      FetchWindowPropertiesBatch(connection_, windows);
+  for (size_t i = 0; i < windows.size(); i++) {
+    // Windows that are not listed (e.g. a retitled dialog) are ignored
+    windows_.Update(windows[i], properties[i]);
+  }
+}
+
+gboolean X11EventWatcher::OnFdReady(gint fd, GIOCondition condition,
+                                    gpointer user_data) {
+  X11EventWatcher *self = static_cast<X11EventWatcher *>(user_data);
+
+  if (!(condition & (G_IO_HUP | G_IO_ERR))) {
+    self->ProcessEvents();
+  }
+  if ((condition & (G_IO_HUP | G_IO_ERR)) || self->connection_.IsLost()) {
+    // Returning G_SOURCE_REMOVE removes the source; don't remove it twice
+    self->fd_source_id_ = 0;
+    self->Disconnect();
+    self->ScheduleReconnect();
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+gboolean X11EventWatcher::OnReconnect(gpointer user_data) {
+  X11EventWatcher *self = static_cast<X11EventWatcher *>(user_data);
+  if (!self->Connect()) {
+    return G_SOURCE_CONTINUE;
+  }
+  self->reconnect_source_id_ = 0;
+  // Focus may have moved while nobody was watching
+  self->on_change_(BootTimeNow());
+  return G_SOURCE_REMOVE;
+}
+
+#endif // HAVE_X11
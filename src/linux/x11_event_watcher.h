@@ -0,0 +1,112 @@
+#ifndef X11_EVENT_WATCHER_H_
+#define X11_EVENT_WATCHER_H_
+
+#include <chrono>
+#include <cstdint>
+
+// Maps X server timestamps (milliseconds on the server's own clock, wrapping
+// at 32 bits) onto CLOCK_BOOTTIME.
+//
+// The offset between the clocks is taken from the event that arrived with
+// the least delay. When an event suggests a much larger delay, the clocks
+// have moved apart (suspend, wraparound) and the offset starts over.
+class ServerTimeMapper {
+public:
+  static constexpr std::chrono::milliseconds kMaxDeliveryDelay{2000};
+
+  // received_at is the CLOCK_BOOTTIME time the event was read.
+  std::chrono::nanoseconds ToBootTime(uint32_t server_time,
+                                      std::chrono::nanoseconds received_at);
+
+private:
+  bool has_offset_ = false;
+  std::chrono::nanoseconds offset_{0};
+};
+
+#ifdef HAVE_X11
+#include "x11_connection.h"
+#include "x11_window_table.h"
+#include <atomic>
+#include <functional>
+#include <glib.h>
+#include <vector>
+
+// Reports focus and title changes from X events instead of polling.
+//
+// Selects PropertyChangeMask on the root window (_NET_ACTIVE_WINDOW,
+// _NET_CLIENT_LIST), on the active window and on every listed client
+// (_NET_WM_NAME, WM_NAME, _NET_WM_STATE), and reads the connection from a
+// GLib fd source on the main context, so nothing runs while nothing changes.
+// Uses its own connection: the detector's connection is used from worker
+// threads, and Xlib is not thread-safe.
+//
+// Create, use and destroy on the main thread.
+class X11EventWatcher {
+public:
+  // Called on the main thread with the CLOCK_BOOTTIME time of the change,
+  // derived from the X server event timestamp.
+  using ChangeCallback = std::function<void(std::chrono::nanoseconds)>;
+
+  // Called on the main thread with the new _NET_CLIENT_LIST whenever windows
+  // are mapped or destroyed, and after every (re)connect.
+  using ClientListCallback = std::function<void(const std::vector<Window> &)>;
+
+  explicit X11EventWatcher(ChangeCallback on_change,
+                           ClientListCallback on_client_list = nullptr);
+  ~X11EventWatcher();
+
+  X11EventWatcher(const X11EventWatcher &) = delete;
+  X11EventWatcher &operator=(const X11EventWatcher &) = delete;
+
+  // Connects and starts watching. Without an X server, or after losing it,
+  // retries every X11Connection::kReconnectInterval.
+  void Start();
+
+  // True while events are being received. Safe to call from any thread.
+  bool IsActive() const { return active_; }
+
+  // The active window as of the last event, None if there is none. Safe to
+  // call from any thread.
+  Window ActiveWindow() const { return active_window_; }
+
+  // Every client window with its current properties; empty while inactive.
+  // Safe to read from any thread.
+  const X11WindowTable &Windows() const { return windows_; }
+
+private:
+  bool Connect();
+  void Disconnect();
+  void ScheduleReconnect();
+  // The watched display; nullptr once the server is gone.
+  Display *CurrentDisplay();
+  void WatchWindow(Window window);
+  void ProcessEvents();
+  void SyncClientList();
+  void RefreshWindows(const std::vector<Window> &windows);
+
+  static gboolean OnFdReady(gint fd, GIOCondition condition,
+                            gpointer user_data);
+  static gboolean OnReconnect(gpointer user_data);
+
+  ChangeCallback on_change_;
+  ClientListCallback on_client_list_;
+  X11Connection connection_;
+  std::atomic<Window> active_window_{None};
+  X11WindowTable windows_;
+  guint fd_source_id_ = 0;
+  guint reconnect_source_id_ = 0;
+  std::atomic<bool> active_{false};
+  ServerTimeMapper time_mapper_;
+};
+
+#else
+
+// Without Xlib the X11 detector polls xprop and never watches events.
+class X11EventWatcher {
+public:
+  bool IsActive() const { return false; }
+};
+
+#endif // HAVE_X11
+
+#endif // X11_EVENT_WATCHER_H_
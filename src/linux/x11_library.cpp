@@ -0,0 +1,119 @@
+#include "x11_library.h"
+
+#ifdef HAVE_X11
+#include <dlfcn.h>
+#include <mutex>
+
+namespace {
+
+X11Library g_library;
+bool g_loaded = false;
+std::once_flag g_load_once;
+
+// Sonames, not the unversioned development symlinks, which are only
+// installed with the -dev packages.
+void *OpenLibrary(const char *soname) {
+  return dlopen(soname, RTLD_NOW | RTLD_LOCAL);
+}
+
+// Points *function at symbol in handle. False if it is missing.
+template <typename Function>
+bool Resolve(void *handle, const char *symbol, Function *function) {
+  *function = reinterpret_cast<Function>(dlsym(handle, symbol));
+  return *function != nullptr;
+}
+
+#define RESOLVE(handle, name) Resolve(handle, #name, &library->name)
+
+bool LoadXlib(X11Library *library) {
+  void *x11 = OpenLibrary("libX11.so.6");
+  if (!x11) {
+    return false;
+  }
+  bool ok = RESOLVE(x11, XOpenDisplay) && RESOLVE(x11, XCloseDisplay) &&
+            RESOLVE(x11, XSetErrorHandler) && RESOLVE(x11, XInternAtoms) &&
+            RESOLVE(x11, XGetWindowProperty) && RESOLVE(x11, XFree) &&
+            RESOLVE(x11, XSelectInput) && RESOLVE(x11, XFlush) &&
+            RESOLVE(x11, XPending) && RESOLVE(x11, XNextEvent) &&
+            RESOLVE(x11, XSendEvent) && RESOLVE(x11, XAllocClassHint) &&
+            RESOLVE(x11, XSetClassHint);
+  if (!ok) {
+    dlclose(x11);
+    return false;
+  }
+#ifdef HAVE_XSETIOERROREXITHANDLER
+  // Optional: libX11 < 1.7 lacks it
+  RESOLVE(x11, XSetIOErrorExitHandler);
+#endif
+  return true;
+}
+
+#ifdef HAVE_XCB
+void LoadXcb(X11Library *library) {
+  void *x11_xcb = OpenLibrary("libX11-xcb.so.1");
+  void *xcb = OpenLibrary("libxcb.so.1");
+  library->has_xcb = x11_xcb && xcb && RESOLVE(x11_xcb, XGetXCBConnection) &&
+                     RESOLVE(xcb, xcb_get_property) &&
+                     RESOLVE(xcb, xcb_get_property_reply) &&
+                     RESOLVE(xcb, xcb_get_property_value) &&
+                     RESOLVE(xcb, xcb_get_property_value_length);
+  // libxcb is a dependency of libX11 and stays loaded regardless
+  if (!library->has_xcb && x11_xcb) {
+    dlclose(x11_xcb);
+  }
+}
+#endif
+
+#ifdef HAVE_XRES
+void LoadXRes(X11Library *library) {
+  void *xres = OpenLibrary("libXRes.so.1");
+  library->has_xres = xres && RESOLVE(xres, XResQueryExtension) &&
+                      RESOLVE(xres, XResQueryVersion) &&
+                      RESOLVE(xres, XResQueryClientIds) &&
+                      RESOLVE(xres, XResGetClientIdType) &&
+                      RESOLVE(xres, XResGetClientPid) &&
+                      RESOLVE(xres, XResClientIdsDestroy);
+  if (!library->has_xres && xres) {
+    dlclose(xres);
+  }
+}
+#endif
+
+#ifdef HAVE_XSS
+void LoadXss(X11Library *library) {
+  void *xss = OpenLibrary("libXss.so.1");
+  library->has_xss = xss && RESOLVE(xss, XScreenSaverQueryExtension) &&
+                     RESOLVE(xss, XScreenSaverAllocInfo) &&
+                     RESOLVE(xss, XScreenSaverQueryInfo);
+  if (!library->has_xss && xss) {
+    dlclose(xss);
+  }
+}
+#endif
+
+#undef RESOLVE
+
+} // namespace
+
+const X11Library *LoadX11Library() {
+  std::call_once(g_load_once, [] {
+    if (!LoadXlib(&g_library)) {
+      return;
+    }
+#ifdef HAVE_XCB
+    LoadXcb(&g_library);
+#endif
+#ifdef HAVE_XRES
+    LoadXRes(&g_library);
+#endif
+#ifdef HAVE_XSS
+    LoadXss(&g_library);
+#endif
+    g_loaded = true;
+  });
+  return g_loaded ? &g_library : nullptr;
+}
+
+const X11Library &X11Lib() { return g_library; }
+
+#endif // HAVE_X11
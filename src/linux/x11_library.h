@@ -0,0 +1,95 @@
+#ifndef X11_LIBRARY_H_
+#define X11_LIBRARY_H_
+
+#ifdef HAVE_X11
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#ifdef HAVE_XCB
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#endif
+
+#ifdef HAVE_XRES
+#include <X11/extensions/XRes.h>
+#endif
+
+#ifdef HAVE_XSS
+#include <X11/extensions/scrnsaver.h>
+#endif
+
+// The libX11, libxcb, libXRes and libXss entry points the runner uses,
+// resolved with dlopen the first time an X11 backend needs them. The runner
+// does not link these libraries, so one binary runs with or without them
+// installed; a missing libX11-xcb or libXRes only loses the faster paths.
+//
+// This is not a startup or memory saving: libgdk-3 links libX11 (and so
+// libxcb) for GTK's own X11 backend, so they are mapped on Wayland too. Only
+// libX11-xcb, libXRes and libXss stay unloaded there; libX11-xcb on its own
+// costs about 0.1 ms and 0.4 MiB.
+//
+// Members are named after the functions they point to, so call sites read
+// like plain Xlib: x11->XOpenDisplay(nullptr).
+struct X11Library {
+  decltype(&::XOpenDisplay) XOpenDisplay = nullptr;
+  decltype(&::XCloseDisplay) XCloseDisplay = nullptr;
+  decltype(&::XSetErrorHandler) XSetErrorHandler = nullptr;
+#ifdef HAVE_XSETIOERROREXITHANDLER
+  // Null when the installed libX11 predates 1.7.
+  decltype(&::XSetIOErrorExitHandler) XSetIOErrorExitHandler = nullptr;
+#endif
+  decltype(&::XInternAtoms) XInternAtoms = nullptr;
+  decltype(&::XGetWindowProperty) XGetWindowProperty = nullptr;
+  decltype(&::XFree) XFree = nullptr;
+  decltype(&::XSelectInput) XSelectInput = nullptr;
+  decltype(&::XFlush) XFlush = nullptr;
+  decltype(&::XPending) XPending = nullptr;
+  decltype(&::XNextEvent) XNextEvent = nullptr;
+  decltype(&::XSendEvent) XSendEvent = nullptr;
+  decltype(&::XAllocClassHint) XAllocClassHint = nullptr;
+  decltype(&::XSetClassHint) XSetClassHint = nullptr;
+
+#ifdef HAVE_XCB
+  // libX11-xcb and libxcb. Without them properties are read through Xlib.
+  bool has_xcb = false;
+  decltype(&::XGetXCBConnection) XGetXCBConnection = nullptr;
+  decltype(&::xcb_get_property) xcb_get_property = nullptr;
+  decltype(&::xcb_get_property_reply) xcb_get_property_reply = nullptr;
+  decltype(&::xcb_get_property_value) xcb_get_property_value = nullptr;
+  decltype(&::xcb_get_property_value_length) xcb_get_property_value_length =
+      nullptr;
+#endif
+
+#ifdef HAVE_XRES
+  // libXRes. Without it window PIDs come from _NET_WM_PID.
+  bool has_xres = false;
+  decltype(&::XResQueryExtension) XResQueryExtension = nullptr;
+  decltype(&::XResQueryVersion) XResQueryVersion = nullptr;
+  decltype(&::XResQueryClientIds) XResQueryClientIds = nullptr;
+  decltype(&::XResGetClientIdType) XResGetClientIdType = nullptr;
+  decltype(&::XResGetClientPid) XResGetClientPid = nullptr;
+  decltype(&::XResClientIdsDestroy) XResClientIdsDestroy = nullptr;
+#endif
+
+#ifdef HAVE_XSS
+  // libXss. Without it X11 sessions read idle time over D-Bus.
+  bool has_xss = false;
+  decltype(&::XScreenSaverQueryExtension) XScreenSaverQueryExtension =
+      nullptr;
+  decltype(&::XScreenSaverAllocInfo) XScreenSaverAllocInfo = nullptr;
+  decltype(&::XScreenSaverQueryInfo) XScreenSaverQueryInfo = nullptr;
+#endif
+};
+
+// Loads the libraries on the first call and returns the same table after
+// that; nullptr if libX11 itself is missing. The libraries stay loaded for
+// the rest of the process. Thread-safe.
+const X11Library *LoadX11Library();
+
+// The loaded table. Only valid once LoadX11Library() has succeeded, which
+// every X11Connection::Get() that returned a display implies.
+const X11Library &X11Lib();
+
+#endif // HAVE_X11
+
+#endif // X11_LIBRARY_H_
@@ -0,0 +1,355 @@
+#include "x11_property_fetch.h"
+
+#ifdef HAVE_X11
+#include "x11_library.h"
+#include <X11/Xatom.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef HAVE_XCB
+#include <xcb/xproto.h>
+#endif
+
+namespace {
+
+// Longest property value read, in 32-bit units (16 KiB).
+constexpr long kMaxPropertyLength = 4096;
+// Longest _NET_WM_STATE read; windows rarely carry more than a handful.
+constexpr long kMaxStateAtoms = 32;
+
+// Splits WM_CLASS ("instance\0class\0") into its two strings.
+void ParseWmClass(const char *data, size_t length,
+                  X11WindowProperties *properties) {
+  const char *end = data + length;
+  const char *instance_end =
+      static_cast<const char *>(memchr(data, '\0', length));
+  if (!instance_end) {
+    properties->wm_instance.assign(data, end);
+    return;
+  }
+  properties->wm_instance.assign(data, instance_end);
+
+  const char *class_start = instance_end + 1;
+  if (class_start < end) {
+    const char *class_end = static_cast<const char *>(
+        memchr(class_start, '\0', end - class_start));
+    properties->wm_class.assign(class_start, class_end ? class_end : end);
+  }
+}
+
+// Reads a format-8 property into value. False if it is not set.
+bool GetStringPropertyXlib(Display *display, Window window, Atom property,
+                           Atom type, std::string *value) {
+  const X11Library &x11 = X11Lib();
+  Atom actual_type;
+  int actual_format;
+  unsigned long nitems, bytes_after;
+  unsigned char *prop = nullptr;
+
+  if (x11.XGetWindowProperty(display, window, property, 0,
+                             kMaxPropertyLength, False, type, &actual_type,
+                             &actual_format, &nitems, &bytes_after,
+                             &prop) != Success ||
+      !prop) {
+    return false;
+  }
+  bool found = actual_type != None && actual_format == 8;
+  if (found) {
+    value->assign(reinterpret_cast<char *>(prop), nitems);
+  }
+  x11.XFree(prop);
+  return found;
+}
+
+// Titles end at the first NUL, as they did when read as C strings.
+void TrimTitle(X11WindowProperties *properties) {
+  std::string &title = properties->title;
+  title.erase(std::find(title.begin(), title.end(), '\0'), title.end());
+}
+
+} // namespace
+
+Window FetchActiveWindow(X11Connection &connection) {
+  // Get() may have just found the server gone and failed to reconnect
+  Display *display = connection.Get();
+  if (!display) {
+    return None;
+  }
+
+  const X11Library &x11 = X11Lib();
+  Atom actual_type;
+  int actual_format;
+  unsigned long nitems, bytes_after;
+  unsigned char *prop = nullptr;
+  Window window = None;
+
+  if (x11.XGetWindowProperty(display, connection.Root(),
+                             connection.GetAtom(X11Atom::kNetActiveWindow), 0,
+                             1, False, XA_WINDOW, &actual_type, &actual_format,
+                             &nitems, &bytes_after, &prop) == Success &&
+      prop) {
+    if (nitems > 0) {
+      window = *reinterpret_cast<Window *>(prop);
+    }
+    x11.XFree(prop);
+  }
+  return window;
+}
+
+std::vector<Window> FetchClientList(X11Connection &connection) {
+  // Get() may have just found the server gone and failed to reconnect
+  Display *display = connection.Get();
+  if (!display) {
+    return {};
+  }
+
+  const X11Library &x11 = X11Lib();
+  Atom actual_type;
+  int actual_format;
+  unsigned long nitems, bytes_after;
+  unsigned char *prop = nullptr;
+  std::vector<Window> windows;
+
+  if (x11.XGetWindowProperty(display, connection.Root(),
+                             connection.GetAtom(X11Atom::kNetClientList), 0,
+                             kMaxPropertyLength, False, XA_WINDOW,
+                             &actual_type, &actual_format, &nitems,
+                             &bytes_after, &prop) == Success &&
+      prop) {
+    if (actual_format == 32) {
+      const Window *list = reinterpret_cast<const Window *>(prop);
+      windows.assign(list, list + nitems);
+    }
+    x11.XFree(prop);
+  }
+  return windows;
+}
+
+bool FetchWindowPropertiesXlib(X11Connection &connection, Window window,
+                               X11WindowProperties *properties) {
+  Display *display = connection.Get();
+  if (!display || window == None) {
+    return false;
+  }
+
+  // Title: _NET_WM_NAME is UTF-8, WM_NAME may be Latin-1 or compound text
+  if (GetStringPropertyXlib(display, window,
+                            connection.GetAtom(X11Atom::kNetWmName),
+                            connection.GetAtom(X11Atom::kUtf8String),
+                            &properties->title)) {
+    properties->has_title = true;
+    properties->title_is_utf8 = true;
+  } else if (GetStringPropertyXlib(display, window,
+                                   connection.GetAtom(X11Atom::kWmName),
+                                   AnyPropertyType, &properties->title)) {
+    properties->has_title = true;
+  }
+
+  // Process ID. Xlib hands out format-32 data as longs.
+  const X11Library &x11 = X11Lib();
+  Atom actual_type;
+  int actual_format;
+  unsigned long nitems, bytes_after;
+  unsigned char *prop = nullptr;
+  if (x11.XGetWindowProperty(display, window,
+                             connection.GetAtom(X11Atom::kNetWmPid), 0, 1,
+                             False, XA_CARDINAL, &actual_type, &actual_format,
+                             &nitems, &bytes_after, &prop) == Success &&
+      prop) {
+    if (nitems > 0 && actual_format == 32) {
+      properties->pid = static_cast<int>(*reinterpret_cast<long *>(prop));
+    }
+    x11.XFree(prop);
+  }
+
+  std::string wm_class;
+  if (GetStringPropertyXlib(display, window,
+                            connection.GetAtom(X11Atom::kWmClass), XA_STRING,
+                            &wm_class)) {
+    ParseWmClass(wm_class.data(), wm_class.size(), properties);
+  }
+
+  prop = nullptr;
+  if (x11.XGetWindowProperty(display, window,
+                             connection.GetAtom(X11Atom::kNetWmState), 0,
+                             kMaxStateAtoms, False, XA_ATOM, &actual_type,
+                             &actual_format, &nitems, &bytes_after,
+                             &prop) == Success &&
+      prop) {
+    if (actual_format == 32) {
+      const Atom *states = reinterpret_cast<const Atom *>(prop);
+      Atom hidden = connection.GetAtom(X11Atom::kNetWmStateHidden);
+      properties->hidden = std::find(states, states + nitems, hidden) !=
+                           states + nitems;
+    }
+    x11.XFree(prop);
+  }
+  TrimTitle(properties);
+  return true;
+}
+
+#ifdef HAVE_XCB
+namespace {
+
+// Property requests for one window that have been sent but not answered.
+struct PendingProperties {
+  xcb_get_property_cookie_t net_wm_name;
+  xcb_get_property_cookie_t wm_name;
+  xcb_get_property_cookie_t net_wm_pid;
+  xcb_get_property_cookie_t wm_class;
+  xcb_get_property_cookie_t net_wm_state;
+};
+
+PendingProperties SendPropertyRequests(X11Connection &connection,
+                                       xcb_connection_t *xcb, Window window) {
+  const X11Library &x11 = X11Lib();
+  xcb_window_t xcb_window = static_cast<xcb_window_t>(window);
+  PendingProperties pending;
+  pending.net_wm_name = x11.xcb_get_property(
+      xcb, 0, xcb_window, connection.GetAtom(X11Atom::kNetWmName),
+      connection.GetAtom(X11Atom::kUtf8String), 0, kMaxPropertyLength);
+  pending.wm_name =
+      x11.xcb_get_property(xcb, 0, xcb_window, XCB_ATOM_WM_NAME,
+                           XCB_GET_PROPERTY_TYPE_ANY, 0, kMaxPropertyLength);
+  pending.net_wm_pid =
+      x11.xcb_get_property(xcb, 0, xcb_window,
+                           connection.GetAtom(X11Atom::kNetWmPid),
+                           XCB_ATOM_CARDINAL, 0, 1);
+  pending.wm_class =
+      x11.xcb_get_property(xcb, 0, xcb_window, XCB_ATOM_WM_CLASS,
+                           XCB_ATOM_STRING, 0, kMaxPropertyLength);
+  pending.net_wm_state =
+      x11.xcb_get_property(xcb, 0, xcb_window,
+                           connection.GetAtom(X11Atom::kNetWmState),
+                           XCB_ATOM_ATOM, 0, kMaxStateAtoms);
+  return pending;
+}
+
+// Errors (e.g. BadWindow for a window that just closed) come back with the
+// reply instead of going to the Xlib error handler.
+xcb_get_property_reply_t *TakeReply(xcb_connection_t *xcb,
+                                    xcb_get_property_cookie_t cookie) {
+  xcb_generic_error_t *error = nullptr;
+  xcb_get_property_reply_t *reply =
+      X11Lib().xcb_get_property_reply(xcb, cookie, &error);
+  free(error);
+  if (reply && reply->type == XCB_NONE) {
+    free(reply);
+    return nullptr;
+  }
+  return reply;
+}
+
+void CollectPropertyReplies(X11Connection &connection, xcb_connection_t *xcb,
+                            const PendingProperties &pending,
+                            X11WindowProperties *properties) {
+  const X11Library &x11 = X11Lib();
+  xcb_get_property_reply_t *reply = TakeReply(xcb, pending.net_wm_name);
+  if (reply && reply->format == 8) {
+    properties->title.assign(
+        static_cast<const char *>(x11.xcb_get_property_value(reply)),
+        x11.xcb_get_property_value_length(reply));
+    properties->has_title = true;
+    properties->title_is_utf8 = true;
+  }
+  free(reply);
+
+  // Collected even when unused, so the reply does not linger in the queue
+  reply = TakeReply(xcb, pending.wm_name);
+  if (reply && reply->format == 8 && !properties->has_title) {
+    properties->title.assign(
+        static_cast<const char *>(x11.xcb_get_property_value(reply)),
+        x11.xcb_get_property_value_length(reply));
+    properties->has_title = true;
+  }
+  free(reply);
+
+  reply = TakeReply(xcb, pending.net_wm_pid);
+  if (reply && reply->format == 32 &&
+      x11.xcb_get_property_value_length(reply) >=
+          static_cast<int>(sizeof(uint32_t))) {
+    properties->pid = static_cast<int>(
+        *static_cast<const uint32_t *>(x11.xcb_get_property_value(reply)));
+  }
+  free(reply);
+
+  reply = TakeReply(xcb, pending.wm_class);
+  if (reply && reply->format == 8) {
+    ParseWmClass(static_cast<const char *>(x11.xcb_get_property_value(reply)),
+                 x11.xcb_get_property_value_length(reply), properties);
+  }
+  free(reply);
+
+  reply = TakeReply(xcb, pending.net_wm_state);
+  if (reply && reply->format == 32) {
+    const uint32_t *states =
+        static_cast<const uint32_t *>(x11.xcb_get_property_value(reply));
+    const uint32_t *states_end =
+        states + x11.xcb_get_property_value_length(reply) / sizeof(uint32_t);
+    uint32_t hidden = static_cast<uint32_t>(
+        connection.GetAtom(X11Atom::kNetWmStateHidden));
+    properties->hidden = std::find(states, states_end, hidden) != states_end;
+  }
+  free(reply);
+
+  TrimTitle(properties);
+}
+
+} // namespace
+
+bool FetchWindowPropertiesXcb(X11Connection &connection, Window window,
+                              X11WindowProperties *properties) {
+  Display *display = connection.Get();
+  if (!display || window == None) {
+    return false;
+  }
+  xcb_connection_t *xcb = X11Lib().XGetXCBConnection(display);
+
+  // Send every request before waiting for any reply
+  PendingProperties pending = SendPropertyRequests(connection, xcb, window);
+  CollectPropertyReplies(connection, xcb, pending, properties);
+  return true;
+}
+#endif // HAVE_XCB
+
+bool FetchWindowProperties(X11Connection &connection, Window window,
+                           X11WindowProperties *properties) {
+#ifdef HAVE_XCB
+  if (X11Lib().has_xcb) {
+    return FetchWindowPropertiesXcb(connection, window, properties);
+  }
+#endif
+  return FetchWindowPropertiesXlib(connection, window, properties);
+}
+
+std::vector<X11WindowProperties>
+FetchWindowPropertiesBatch(X11Connection &connection,
+                           const std::vector<Window> &windows) {
+  std::vector<X11WindowProperties> properties(windows.size());
+  Display *display = connection.Get();
+  if (!display) {
+    return properties;
+  }
+
+#ifdef HAVE_XCB
+  if (X11Lib().has_xcb) {
+    xcb_connection_t *xcb = X11Lib().XGetXCBConnection(display);
+    std::vector<PendingProperties> pending;
+    pending.reserve(windows.size());
+    for (Window window : windows) {
+      pending.push_back(SendPropertyRequests(connection, xcb, window));
+    }
+    for (size_t i = 0; i < windows.size(); i++) {
+      CollectPropertyReplies(connection, xcb, pending[i], &properties[i]);
+    }
+    return properties;
+  }
+#endif
+  for (size_t i = 0; i < windows.size(); i++) {
+    FetchWindowPropertiesXlib(connection, windows[i], &properties[i]);
+  }
+  return properties;
+}
+
+#endif // HAVE_X11
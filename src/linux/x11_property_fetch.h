@@ -0,0 +1,60 @@
+#ifndef X11_PROPERTY_FETCH_H_
+#define X11_PROPERTY_FETCH_H_
+
+#include <string>
+#include <vector>
+
+// Properties of one top-level window that window detection needs.
+struct X11WindowProperties {
+  // _NET_WM_NAME if set, WM_NAME otherwise.
+  std::string title;
+  bool has_title = false;
+  // True when title came from _NET_WM_NAME, which is UTF-8 by definition.
+  bool title_is_utf8 = false;
+  // _NET_WM_PID, 0 if not set.
+  int pid = 0;
+  // The two strings of WM_CLASS.
+  std::string wm_instance;
+  std::string wm_class;
+  // _NET_WM_STATE contains _NET_WM_STATE_HIDDEN, i.e. the window is
+  // minimized.
+  bool hidden = false;
+};
+
+#ifdef HAVE_X11
+#include "x11_connection.h"
+
+// Value of _NET_ACTIVE_WINDOW on the root window, None if unset.
+Window FetchActiveWindow(X11Connection &connection);
+
+// _NET_CLIENT_LIST on the root window: the top-level windows the window
+// manager manages, oldest first. Empty without an EWMH window manager.
+std::vector<Window> FetchClientList(X11Connection &connection);
+
+// One blocking XGetWindowProperty round trip per property.
+bool FetchWindowPropertiesXlib(X11Connection &connection, Window window,
+                               X11WindowProperties *properties);
+
+#ifdef HAVE_XCB
+// Sends all property requests at once over the XCB connection underneath
+// Xlib and then collects the replies: a single round trip.
+// Needs X11Lib().has_xcb.
+bool FetchWindowPropertiesXcb(X11Connection &connection, Window window,
+                              X11WindowProperties *properties);
+#endif
+
+// FetchWindowPropertiesXcb when built with XCB and libxcb could be loaded,
+// the Xlib version otherwise.
+bool FetchWindowProperties(X11Connection &connection, Window window,
+                           X11WindowProperties *properties);
+
+// Properties of every window, in the same order. With XCB the requests for
+// all windows go out before the first reply is read, so the whole batch
+// costs one round trip.
+std::vector<X11WindowProperties>
+FetchWindowPropertiesBatch(X11Connection &connection,
+                           const std::vector<Window> &windows);
+
+#endif // HAVE_X11
+
+#endif // X11_PROPERTY_FETCH_H_
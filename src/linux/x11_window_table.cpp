@@ -0,0 +1,79 @@
+#include "x11_window_table.h"
+#include <unordered_set>
+
+std::vector<uint64_t>
+X11WindowTable::SetWindows(const std::vector<uint64_t> &windows) {
+  std::unordered_set<uint64_t> listed(windows.begin(), windows.end());
+  std::vector<uint64_t> added;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto it = properties_.begin(); it != properties_.end();) {
+    if (listed.count(it->first) == 0) {
+      it = properties_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  for (uint64_t window : windows) {
+    if (properties_.emplace(window, X11WindowProperties()).second) {
+      added.push_back(window);
+    }
+  }
+  order_ = windows;
+  return added;
+}
+
+void X11WindowTable::Update(uint64_t window,
+                            const X11WindowProperties &properties) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = properties_.find(window);
+  if (it != properties_.end()) {
+    it->second = properties;
+  }
+}
+
+void X11WindowTable::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  order_.clear();
+  properties_.clear();
+}
+
+bool X11WindowTable::Contains(uint64_t window) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return properties_.count(window) > 0;
+}
+
+size_t X11WindowTable::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return order_.size();
+}
+
+uint64_t X11WindowTable::Find(const std::string &title) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t own_window = 0;
+  for (uint64_t window : order_) {
+    const X11WindowProperties &properties = properties_.at(window);
+    if (!title.empty() &&
+        properties.title.find(title) != std::string::npos) {
+      return window;
+    }
+    // Same fallback as wmctrl -x -a whph
+    if (own_window == 0 &&
+        (properties.title == "whph" || properties.wm_instance == "whph" ||
+         properties.wm_class == "whph")) {
+      own_window = window;
+    }
+  }
+  return own_window;
+}
+
+std::vector<std::pair<uint64_t, X11WindowProperties>>
+X11WindowTable::Snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::pair<uint64_t, X11WindowProperties>> windows;
+  windows.reserve(order_.size());
+  for (uint64_t window : order_) {
+    windows.emplace_back(window, properties_.at(window));
+  }
+  return windows;
+}
@@ -0,0 +1,47 @@
+#ifndef X11_WINDOW_TABLE_H_
+#define X11_WINDOW_TABLE_H_
+
+#include "x11_property_fetch.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// The window manager's client list with the last known properties of each
+// window, kept up to date by X11EventWatcher so that looking up a window by
+// title does not cost a round trip per window.
+//
+// Thread-safe: the watcher writes on the main thread while detector calls
+// read on worker threads.
+class X11WindowTable {
+public:
+  // Replaces the list of windows, in _NET_CLIENT_LIST order. Windows that
+  // are still listed keep their properties. Returns the windows that were
+  // not listed before and still need Update().
+  std::vector<uint64_t> SetWindows(const std::vector<uint64_t> &windows);
+
+  // Ignored for windows that are not listed.
+  void Update(uint64_t window, const X11WindowProperties &properties);
+
+  void Clear();
+
+  bool Contains(uint64_t window) const;
+  size_t Size() const;
+
+  // The first window whose title contains title. Failing that, the first
+  // window of WHPH itself, found by title or WM_CLASS. 0 if neither exists.
+  uint64_t Find(const std::string &title) const;
+
+  // Every listed window with its properties, in client list order.
+  std::vector<std::pair<uint64_t, X11WindowProperties>> Snapshot() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<uint64_t> order_;
+  std::unordered_map<uint64_t, X11WindowProperties> properties_;
+};
+
+#endif // X11_WINDOW_TABLE_H_
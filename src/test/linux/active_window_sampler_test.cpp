@@ -0,0 +1,153 @@
+#include "active_window_sampler.h"
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Detector returning a new title on every call so published snapshots can
+// be told apart.
+class CountingDetector : public WindowDetector {
+public:
+  WindowInfo GetActiveWindow() override {
+    int call = ++calls;
+    return {"title " + std::to_string(call), "app"};
+  }
+  bool FocusWindow(const std::string &windowTitle) override { return false; }
+
+  // Read by the tests while the sampler thread calls in.
+  std::atomic<int> calls{0};
+};
+
+// Polls until the sampler published a snapshot with at least min_sequence.
+static std::shared_ptr<const WindowSnapshot>
+WaitForSequence(ActiveWindowSampler &sampler, uint64_t min_sequence) {
+  for (int i = 0; i < 200; i++) {
+    auto snapshot = sampler.Latest();
+    if (snapshot && snapshot->sequence >= min_sequence) {
+      return snapshot;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return nullptr;
+}
+
+void TestPublishesFirstSnapshot() {
+  std::cout << "Running TestPublishesFirstSnapshot..." << std::endl;
+
+  CountingDetector detector;
+  std::mutex detector_mutex;
+  ActiveWindowSampler sampler(detector, detector_mutex,
+                              std::chrono::seconds(60));
+  assert(sampler.Latest() == nullptr);
+
+  auto before = std::chrono::steady_clock::now();
+  sampler.Start();
+  auto snapshot = WaitForSequence(sampler, 1);
+  assert(snapshot != nullptr);
+  assert(snapshot->info.title == "title 1");
+  assert(snapshot->info.application == "app");
+  assert(snapshot->captured_at >= before);
+  sampler.Stop();
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestRequestSampleWakesSampler() {
+  std::cout << "Running TestRequestSampleWakesSampler..." << std::endl;
+
+  CountingDetector detector;
+  std::mutex detector_mutex;
+  // Long interval: only an explicit request can produce a second snapshot.
+  ActiveWindowSampler sampler(detector, detector_mutex,
+                              std::chrono::seconds(60));
+  sampler.Start();
+  auto first = WaitForSequence(sampler, 1);
+  assert(first != nullptr);
+
+  sampler.RequestSample();
+  auto second = WaitForSequence(sampler, 2);
+  assert(second != nullptr);
+  assert(second->info.title == "title 2");
+  assert(second->captured_at >= first->captured_at);
+
+  // The reader keeps its snapshot intact after newer ones are published.
+  assert(first->info.title == "title 1");
+  sampler.Stop();
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestStopIsIdempotent() {
+  std::cout << "Running TestStopIsIdempotent..." << std::endl;
+
+  CountingDetector detector;
+  std::mutex detector_mutex;
+  ActiveWindowSampler sampler(detector, detector_mutex,
+                              std::chrono::milliseconds(5));
+  sampler.Start();
+  assert(WaitForSequence(sampler, 3) != nullptr);
+  sampler.Stop();
+  sampler.Stop();
+
+  int calls = detector.calls;
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  assert(detector.calls == calls);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestPausesWhileIdle() {
+  std::cout << "Running TestPausesWhileIdle..." << std::endl;
+
+  CountingDetector detector;
+  std::mutex detector_mutex;
+  std::atomic<int64_t> idle_ms{0};
+  ActiveWindowSampler sampler(detector, detector_mutex,
+                              std::chrono::milliseconds(5));
+  sampler.SetIdleProbe(
+      [&idle_ms](std::chrono::milliseconds *idle) {
+        *idle = std::chrono::milliseconds(idle_ms.load());
+        return true;
+      },
+      std::chrono::milliseconds(5));
+  sampler.SetIdleThreshold(std::chrono::seconds(60));
+  sampler.Start();
+  auto active = WaitForSequence(sampler, 2);
+  assert(active != nullptr && !active->idle);
+
+  // Past the threshold: one idle snapshot dated back to the last input,
+  // then no more detections.
+  idle_ms = 120000;
+  std::shared_ptr<const WindowSnapshot> idle;
+  for (int i = 0; i < 200 && !(idle && idle->idle); i++) {
+    idle = sampler.Latest();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  assert(idle && idle->idle);
+  assert(idle->info.title == "unknown");
+  assert(idle->captured_at < active->captured_at);
+  int calls = detector.calls;
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  assert(detector.calls == calls);
+  assert(sampler.Latest()->sequence == idle->sequence);
+
+  // Input again: detection resumes.
+  idle_ms = 0;
+  auto resumed = WaitForSequence(sampler, idle->sequence + 1);
+  assert(resumed != nullptr && !resumed->idle);
+  assert(detector.calls > calls);
+  sampler.Stop();
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestPublishesFirstSnapshot();
+  TestRequestSampleWakesSampler();
+  TestStopIsIdempotent();
+  TestPausesWhileIdle();
+  std::cout << "All active_window_sampler tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include "backend_health.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Clock = BackendHealthTracker::Clock;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+void TestQuarantineWithBackoff() {
+  std::cout << "Running TestQuarantineWithBackoff..." << std::endl;
+
+  BackendHealthTracker tracker(seconds(2), seconds(10), seconds(4));
+  Clock::time_point now = Clock::now();
+
+  // Tolerates a few failures before quarantining
+  for (uint32_t i = 1; i < BackendHealthTracker::kFailuresBeforeQuarantine;
+       i++) {
+    tracker.RecordFailure("gnome-shell", milliseconds(30), now);
+    assert(tracker.ShouldTry("gnome-shell", now));
+  }
+
+  tracker.RecordFailure("gnome-shell", milliseconds(30), now);
+  assert(!tracker.ShouldTry("gnome-shell", now));
+  assert(!tracker.ShouldTry("gnome-shell", now + seconds(1)));
+  assert(tracker.ShouldTry("gnome-shell", now + seconds(2)));
+
+  // Every further failure doubles the quarantine, up to the maximum
+  now += seconds(2);
+  tracker.RecordFailure("gnome-shell", milliseconds(30), now);
+  assert(!tracker.ShouldTry("gnome-shell", now + seconds(3)));
+  assert(tracker.ShouldTry("gnome-shell", now + seconds(4)));
+  for (int i = 0; i < 10; i++) {
+    tracker.RecordFailure("gnome-shell", milliseconds(30), now);
+  }
+  assert(!tracker.ShouldTry("gnome-shell", now + seconds(9)));
+  assert(tracker.ShouldTry("gnome-shell", now + seconds(10)));
+
+  BackendHealthTracker::Stats stats = tracker.Get("gnome-shell");
+  assert(stats.attempts == 14);
+  assert(stats.successes == 0);
+  assert(stats.average_latency == milliseconds(30));
+
+  // Unknown backends are always worth a try
+  assert(tracker.ShouldTry("sway", now));
+  assert(tracker.Get("sway").attempts == 0);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestProvenBackendBackoff() {
+  std::cout << "Running TestProvenBackendBackoff..." << std::endl;
+
+  BackendHealthTracker tracker(seconds(2), seconds(10), seconds(4));
+  Clock::time_point now = Clock::now();
+
+  tracker.RecordSuccess("kwin", milliseconds(20));
+  for (int i = 0; i < 10; i++) {
+    tracker.RecordFailure("kwin", milliseconds(20), now);
+  }
+  // Capped lower because it answered before
+  assert(!tracker.ShouldTry("kwin", now + seconds(3)));
+  assert(tracker.ShouldTry("kwin", now + seconds(4)));
+
+  // A success lifts the quarantine
+  tracker.RecordSuccess("kwin", milliseconds(20));
+  assert(tracker.ShouldTry("kwin", now));
+  assert(tracker.Get("kwin").consecutive_failures == 0);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestOrder() {
+  std::cout << "Running TestOrder..." << std::endl;
+
+  BackendHealthTracker tracker;
+  Clock::time_point now = Clock::now();
+  std::vector<std::string> plan = {"gnome-shell", "sway", "kwin", "wlroots"};
+
+  assert(tracker.Order(plan, now) == plan);
+
+  // The working backend moves to the front
+  tracker.RecordSuccess("kwin", milliseconds(20));
+  std::vector<std::string> order = tracker.Order(plan, now);
+  assert((order ==
+          std::vector<std::string>{"kwin", "gnome-shell", "sway", "wlroots"}));
+
+  // Quarantined backends are left out
+  for (uint32_t i = 0; i < BackendHealthTracker::kFailuresBeforeQuarantine;
+       i++) {
+    tracker.RecordFailure("gnome-shell", milliseconds(30), now);
+  }
+  order = tracker.Order(plan, now);
+  assert((order == std::vector<std::string>{"kwin", "sway", "wlroots"}));
+
+  tracker.Reset();
+  assert(tracker.Order(plan, now) == plan);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestQuarantineWithBackoff();
+  TestProvenBackendBackoff();
+  TestOrder();
+
+  std::cout << "All backend_health tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include "compositor_fingerprint.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void TestPlanFromBusNames() {
+  std::cout << "Running TestPlanFromBusNames..." << std::endl;
+
+  CompositorEnvironment env;
+  env.kwin_owned = true;
+  std::vector<WaylandBackend> plan = PlanWaylandBackends(env);
+  assert(plan.size() == 1);
+  assert(plan[0] == WaylandBackend::kKwin);
+
+  // A running compositor outranks the desktop name
+  env.desktop = "ubuntu:gnome";
+  plan = PlanWaylandBackends(env);
+  assert(plan.size() == 2);
+  assert(plan[0] == WaylandBackend::kKwin);
+  assert(plan[1] == WaylandBackend::kGnomeShell);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestPlanFromDesktop() {
+  std::cout << "Running TestPlanFromDesktop..." << std::endl;
+
+  CompositorEnvironment env;
+  env.desktop = "ubuntu:gnome";
+  std::vector<WaylandBackend> plan = PlanWaylandBackends(env);
+  assert(plan.size() == 1);
+  assert(plan[0] == WaylandBackend::kGnomeShell);
+
+  // Only whole entries match
+  env.desktop = "gnome-flashback";
+  plan = PlanWaylandBackends(env);
+  assert(plan.size() == 4);
+
+  env.desktop = "hyprland";
+  plan = PlanWaylandBackends(env);
+  assert(plan.size() == 1);
+  assert(plan[0] == WaylandBackend::kWlroots);
+
+  env = CompositorEnvironment();
+  env.kde_session = true;
+  plan = PlanWaylandBackends(env);
+  assert(plan.size() == 1);
+  assert(plan[0] == WaylandBackend::kKwin);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestPlanFromSockets() {
+  std::cout << "Running TestPlanFromSockets..." << std::endl;
+
+  CompositorEnvironment env;
+  env.sway_socket = true;
+  env.hyprland = true;
+  std::vector<WaylandBackend> plan = PlanWaylandBackends(env);
+  assert(plan.size() == 2);
+  assert(plan[0] == WaylandBackend::kSway);
+  assert(plan[1] == WaylandBackend::kWlroots);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestPlanWithoutEvidence() {
+  std::cout << "Running TestPlanWithoutEvidence..." << std::endl;
+
+  // Falls back to trying everything in the historical order
+  std::vector<WaylandBackend> plan =
+      PlanWaylandBackends(CompositorEnvironment());
+  assert(plan.size() == 4);
+  assert(plan[0] == WaylandBackend::kGnomeShell);
+  assert(plan[1] == WaylandBackend::kSway);
+  assert(plan[2] == WaylandBackend::kKwin);
+  assert(plan[3] == WaylandBackend::kWlroots);
+
+  assert(std::string(WaylandBackendName(WaylandBackend::kGnomeShell)) ==
+         "gnome-shell");
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestPlanFromBusNames();
+  TestPlanFromDesktop();
+  TestPlanFromSockets();
+  TestPlanWithoutEvidence();
+
+  std::cout << "All compositor_fingerprint tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include "focus_change_filter.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+using std::chrono::milliseconds;
+
+void TestReportsFirstWindowAfterDebounce() {
+  std::cout << "Running TestReportsFirstWindowAfterDebounce..." << std::endl;
+
+  FocusChangeFilter filter(milliseconds(500));
+  FocusChangeFilter::Time t0(0);
+  WindowInfo out;
+
+  filter.Offer({"Editor", "code"}, t0);
+  assert(filter.HasPending());
+  assert(!filter.TakeReady(t0 + milliseconds(499), &out));
+  assert(filter.TimeUntilReady(t0 + milliseconds(200)) == milliseconds(300));
+
+  assert(filter.TakeReady(t0 + milliseconds(500), &out));
+  assert(out.title == "Editor");
+  assert(out.application == "code");
+  assert(!filter.HasPending());
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestDropsRepeatedWindow() {
+  std::cout << "Running TestDropsRepeatedWindow..." << std::endl;
+
+  FocusChangeFilter filter(milliseconds(0));
+  FocusChangeFilter::Time t0(0);
+  WindowInfo out;
+
+  filter.Offer({"Editor", "code"}, t0);
+  assert(filter.TakeReady(t0, &out));
+
+  filter.Offer({"Editor", "code"}, t0 + milliseconds(1000));
+  assert(!filter.HasPending());
+  assert(!filter.TakeReady(t0 + milliseconds(1000), &out));
+
+  // Title change of the same application is a change.
+  filter.Offer({"Editor - file.cpp", "code"}, t0 + milliseconds(2000));
+  assert(filter.TakeReady(t0 + milliseconds(2000), &out));
+  assert(out.title == "Editor - file.cpp");
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestSwitchBackCancelsPendingChange() {
+  std::cout << "Running TestSwitchBackCancelsPendingChange..." << std::endl;
+
+  FocusChangeFilter filter(milliseconds(500));
+  FocusChangeFilter::Time t0(0);
+  WindowInfo out;
+
+  filter.MarkReported({"Editor", "code"});
+  filter.Offer({"Alt-Tab", "kwin"}, t0);
+  assert(filter.HasPending());
+  filter.Offer({"Editor", "code"}, t0 + milliseconds(100));
+  assert(!filter.HasPending());
+  assert(!filter.TakeReady(t0 + milliseconds(1000), &out));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestNewCandidateRestartsDebounce() {
+  std::cout << "Running TestNewCandidateRestartsDebounce..." << std::endl;
+
+  FocusChangeFilter filter(milliseconds(500));
+  FocusChangeFilter::Time t0(0);
+  WindowInfo out;
+
+  filter.Offer({"A", "a"}, t0);
+  filter.Offer({"B", "b"}, t0 + milliseconds(400));
+  assert(!filter.TakeReady(t0 + milliseconds(600), &out));
+  // Reported with the time the window got focus, not when it was taken
+  FocusChangeFilter::Time changed_at(0);
+  assert(filter.TakeReady(t0 + milliseconds(900), &out, &changed_at));
+  assert(out.title == "B");
+  assert(changed_at == t0 + milliseconds(400));
+
+  filter.Reset();
+  assert(!filter.HasReported());
+  filter.Offer({"B", "b"}, t0 + milliseconds(1000));
+  assert(filter.HasPending());
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestReportsFirstWindowAfterDebounce();
+  TestDropsRepeatedWindow();
+  TestSwitchBackCancelsPendingChange();
+  TestNewCandidateRestartsDebounce();
+  std::cout << "All focus_change_filter tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,151 @@
+#include "focus_session_recorder.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+using std::chrono::seconds;
+
+void TestRecordsCompletedSessions() {
+  std::cout << "Running TestRecordsCompletedSessions..." << std::endl;
+
+  FocusSessionRecorder recorder(16, seconds(10));
+  recorder.Record({"Editor", "code"}, seconds(100));
+  recorder.Record({"Editor", "code"}, seconds(101));
+  recorder.Record({"Editor", "code"}, seconds(102));
+  recorder.Record({"Browser", "firefox"}, seconds(103));
+
+  std::vector<FocusSession> sessions = recorder.Drain(false);
+  assert(sessions.size() == 1);
+  assert(sessions[0].application == "code");
+  assert(sessions[0].title == "Editor");
+  assert(sessions[0].start == seconds(100));
+  assert(sessions[0].end == seconds(103));
+
+  // Drained sessions are gone.
+  assert(recorder.Drain(false).empty());
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestSplitsCurrentSessionOnDrain() {
+  std::cout << "Running TestSplitsCurrentSessionOnDrain..." << std::endl;
+
+  FocusSessionRecorder recorder(16, seconds(10));
+  recorder.Record({"Editor", "code"}, seconds(100));
+  recorder.Record({"Editor", "code"}, seconds(105));
+  recorder.Record({"Editor", "code"}, seconds(110));
+
+  std::vector<FocusSession> sessions = recorder.Drain(true);
+  assert(sessions.size() == 1);
+  assert(sessions[0].start == seconds(100));
+  assert(sessions[0].end == seconds(110));
+
+  // The continuation starts where the drained part ended.
+  recorder.Record({"Editor", "code"}, seconds(115));
+  recorder.Record({"Terminal", "konsole"}, seconds(116));
+  sessions = recorder.Drain(true);
+  // The new Terminal session has no duration yet and stays open.
+  assert(sessions.size() == 1);
+  assert(sessions[0].start == seconds(110));
+  assert(sessions[0].end == seconds(116));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestGapEndsSessionAtLastDetection() {
+  std::cout << "Running TestGapEndsSessionAtLastDetection..." << std::endl;
+
+  FocusSessionRecorder recorder(16, seconds(10));
+  recorder.Record({"Editor", "code"}, seconds(100));
+  recorder.Record({"Editor", "code"}, seconds(105));
+  // Machine suspended for an hour; same window after resume.
+  recorder.Record({"Editor", "code"}, seconds(3705));
+  recorder.Record({"Editor", "code"}, seconds(3706));
+
+  std::vector<FocusSession> sessions = recorder.Drain(true);
+  assert(sessions.size() == 2);
+  assert(sessions[0].end == seconds(105));
+  assert(sessions[1].start == seconds(3705));
+  assert(sessions[1].end == seconds(3706));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestUnknownWindowEndsSession() {
+  std::cout << "Running TestUnknownWindowEndsSession..." << std::endl;
+
+  FocusSessionRecorder recorder(16, seconds(10));
+  recorder.Record({"Editor", "code"}, seconds(100));
+  recorder.Record({"unknown", "unknown"}, seconds(102));
+  recorder.Record({"unknown", "unknown"}, seconds(103));
+
+  std::vector<FocusSession> sessions = recorder.Drain(true);
+  assert(sessions.size() == 1);
+  assert(sessions[0].end == seconds(102));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestIdleEndsSessionAtLastInput() {
+  std::cout << "Running TestIdleEndsSessionAtLastInput..." << std::endl;
+
+  FocusSessionRecorder recorder(16, seconds(10));
+  recorder.Record({"Editor", "code"}, seconds(100));
+  recorder.Record({"Editor", "code"}, seconds(105));
+  recorder.Record({"Editor", "code"}, seconds(110));
+  // Last input at 103; the detections after it do not count.
+  recorder.RecordIdle(seconds(103));
+
+  std::vector<FocusSession> sessions = recorder.Drain(true);
+  assert(sessions.size() == 1);
+  assert(sessions[0].start == seconds(100));
+  assert(sessions[0].end == seconds(103));
+
+  // Back at the same window: a new session.
+  recorder.Record({"Editor", "code"}, seconds(900));
+  recorder.Record({"Editor", "code"}, seconds(905));
+  sessions = recorder.Drain(true);
+  assert(sessions.size() == 1);
+  assert(sessions[0].start == seconds(900));
+
+  // Idle before the session started leaves nothing to report.
+  recorder.Record({"Browser", "firefox"}, seconds(1000));
+  recorder.RecordIdle(seconds(800));
+  assert(recorder.Drain(true).empty());
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestBufferIsBounded() {
+  std::cout << "Running TestBufferIsBounded..." << std::endl;
+
+  FocusSessionRecorder recorder(2, seconds(10));
+  recorder.Record({"A", "a"}, seconds(1));
+  recorder.Record({"B", "b"}, seconds(2));
+  recorder.Record({"C", "c"}, seconds(3));
+  recorder.Record({"D", "d"}, seconds(4));
+
+  size_t dropped = 0;
+  std::vector<FocusSession> sessions = recorder.Drain(false, &dropped);
+  assert(sessions.size() == 2);
+  assert(dropped == 1);
+  // The oldest session is the one dropped.
+  assert(sessions[0].title == "B");
+  assert(sessions[1].title == "C");
+
+  recorder.Drain(false, &dropped);
+  assert(dropped == 0);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestRecordsCompletedSessions();
+  TestSplitsCurrentSessionOnDrain();
+  TestGapEndsSessionAtLastDetection();
+  TestUnknownWindowEndsSession();
+  TestIdleEndsSessionAtLastInput();
+  TestBufferIsBounded();
+  std::cout << "All focus_session_recorder tests passed!" << std::endl;
+  return 0;
+}
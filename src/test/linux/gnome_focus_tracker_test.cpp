@@ -0,0 +1,148 @@
+#include "gnome_focus_tracker.h"
+#include "test_dbus_util.h"
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Runs against a private dbus-daemon, with a stand-in for the GNOME Shell
+// extension exporting the same interface.
+
+namespace {
+
+const char *kInterfaceXml =
+    "<node>"
+    "  <interface name='me.ahmetcetinkaya.whph.FocusTracker'>"
+    "    <method name='GetFocus'>"
+    "      <arg type='s' name='title' direction='out'/>"
+    "      <arg type='s' name='app_id' direction='out'/>"
+    "      <arg type='u' name='pid' direction='out'/>"
+    "    </method>"
+    "    <method name='Activate'>"
+    "      <arg type='s' name='title' direction='in'/>"
+    "      <arg type='b' name='activated' direction='out'/>"
+    "    </method>"
+    "    <signal name='FocusChanged'>"
+    "      <arg type='s' name='title'/>"
+    "      <arg type='s' name='app_id'/>"
+    "      <arg type='u' name='pid'/>"
+    "    </signal>"
+    "  </interface>"
+    "</node>";
+
+struct FakeExtension {
+  std::string activated_title;
+};
+
+void HandleMethodCall(GDBusConnection *connection, const gchar *sender,
+                      const gchar *object_path, const gchar *interface_name,
+                      const gchar *method_name, GVariant *parameters,
+                      GDBusMethodInvocation *invocation, gpointer user_data) {
+  FakeExtension *extension = static_cast<FakeExtension *>(user_data);
+  if (g_strcmp0(method_name, "GetFocus") == 0) {
+    g_dbus_method_invocation_return_value(
+        invocation,
+        g_variant_new("(ssu)", "Editor", "org.example.Editor", 42u));
+  } else {
+    const gchar *title = nullptr;
+    g_variant_get(parameters, "(&s)", &title);
+    extension->activated_title = title;
+    g_dbus_method_invocation_return_value(invocation,
+                                          g_variant_new("(b)", TRUE));
+  }
+}
+
+const GDBusInterfaceVTable kVTable = {HandleMethodCall, nullptr, nullptr, {}};
+
+} // namespace
+
+void TestFollowsExtension(const gchar *address) {
+  std::cout << "Running TestFollowsExtension..." << std::endl;
+
+  GDBusConnection *tracker_bus = Connect(address);
+  GDBusConnection *extension_bus = Connect(address);
+  assert(tracker_bus && extension_bus);
+
+  int changes = 0;
+  GnomeFocusTracker tracker(tracker_bus, [&changes] { changes++; });
+  WindowInfo info;
+  assert(!tracker.Current(&info));
+
+  // The extension appears; the current focus is asked for right away
+  FakeExtension extension;
+  GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(kInterfaceXml, nullptr);
+  guint object_id = g_dbus_connection_register_object(
+      extension_bus, GnomeFocusTracker::kObjectPath, node->interfaces[0],
+      &kVTable, &extension, nullptr, nullptr);
+  guint name_id = g_bus_own_name_on_connection(
+      extension_bus, GnomeFocusTracker::kBusName, G_BUS_NAME_OWNER_FLAGS_NONE,
+      nullptr, nullptr, nullptr, nullptr);
+  assert(RunUntil([&] { return tracker.Current(&info); }));
+  assert(tracker.IsActive());
+  assert(info.title == "Editor");
+  assert(info.application == "org.example.Editor");
+  assert(info.pid == 42);
+  assert(info.backend == "gnome-extension");
+
+  // Pushed changes
+  int changes_before = changes;
+  g_dbus_connection_emit_signal(
+      extension_bus, nullptr, GnomeFocusTracker::kObjectPath,
+      GnomeFocusTracker::kInterface, "FocusChanged",
+      g_variant_new("(ssu)", "Terminal", "", 7u), nullptr);
+  assert(RunUntil([&] {
+    return tracker.Current(&info) && info.title == "Terminal";
+  }));
+  assert(info.application == "unknown");
+  assert(info.pid == 7);
+  assert(changes > changes_before);
+
+  // Activate blocks on the reply, which this thread's main context serves
+  std::atomic<bool> done{false};
+  bool activated = false;
+  std::thread caller([&] {
+    activated = tracker.Activate("Term");
+    done = true;
+  });
+  assert(RunUntil([&] { return done.load(); }));
+  caller.join();
+  assert(activated);
+  assert(extension.activated_title == "Term");
+
+  // The extension goes away, e.g. when disabled
+  g_bus_unown_name(name_id);
+  assert(RunUntil([&] { return !tracker.IsActive(); }));
+  assert(!tracker.Current(&info));
+  assert(!tracker.Activate("Term"));
+
+  g_dbus_connection_unregister_object(extension_bus, object_id);
+  g_dbus_node_info_unref(node);
+  g_object_unref(extension_bus);
+  g_object_unref(tracker_bus);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestWithoutBus() {
+  std::cout << "Running TestWithoutBus..." << std::endl;
+
+  GnomeFocusTracker tracker(nullptr, [] {});
+  WindowInfo info;
+  assert(!tracker.IsActive());
+  assert(!tracker.Current(&info));
+  assert(!tracker.Activate("anything"));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestWithoutBus();
+
+  if (!RunOnTestBus(TestFollowsExtension)) {
+    return 0;
+  }
+
+  std::cout << "All gnome_focus_tracker tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,185 @@
+#include "gnome_introspect_windows.h"
+#include "test_dbus_util.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+namespace {
+
+const char *kInterfaceXml =
+    "<node>"
+    "  <interface name='org.gnome.Shell.Introspect'>"
+    "    <method name='GetWindows'>"
+    "      <arg type='a{ta{sv}}' name='windows' direction='out'/>"
+    "    </method>"
+    "    <signal name='WindowsChanged'/>"
+    "    <signal name='RunningApplicationsChanged'/>"
+    "  </interface>"
+    "</node>";
+
+// Stand-in for GNOME Shell's Introspect object.
+struct FakeShell {
+  std::string windows;
+  bool deny = false;
+  int calls = 0;
+};
+
+void HandleMethodCall(GDBusConnection *connection, const gchar *sender,
+                      const gchar *object_path, const gchar *interface_name,
+                      const gchar *method_name, GVariant *parameters,
+                      GDBusMethodInvocation *invocation, gpointer user_data) {
+  FakeShell *shell = static_cast<FakeShell *>(user_data);
+  shell->calls++;
+  if (shell->deny) {
+    g_dbus_method_invocation_return_error_literal(invocation, G_DBUS_ERROR,
+                                                  G_DBUS_ERROR_ACCESS_DENIED,
+                                                  "App not allowed");
+    return;
+  }
+  GVariant *windows = g_variant_new_parsed(shell->windows.c_str());
+  g_dbus_method_invocation_return_value(
+      invocation, g_variant_new_tuple(&windows, 1));
+}
+
+const GDBusInterfaceVTable kVTable = {HandleMethodCall, nullptr, nullptr, {}};
+
+void EmitSignal(GDBusConnection *shell_bus, const char *signal) {
+  g_dbus_connection_emit_signal(shell_bus, nullptr,
+                                "/org/gnome/Shell/Introspect",
+                                "org.gnome.Shell.Introspect", signal, nullptr,
+                                nullptr);
+}
+
+} // namespace
+
+void TestParseIntrospectWindows() {
+  std::cout << "Running TestParseIntrospectWindows..." << std::endl;
+
+  GVariant *reply = g_variant_ref_sink(g_variant_new_parsed(
+      "@a{ta{sv}} {1: {'title': <'Editor'>, 'app-id': <'org.example.Editor'>,"
+      " 'wm-class': <'editor'>, 'has-focus': <true>, 'is-hidden': <false>},"
+      " 2: {'title': <'Music'>, 'app-id': <''>, 'wm-class': <'spotify'>,"
+      " 'has-focus': <false>, 'is-hidden': <true>}}"));
+  std::vector<ToplevelWindow> windows = ParseIntrospectWindows(reply);
+  g_variant_unref(reply);
+
+  assert(windows.size() == 2);
+  assert(windows[0].title == "Editor");
+  assert(windows[0].application == "org.example.Editor");
+  assert(windows[0].focused);
+  assert(!windows[0].minimized);
+  // wm-class stands in for a missing app-id
+  assert(windows[1].application == "spotify");
+  assert(!windows[1].focused);
+  assert(windows[1].minimized);
+  assert(windows[1].pid == 0);
+
+  GVariant *wrong = g_variant_ref_sink(g_variant_new_string("nope"));
+  assert(ParseIntrospectWindows(wrong).empty());
+  g_variant_unref(wrong);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestFollowsShellSignals(const gchar *address) {
+  std::cout << "Running TestFollowsShellSignals..." << std::endl;
+
+  GDBusConnection *table_bus = Connect(address);
+  GDBusConnection *shell_bus = Connect(address);
+  assert(table_bus && shell_bus);
+
+  FakeShell shell;
+  shell.windows = "@a{ta{sv}} {1: {'title': <'Editor'>, "
+                  "'app-id': <'org.example.Editor'>, 'has-focus': <true>}}";
+  GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(kInterfaceXml, nullptr);
+  guint object_id = g_dbus_connection_register_object(
+      shell_bus, "/org/gnome/Shell/Introspect", node->interfaces[0], &kVTable,
+      &shell, nullptr, nullptr);
+
+  int changes = 0;
+  GnomeIntrospectWindows table(table_bus, [&changes] { changes++; });
+  WindowInfo info;
+  assert(!table.Current(&info));
+
+  // Read once when Shell appears
+  guint name_id = g_bus_own_name_on_connection(
+      shell_bus, "org.gnome.Shell", G_BUS_NAME_OWNER_FLAGS_NONE, nullptr,
+      nullptr, nullptr, nullptr);
+  assert(RunUntil([&] { return table.Current(&info); }));
+  assert(info.title == "Editor");
+  assert(info.application == "org.example.Editor");
+  assert(info.backend == "gnome-introspect");
+  assert(table.Windows().size() == 1);
+  assert(shell.calls == 1);
+
+  // Focus queries do not call Shell
+  for (int i = 0; i < 10; i++) {
+    table.Current(&info);
+  }
+  assert(shell.calls == 1);
+
+  // Re-read on WindowsChanged, which Shell emits when a window opens
+  int changes_before = changes;
+  shell.windows = "@a{ta{sv}} {1: {'title': <'Editor'>, "
+                  "'app-id': <'org.example.Editor'>, 'has-focus': <true>}, "
+                  "2: {'title': <'Terminal'>, 'wm-class': <'terminal'>, "
+                  "'has-focus': <false>}}";
+  EmitSignal(shell_bus, "WindowsChanged");
+  assert(RunUntil([&] { return table.Windows().size() == 2; }));
+  assert(changes > changes_before);
+  assert(table.Current(&info));
+  assert(info.title == "Editor");
+
+  // Shell does not emit WindowsChanged when focus moves to another app, only
+  // RunningApplicationsChanged
+  changes_before = changes;
+  shell.windows = "@a{ta{sv}} {1: {'title': <'Editor'>, "
+                  "'app-id': <'org.example.Editor'>, 'has-focus': <false>}, "
+                  "2: {'title': <'Terminal'>, 'wm-class': <'terminal'>, "
+                  "'has-focus': <true>}}";
+  EmitSignal(shell_bus, "RunningApplicationsChanged");
+  assert(RunUntil([&] {
+    return table.Current(&info) && info.title == "Terminal";
+  }));
+  assert(info.application == "terminal");
+  assert(changes > changes_before);
+
+  // Shell goes away
+  g_bus_unown_name(name_id);
+  assert(RunUntil([&] { return !table.IsActive(); }));
+  assert(!table.Current(&info));
+  assert(table.Windows().empty());
+
+  // A restarted Shell that refuses the caller leaves the table inactive
+  shell.deny = true;
+  int calls_before = shell.calls;
+  name_id = g_bus_own_name_on_connection(
+      shell_bus, "org.gnome.Shell", G_BUS_NAME_OWNER_FLAGS_NONE, nullptr,
+      nullptr, nullptr, nullptr);
+  assert(RunUntil([&] { return shell.calls > calls_before; }));
+  EmitSignal(shell_bus, "WindowsChanged");
+  RunUntil([] { return false; }, std::chrono::milliseconds(200));
+  assert(!table.IsActive());
+  // Not asked again after the refusal
+  assert(shell.calls == calls_before + 1);
+
+  g_bus_unown_name(name_id);
+  g_dbus_connection_unregister_object(shell_bus, object_id);
+  g_dbus_node_info_unref(node);
+  g_object_unref(shell_bus);
+  g_object_unref(table_bus);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestParseIntrospectWindows();
+
+  if (!RunOnTestBus(TestFollowsShellSignals)) {
+    return 0;
+  }
+
+  std::cout << "All gnome_introspect_windows tests passed!" << std::endl;
+  return 0;
+}
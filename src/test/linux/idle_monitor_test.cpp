@@ -0,0 +1,46 @@
+#include "idle_monitor.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void TestPlanIdleSources() {
+  std::cout << "Running TestPlanIdleSources..." << std::endl;
+
+  std::vector<IdleSource> plan = PlanIdleSources(true);
+  assert(plan.size() == 4);
+  assert(plan[0] == IdleSource::kXScreenSaver);
+  assert(plan[3] == IdleSource::kLogind);
+
+  // XScreenSaver under XWayland misses input to Wayland clients
+  plan = PlanIdleSources(false);
+  assert(plan.size() == 3);
+  assert(plan[0] == IdleSource::kMutter);
+  assert(plan[1] == IdleSource::kScreenSaver);
+  assert(plan[2] == IdleSource::kLogind);
+
+  assert(std::string(IdleSourceName(IdleSource::kMutter)) == "mutter");
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestLogindIdleTime() {
+  std::cout << "Running TestLogindIdleTime..." << std::endl;
+
+  assert(LogindIdleTime(true, 1000000, 4000000) ==
+         std::chrono::milliseconds(3000));
+  // Not idle, or no timestamp
+  assert(LogindIdleTime(false, 1000000, 4000000).count() == 0);
+  assert(LogindIdleTime(true, 0, 4000000).count() == 0);
+  // A timestamp from the future is not trusted
+  assert(LogindIdleTime(true, 5000000, 4000000).count() == 0);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestPlanIdleSources();
+  TestLogindIdleTime();
+  std::cout << "All idle_monitor tests passed!" << std::endl;
+  return 0;
+}
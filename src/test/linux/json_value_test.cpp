@@ -0,0 +1,79 @@
+#include "json_value.h"
+#include <cassert>
+#include <iostream>
+#include <string>
+
+void TestParsesDocuments() {
+  std::cout << "Running TestParsesDocuments..." << std::endl;
+
+  JsonValue value;
+  assert(JsonValue::Parse(
+      " {\"name\": \"Terminal\", \"id\": 94, \"focused\": true, "
+      "\"app_id\": null, \"rect\": {\"x\": -1.5e1}, "
+      "\"nodes\": [1, \"two\", [], {}]} ",
+      &value));
+  assert(value.IsObject());
+  assert(value.Get("name").AsString() == "Terminal");
+  assert(value.Get("id").AsNumber() == 94);
+  assert(value.Get("focused").AsBool());
+  assert(value.Get("app_id").IsNull());
+  assert(value.Get("rect").Get("x").AsNumber() == -15);
+  assert(value.Get("nodes").Items().size() == 4);
+  assert(value.Get("nodes").Items()[1].AsString() == "two");
+  assert(value.Get("nodes").Items()[2].IsArray());
+
+  // Missing members and mismatched types give the fallback
+  assert(value.Get("missing").IsNull());
+  assert(value.Get("missing").Get("deeper").IsNull());
+  assert(value.Get("name").AsNumber(-1) == -1);
+  assert(value.Get("id").AsString("none") == "none");
+  assert(value.Get("name").Items().empty());
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestDecodesStrings() {
+  std::cout << "Running TestDecodesStrings..." << std::endl;
+
+  JsonValue value;
+  assert(JsonValue::Parse(
+      "\"It's a \\\"title\\\" \\u00e9 \\ud83d\\ude00 \\/\\\\\\n\"", &value));
+  assert(value.AsString() ==
+         "It's a \"title\" \xc3\xa9 \xf0\x9f\x98\x80 /\\\n");
+
+  // Unpaired surrogates become U+FFFD
+  assert(JsonValue::Parse("\"\\ud83d!\"", &value));
+  assert(value.AsString() == "\xef\xbf\xbd!");
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestRejectsMalformed() {
+  std::cout << "Running TestRejectsMalformed..." << std::endl;
+
+  const char *malformed[] = {
+      "", "[\"My Title\",\"app", "[1,]", "[1 2]", "[1] [2]", "{\"a\" 1}",
+      "{1: 2}", "{\"a\":1,}", "tru", "\"\\u12\"", "nan", "+1",
+  };
+  for (const char *text : malformed) {
+    JsonValue value;
+    assert(!JsonValue::Parse(text, &value));
+    assert(value.IsNull());
+  }
+
+  // Nesting deep enough to exhaust the stack is refused
+  std::string deep(100000, '[');
+  JsonValue value;
+  assert(!JsonValue::Parse(deep + std::string(100000, ']'), &value));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestParsesDocuments();
+  TestDecodesStrings();
+  TestRejectsMalformed();
+
+  std::cout << "All json_value tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,249 @@
+#include "kwin_focus_tracker.h"
+#include "test_dbus_util.h"
+#include <atomic>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Runs against a private dbus-daemon, with stand-ins for KWin's scripting
+// interface and for kglobalaccel that play the script's part.
+
+namespace {
+
+const char *kScriptingXml =
+    "<node>"
+    "  <interface name='org.kde.kwin.Scripting'>"
+    "    <method name='unloadScript'>"
+    "      <arg type='s' name='name' direction='in'/>"
+    "      <arg type='b' direction='out'/>"
+    "    </method>"
+    "    <method name='loadScript'>"
+    "      <arg type='s' name='path' direction='in'/>"
+    "      <arg type='s' name='name' direction='in'/>"
+    "      <arg type='i' direction='out'/>"
+    "    </method>"
+    "    <method name='start'/>"
+    "  </interface>"
+    "</node>";
+
+const char *kComponentXml =
+    "<node>"
+    "  <interface name='org.kde.kglobalaccel.Component'>"
+    "    <method name='invokeShortcut'>"
+    "      <arg type='s' name='name' direction='in'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+struct FakeKwin {
+  GDBusConnection *connection = nullptr;
+  // Unique name of the tracker's connection.
+  std::string tracker;
+  std::string script;
+  bool started = false;
+  std::string requested_title;
+};
+
+void HandleScripting(GDBusConnection *connection, const gchar *sender,
+                     const gchar *object_path, const gchar *interface_name,
+                     const gchar *method_name, GVariant *parameters,
+                     GDBusMethodInvocation *invocation, gpointer user_data) {
+  FakeKwin *kwin = static_cast<FakeKwin *>(user_data);
+  if (g_strcmp0(method_name, "unloadScript") == 0) {
+    g_dbus_method_invocation_return_value(invocation,
+                                          g_variant_new("(b)", FALSE));
+  } else if (g_strcmp0(method_name, "loadScript") == 0) {
+    const gchar *path = nullptr;
+    g_variant_get(parameters, "(&s&s)", &path, nullptr);
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    kwin->script = content.str();
+    g_dbus_method_invocation_return_value(invocation,
+                                          g_variant_new("(i)", 0));
+  } else {
+    kwin->started = true;
+    g_dbus_method_invocation_return_value(invocation, nullptr);
+  }
+}
+
+void OnFocusRequestTaken(GObject *source, GAsyncResult *result,
+                         gpointer user_data) {
+  FakeKwin *kwin = static_cast<FakeKwin *>(user_data);
+  GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                  result, nullptr);
+  assert(reply);
+  const gchar *title = nullptr;
+  g_variant_get(reply, "(&s)", &title);
+  kwin->requested_title = title;
+  g_variant_unref(reply);
+
+  g_dbus_connection_call(
+      kwin->connection, kwin->tracker.c_str(), KwinFocusTracker::kObjectPath,
+      KwinFocusTracker::kInterface, "FocusRequestDone",
+      g_variant_new("(b)", TRUE), nullptr, G_DBUS_CALL_FLAGS_NONE, -1,
+      nullptr, nullptr, nullptr);
+}
+
+// Does what the script does when its shortcut is invoked. Asynchronously:
+// the tracker answers on this thread's main context.
+void HandleComponent(GDBusConnection *connection, const gchar *sender,
+                     const gchar *object_path, const gchar *interface_name,
+                     const gchar *method_name, GVariant *parameters,
+                     GDBusMethodInvocation *invocation, gpointer user_data) {
+  FakeKwin *kwin = static_cast<FakeKwin *>(user_data);
+  g_dbus_method_invocation_return_value(invocation, nullptr);
+  g_dbus_connection_call(
+      kwin->connection, kwin->tracker.c_str(), KwinFocusTracker::kObjectPath,
+      KwinFocusTracker::kInterface, "TakeFocusRequest", nullptr,
+      G_VARIANT_TYPE("(s)"), G_DBUS_CALL_FLAGS_NONE, -1, nullptr,
+      OnFocusRequestTaken, kwin);
+}
+
+// Stores the error a call failed with in *user_data.
+void OnCallFailed(GObject *source, GAsyncResult *result, gpointer user_data) {
+  GError *error = nullptr;
+  GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                  result, &error);
+  assert(!reply);
+  *static_cast<GError **>(user_data) = error;
+}
+
+void OnNameAcquired(GDBusConnection *connection, const gchar *name,
+                    gpointer user_data) {
+  *static_cast<bool *>(user_data) = true;
+}
+
+const GDBusInterfaceVTable kScriptingVTable = {HandleScripting, nullptr,
+                                               nullptr, {}};
+const GDBusInterfaceVTable kComponentVTable = {HandleComponent, nullptr,
+                                               nullptr, {}};
+
+guint Export(GDBusConnection *connection, const char *xml, const char *path,
+             const GDBusInterfaceVTable *vtable, FakeKwin *kwin) {
+  GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(xml, nullptr);
+  guint id = g_dbus_connection_register_object(
+      connection, path, node->interfaces[0], vtable, kwin, nullptr, nullptr);
+  g_dbus_node_info_unref(node);
+  return id;
+}
+
+} // namespace
+
+void TestScriptCallsBack() {
+  std::cout << "Running TestScriptCallsBack..." << std::endl;
+
+  std::string script = KwinFocusTrackerScript(":1.42");
+  assert(script.find("\":1.42\"") != std::string::npos);
+  assert(script.find(KwinFocusTracker::kObjectPath) != std::string::npos);
+  assert(script.find("windowActivated") != std::string::npos);
+  assert(script.find("captionChanged") != std::string::npos);
+  assert(script.find(KwinFocusTracker::kFocusShortcut) != std::string::npos);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestFollowsScript(const gchar *address) {
+  std::cout << "Running TestFollowsScript..." << std::endl;
+
+  GDBusConnection *tracker_bus = Connect(address);
+  FakeKwin kwin;
+  kwin.connection = Connect(address);
+  kwin.tracker = g_dbus_connection_get_unique_name(tracker_bus);
+  assert(tracker_bus && kwin.connection);
+
+  int changes = 0;
+  KwinFocusTracker tracker(tracker_bus, [&changes] { changes++; });
+  WindowInfo info;
+  assert(!tracker.Current(&info));
+
+  // KWin appears: the script is loaded once, addressed to this runner
+  guint scripting_id = Export(kwin.connection, kScriptingXml, "/Scripting",
+                              &kScriptingVTable, &kwin);
+  guint kwin_name = g_bus_own_name_on_connection(
+      kwin.connection, "org.kde.KWin", G_BUS_NAME_OWNER_FLAGS_NONE, nullptr,
+      nullptr, nullptr, nullptr);
+  assert(RunUntil([&] { return kwin.started; }));
+  assert(kwin.script.find("\"" + kwin.tracker + "\"") != std::string::npos);
+  // Not active until the script reports
+  assert(!tracker.IsActive());
+
+  // The script reports the active window
+  g_dbus_connection_call(
+      kwin.connection, kwin.tracker.c_str(), KwinFocusTracker::kObjectPath,
+      KwinFocusTracker::kInterface, "FocusChanged",
+      g_variant_new("(sss)", "Document - Kate", "kate", "1234"), nullptr,
+      G_DBUS_CALL_FLAGS_NONE, -1, nullptr, nullptr, nullptr);
+  assert(RunUntil([&] { return tracker.Current(&info); }));
+  assert(info.title == "Document - Kate");
+  assert(info.application == "kate");
+  assert(info.pid == 1234);
+  assert(info.backend == "kwin-tracker");
+  assert(changes == 1);
+
+  // Other clients on the bus cannot pose as the script
+  GDBusConnection *intruder = Connect(address);
+  assert(intruder);
+  GError *error = nullptr;
+  g_dbus_connection_call(
+      intruder, kwin.tracker.c_str(), KwinFocusTracker::kObjectPath,
+      KwinFocusTracker::kInterface, "FocusChanged",
+      g_variant_new("(sss)", "Spoofed", "spoof", "1"), nullptr,
+      G_DBUS_CALL_FLAGS_NONE, -1, nullptr, OnCallFailed, &error);
+  assert(RunUntil([&] { return error != nullptr; }));
+  assert(g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_ACCESS_DENIED));
+  g_error_free(error);
+  assert(tracker.Current(&info));
+  assert(info.title == "Document - Kate");
+  assert(changes == 1);
+  g_object_unref(intruder);
+
+  // Focus requests go out through the shortcut and come back through
+  // the exported object
+  guint component_id = Export(kwin.connection, kComponentXml,
+                              "/component/kwin", &kComponentVTable, &kwin);
+  bool accel_owned = false;
+  guint accel_name = g_bus_own_name_on_connection(
+      kwin.connection, "org.kde.kglobalaccel", G_BUS_NAME_OWNER_FLAGS_NONE,
+      OnNameAcquired, nullptr, &accel_owned, nullptr);
+  assert(RunUntil([&] { return accel_owned; }));
+  std::atomic<bool> done{false};
+  bool activated = false;
+  std::thread caller([&] {
+    activated = tracker.Activate("Kate");
+    done = true;
+  });
+  assert(RunUntil([&] { return done.load(); }));
+  caller.join();
+  assert(activated);
+  assert(kwin.requested_title == "Kate");
+  assert(!tracker.Activate(""));
+
+  // KWin goes away
+  g_bus_unown_name(kwin_name);
+  assert(RunUntil([&] { return !tracker.IsActive(); }));
+  assert(!tracker.Current(&info));
+
+  g_bus_unown_name(accel_name);
+  g_dbus_connection_unregister_object(kwin.connection, component_id);
+  g_dbus_connection_unregister_object(kwin.connection, scripting_id);
+  g_object_unref(kwin.connection);
+  g_object_unref(tracker_bus);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestScriptCallsBack();
+
+  // Also points SessionBus(), which Activate() uses, at the private bus
+  if (!RunOnTestBus(TestFollowsScript)) {
+    return 0;
+  }
+
+  std::cout << "All kwin_focus_tracker tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include "process_runner.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void TestCollectsOutput() {
+  std::cout << "Running TestCollectsOutput..." << std::endl;
+
+  ProcessResult result = RunProcess({"echo", "hello world"});
+  assert(result.started);
+  assert(!result.timed_out);
+  assert(result.exit_status == 0);
+  assert(result.output == "hello world\n");
+
+  // Trailing newline is stripped
+  assert(RunProcessOutput({"echo", "hello"}) == "hello");
+
+  // Arguments are passed as-is, no shell expansion
+  assert(RunProcessOutput({"echo", "$HOME; 'quoted'"}) == "$HOME; 'quoted'");
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestExitStatus() {
+  std::cout << "Running TestExitStatus..." << std::endl;
+
+  ProcessResult result = RunProcess({"sh", "-c", "echo partial; exit 3"});
+  assert(result.started);
+  assert(result.exit_status == 3);
+  assert(!result.Succeeded());
+  assert(RunProcessOutput({"sh", "-c", "echo partial; exit 3"}).empty());
+
+  assert(RunProcessSucceeded({"true"}));
+  assert(!RunProcessSucceeded({"false"}));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestMissingBinary() {
+  std::cout << "Running TestMissingBinary..." << std::endl;
+
+  ProcessResult result = RunProcess({"whph-no-such-command"});
+  assert(!result.started);
+  assert(!result.Succeeded());
+  assert(!RunProcessSucceeded({}));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestTimeout() {
+  std::cout << "Running TestTimeout..." << std::endl;
+
+  ProcessOptions options;
+  options.timeout = std::chrono::milliseconds(200);
+
+  auto start = std::chrono::steady_clock::now();
+  ProcessResult result = RunProcess({"sleep", "10"}, options);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  assert(result.started);
+  assert(result.timed_out);
+  assert(!result.Succeeded());
+  assert(elapsed < std::chrono::seconds(5));
+
+  // Children of the process are killed with it
+  start = std::chrono::steady_clock::now();
+  result = RunProcess({"sh", "-c", "sleep 10 | cat"}, options);
+  elapsed = std::chrono::steady_clock::now() - start;
+  assert(result.timed_out);
+  assert(elapsed < std::chrono::seconds(5));
+
+  // So is one that closes its stdout and keeps running past the deadline
+  start = std::chrono::steady_clock::now();
+  result = RunProcess({"sh", "-c", "echo early; exec >&-; sleep 10"}, options);
+  elapsed = std::chrono::steady_clock::now() - start;
+  assert(result.started);
+  assert(result.timed_out);
+  assert(result.output == "early\n");
+  assert(!result.Succeeded());
+  assert(elapsed < std::chrono::seconds(5));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestMaxOutput() {
+  std::cout << "Running TestMaxOutput..." << std::endl;
+
+  ProcessOptions options;
+  options.max_output = 4;
+  ProcessResult result = RunProcess({"echo", "truncated"}, options);
+  assert(result.Succeeded());
+  assert(result.output == "trun");
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestStreamsLines() {
+  std::cout << "Running TestStreamsLines..." << std::endl;
+
+  std::vector<std::string> lines;
+  ProcessResult result =
+      RunProcessLines({"printf", "one\ntwo\nthree"},
+                      [&lines](const std::string &line) {
+                        lines.push_back(line);
+                        return true;
+                      });
+  assert(result.Succeeded());
+  assert(!result.stopped);
+  assert(lines.size() == 3);
+  assert(lines[0] == "one");
+  assert(lines[2] == "three"); // Unterminated last line
+
+  // Returning false kills the producer instead of waiting for it
+  ProcessOptions options;
+  options.timeout = std::chrono::seconds(10);
+  size_t seen = 0;
+  auto start = std::chrono::steady_clock::now();
+  result = RunProcessLines({"sh", "-c", "echo found; sleep 10; echo late"},
+                           [&seen](const std::string &line) {
+                             seen++;
+                             return line != "found";
+                           },
+                           options);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  assert(result.started);
+  assert(result.stopped);
+  assert(!result.timed_out);
+  assert(seen == 1);
+  assert(elapsed < std::chrono::seconds(5));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestCommandExists() {
+  std::cout << "Running TestCommandExists..." << std::endl;
+
+  assert(CommandExists("sh"));
+  assert(CommandExists("/bin/sh"));
+  assert(!CommandExists("whph-no-such-command"));
+  assert(!CommandExists(""));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestCollectsOutput();
+  TestExitStatus();
+  TestMissingBinary();
+  TestTimeout();
+  TestMaxOutput();
+  TestStreamsLines();
+  TestCommandExists();
+
+  std::cout << "All process_runner tests passed!" << std::endl;
+  return 0;
+}
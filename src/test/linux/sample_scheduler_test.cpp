@@ -0,0 +1,87 @@
+#include "sample_scheduler.h"
+#include <cassert>
+#include <iostream>
+
+using std::chrono::microseconds;
+using std::chrono::seconds;
+
+namespace {
+
+void FeedSteady(AdaptiveSampleInterval *interval, int count) {
+  for (int i = 0; i < count; i++) {
+    interval->OnSample(false, microseconds(1000));
+  }
+}
+
+} // namespace
+
+void TestBacksOffWhileFocusIsSteady() {
+  std::cout << "Running TestBacksOffWhileFocusIsSteady..." << std::endl;
+
+  AdaptiveSampleInterval interval;
+  interval.OnSample(true, microseconds(1000));
+  assert(interval.Interval() == AdaptiveSampleInterval::kMinInterval);
+
+  FeedSteady(&interval, AdaptiveSampleInterval::kSamplesPerStep);
+  assert(interval.Interval() == seconds(2));
+  FeedSteady(&interval, AdaptiveSampleInterval::kSamplesPerStep);
+  assert(interval.Interval() == seconds(4));
+  FeedSteady(&interval, 100);
+  assert(interval.Interval() == AdaptiveSampleInterval::kMaxInterval);
+
+  // A change goes straight back to the fastest rate
+  interval.OnSample(true, microseconds(1000));
+  assert(interval.Interval() == AdaptiveSampleInterval::kMinInterval);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestSlowerOnBattery() {
+  std::cout << "Running TestSlowerOnBattery..." << std::endl;
+
+  AdaptiveSampleInterval interval;
+  interval.SetOnBattery(true);
+  interval.OnSample(true, microseconds(1000));
+  assert(interval.Interval() == seconds(2));
+  FeedSteady(&interval, 100);
+  assert(interval.Interval() == AdaptiveSampleInterval::kMaxIntervalOnBattery);
+
+  interval.SetOnBattery(false);
+  assert(interval.Interval() == AdaptiveSampleInterval::kMaxInterval);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestEventDrivenUsesMaximum() {
+  std::cout << "Running TestEventDrivenUsesMaximum..." << std::endl;
+
+  AdaptiveSampleInterval interval;
+  interval.SetEventDriven(true);
+  interval.OnSample(true, microseconds(1000));
+  assert(interval.Interval() == AdaptiveSampleInterval::kMaxInterval);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestSlowBackendStretchesInterval() {
+  std::cout << "Running TestSlowBackendStretchesInterval..." << std::endl;
+
+  AdaptiveSampleInterval interval;
+  // 120ms * 20 = 2.4s, rounded up
+  interval.OnSample(true, microseconds(120000));
+  assert(interval.Interval() == seconds(3));
+  // Still capped
+  interval.OnSample(true, microseconds(2000000));
+  assert(interval.Interval() == AdaptiveSampleInterval::kMaxInterval);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestBacksOffWhileFocusIsSteady();
+  TestSlowerOnBattery();
+  TestEventDrivenUsesMaximum();
+  TestSlowBackendStretchesInterval();
+  std::cout << "All sample_scheduler tests passed!" << std::endl;
+  return 0;
+}
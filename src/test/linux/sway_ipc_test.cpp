@@ -0,0 +1,416 @@
+#include "sway_ipc.h"
+#include "test_dbus_util.h"
+#include <glib-unix.h>
+
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// The client runs against a stand-in for sway that listens on a socket in a
+// temporary directory and is served from the main context.
+
+namespace {
+
+std::string ViewJson(int id, const std::string &name,
+                     const std::string &app_id, int pid, bool focused) {
+  return "{\"id\":" + std::to_string(id) +
+         ",\"type\":\"con\",\"name\":\"" + name + "\",\"app_id\":\"" +
+         app_id + "\",\"pid\":" + std::to_string(pid) +
+         ",\"focused\":" + (focused ? "true" : "false") +
+         ",\"nodes\":[],\"floating_nodes\":[]}";
+}
+
+// An output with one workspace holding a tiled terminal, WHPH under
+// XWayland and a floating editor. Focus is on the terminal.
+const char *kTree =
+    "{\"id\":1,\"type\":\"root\",\"name\":\"root\",\"nodes\":["
+    "{\"id\":2,\"type\":\"output\",\"name\":\"eDP-1\",\"nodes\":["
+    "{\"id\":3,\"type\":\"workspace\",\"name\":\"1\",\"focused\":false,"
+    "\"nodes\":[{\"id\":7,\"type\":\"con\",\"name\":null,\"nodes\":["
+    "{\"id\":4,\"type\":\"con\",\"name\":\"~ - foot\",\"app_id\":\"foot\","
+    "\"pid\":100,\"focused\":true,\"nodes\":[],\"floating_nodes\":[]},"
+    "{\"id\":5,\"type\":\"con\",\"name\":\"WHPH\",\"app_id\":null,"
+    "\"pid\":200,\"window_properties\":{\"class\":\"whph\"},"
+    "\"focused\":false,\"nodes\":[],\"floating_nodes\":[]}]}],"
+    "\"floating_nodes\":[{\"id\":6,\"type\":\"floating_con\","
+    "\"name\":\"Notes \\u00e9\",\"app_id\":\"org.gnome.TextEditor\","
+    "\"pid\":300,\"focused\":false,\"nodes\":[],\"floating_nodes\":[]}]}"
+    "]}]}";
+
+class FakeSway {
+public:
+  explicit FakeSway(const std::string &path) {
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+    assert(bind(listen_fd_, reinterpret_cast<sockaddr *>(&address),
+                sizeof(address)) == 0);
+    assert(listen(listen_fd_, 4) == 0);
+    listen_id_ = g_unix_fd_add(listen_fd_, G_IO_IN, OnAccept, this);
+  }
+
+  ~FakeSway() { Stop(); }
+
+  // Drops every connection and stops listening.
+  void Stop() {
+    if (listen_fd_ >= 0) {
+      g_source_remove(listen_id_);
+      close(listen_fd_);
+      listen_fd_ = -1;
+    }
+    for (auto &client : clients_) {
+      client->Close();
+    }
+  }
+
+  // Sends a window event to every subscribed connection.
+  void SendWindowEvent(const std::string &change, const std::string &view) {
+    std::string event = EncodeSwayIpcMessage(
+        SwayIpcType::kWindowEvent,
+        "{\"change\":\"" + change + "\",\"container\":" + view + "}");
+    for (auto &client : clients_) {
+      if (client->subscribed) {
+        client->Send(event);
+      }
+    }
+  }
+
+  std::string tree = kTree;
+  std::vector<std::string> commands;
+
+private:
+  struct Client {
+    FakeSway *sway = nullptr;
+    int fd = -1;
+    guint source_id = 0;
+    bool subscribed = false;
+    SwayIpcDecoder decoder;
+
+    void Send(const std::string &data) {
+      assert(send(fd, data.data(), data.size(), MSG_NOSIGNAL) ==
+             static_cast<ssize_t>(data.size()));
+    }
+
+    void Close() {
+      if (fd >= 0) {
+        g_source_remove(source_id);
+        close(fd);
+        fd = -1;
+      }
+    }
+  };
+
+  void Handle(Client *client, const SwayIpcMessage &message) {
+    switch (message.type) {
+    case SwayIpcType::kSubscribe:
+      assert(message.payload == "[\"window\"]");
+      client->subscribed = true;
+      client->Send(EncodeSwayIpcMessage(message.type, "{\"success\":true}"));
+      break;
+    case SwayIpcType::kGetTree:
+      client->Send(EncodeSwayIpcMessage(message.type, tree));
+      break;
+    case SwayIpcType::kRunCommand:
+      commands.push_back(message.payload);
+      client->Send(
+          EncodeSwayIpcMessage(message.type, "[{\"success\":true}]"));
+      break;
+    }
+  }
+
+  static gboolean OnAccept(gint fd, GIOCondition condition,
+                           gpointer user_data) {
+    FakeSway *sway = static_cast<FakeSway *>(user_data);
+    std::unique_ptr<Client> client(new Client);
+    client->sway = sway;
+    client->fd = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+    assert(client->fd >= 0);
+    client->source_id =
+        g_unix_fd_add(client->fd, static_cast<GIOCondition>(G_IO_IN | G_IO_HUP),
+                      OnClientReady, client.get());
+    sway->clients_.push_back(std::move(client));
+    return G_SOURCE_CONTINUE;
+  }
+
+  static gboolean OnClientReady(gint fd, GIOCondition condition,
+                                gpointer user_data) {
+    Client *client = static_cast<Client *>(user_data);
+    char buffer[4096];
+    ssize_t size = recv(fd, buffer, sizeof(buffer), 0);
+    if (size <= 0) {
+      // Returning G_SOURCE_REMOVE removes the source
+      close(client->fd);
+      client->fd = -1;
+      return G_SOURCE_REMOVE;
+    }
+    client->decoder.Feed(buffer, static_cast<size_t>(size));
+    SwayIpcMessage message;
+    while (client->decoder.Next(&message)) {
+      client->sway->Handle(client, message);
+    }
+    return G_SOURCE_CONTINUE;
+  }
+
+  int listen_fd_ = -1;
+  guint listen_id_ = 0;
+  std::vector<std::unique_ptr<Client>> clients_;
+};
+
+// Runs call on another thread while the main context serves the stand-in.
+template <typename Result>
+Result CallOffMainThread(const std::function<Result()> &call) {
+  std::atomic<bool> done{false};
+  Result result{};
+  std::thread caller([&] {
+    result = call();
+    done = true;
+  });
+  bool finished = RunUntil([&] { return done.load(); });
+  caller.join();
+  assert(finished);
+  return result;
+}
+
+} // namespace
+
+void TestFramesMessages() {
+  std::cout << "Running TestFramesMessages..." << std::endl;
+
+  std::string stream = EncodeSwayIpcMessage(SwayIpcType::kGetTree, "") +
+                       EncodeSwayIpcMessage(SwayIpcType::kWindowEvent, "{}");
+  assert(stream.size() == 14 + 14 + 2);
+  assert(stream.compare(0, 6, "i3-ipc") == 0);
+
+  // Split anywhere, e.g. byte by byte
+  SwayIpcDecoder decoder;
+  SwayIpcMessage message;
+  std::vector<SwayIpcMessage> messages;
+  for (char c : stream) {
+    decoder.Feed(&c, 1);
+    while (decoder.Next(&message)) {
+      messages.push_back(message);
+    }
+  }
+  assert(messages.size() == 2);
+  assert(messages[0].type == SwayIpcType::kGetTree);
+  assert(messages[0].payload.empty());
+  assert(messages[1].type == SwayIpcType::kWindowEvent);
+  assert(messages[1].payload == "{}");
+  assert(!decoder.Failed());
+
+  // Anything that is not i3 IPC stops the decoder for good
+  decoder.Feed("not-ipc-at-all", 14);
+  assert(!decoder.Next(&message));
+  assert(decoder.Failed());
+  std::string valid = EncodeSwayIpcMessage(SwayIpcType::kGetTree, "");
+  decoder.Feed(valid.data(), valid.size());
+  assert(!decoder.Next(&message));
+
+  // As does a length no compositor would send
+  SwayIpcDecoder oversized;
+  std::string header = EncodeSwayIpcMessage(SwayIpcType::kGetTree, "");
+  uint32_t size = SwayIpcDecoder::kMaxPayloadSize + 1;
+  header.replace(6, sizeof(size), reinterpret_cast<const char *>(&size),
+                 sizeof(size));
+  oversized.Feed(header.data(), header.size());
+  assert(!oversized.Next(&message));
+  assert(oversized.Failed());
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestParsesTree() {
+  std::cout << "Running TestParsesTree..." << std::endl;
+
+  JsonValue tree;
+  assert(JsonValue::Parse(kTree, &tree));
+  std::vector<SwayView> views = CollectSwayViews(tree);
+  // Outputs, workspaces and split containers are not views
+  assert(views.size() == 3);
+  assert(views[0].id == 4);
+  assert(views[0].name == "~ - foot");
+  assert(views[0].app_id == "foot");
+  assert(views[0].pid == 100);
+  assert(views[0].focused);
+  // XWayland windows have a class instead of an app_id
+  assert(views[1].app_id == "whph");
+  assert(views[2].name == "Notes \xc3\xa9");
+  assert(!views[2].focused);
+
+  // i3 reports X11 window IDs and no PIDs
+  JsonValue i3_tree;
+  assert(JsonValue::Parse(
+      "{\"id\":1,\"type\":\"con\",\"name\":\"xterm\",\"window\":4194317,"
+      "\"window_properties\":{\"class\":\"XTerm\"},\"focused\":true}",
+      &i3_tree));
+  views = CollectSwayViews(i3_tree);
+  assert(views.size() == 1);
+  assert(views[0].app_id == "XTerm");
+  assert(views[0].pid == 0);
+
+  WindowInfo info = WaylandWindowDetector::ParseSwayTree(kTree);
+  assert(info.title == "~ - foot");
+  assert(info.application == "foot");
+  assert(info.pid == 100);
+  info = WaylandWindowDetector::ParseSwayTree("{\"type\":\"root\"}");
+  assert(info.title.empty());
+  info = WaylandWindowDetector::ParseSwayTree("{");
+  assert(info.title.empty());
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestPicksFocusTarget() {
+  std::cout << "Running TestPicksFocusTarget..." << std::endl;
+
+  JsonValue tree;
+  assert(JsonValue::Parse(kTree, &tree));
+  std::vector<SwayView> views = CollectSwayViews(tree);
+
+  assert(FindSwayFocusTarget(views, "Notes")->id == 6);
+  // WHPH's own window when no title matches, or none is given
+  assert(FindSwayFocusTarget(views, "Missing")->id == 5);
+  assert(FindSwayFocusTarget(views, "")->id == 5);
+  views.erase(views.begin() + 1);
+  assert(FindSwayFocusTarget(views, "Missing") == nullptr);
+
+  assert(SwayCommandSucceeded("[{\"success\":true}]"));
+  assert(!SwayCommandSucceeded(
+      "[{\"success\":true},{\"success\":false,\"error\":\"No matching\"}]"));
+  assert(!SwayCommandSucceeded("[]"));
+  assert(!SwayCommandSucceeded(""));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestParsesWindowEvents() {
+  std::cout << "Running TestParsesWindowEvents..." << std::endl;
+
+  std::string change;
+  SwayView view;
+  assert(ParseSwayWindowEvent(
+      "{\"change\":\"title\",\"container\":" +
+          ViewJson(4, "vim", "foot", 100, true) + "}",
+      &change, &view));
+  assert(change == "title");
+  assert(view.id == 4);
+  assert(view.name == "vim");
+  assert(view.focused);
+
+  assert(!ParseSwayWindowEvent("{\"change\":\"focus\"}", &change, &view));
+  assert(!ParseSwayWindowEvent("garbage", &change, &view));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestFollowsEvents(const std::string &path) {
+  std::cout << "Running TestFollowsEvents..." << std::endl;
+
+  FakeSway sway(path);
+  int changes = 0;
+  SwayIpcClient client(path, [&changes] { changes++; });
+  WindowInfo info;
+
+  // The tree sent after subscribing seeds the focus
+  assert(RunUntil([&] { return client.IsActive(); }));
+  assert(client.Current(&info));
+  assert(info.title == "~ - foot");
+  assert(info.application == "foot");
+  assert(info.pid == 100);
+  assert(info.backend == "sway-ipc");
+  assert(changes == 1);
+
+  sway.SendWindowEvent("focus",
+                       ViewJson(6, "Notes", "org.gnome.TextEditor", 300, true));
+  assert(RunUntil([&] { return changes == 2; }));
+  assert(client.Current(&info));
+  assert(info.title == "Notes");
+  assert(info.application == "org.gnome.TextEditor");
+
+  // Title changes count for the focused view only
+  sway.SendWindowEvent("title", ViewJson(4, "htop", "foot", 100, false));
+  sway.SendWindowEvent("title",
+                       ViewJson(6, "Notes *", "org.gnome.TextEditor", 300,
+                                true));
+  assert(RunUntil([&] { return changes == 3; }));
+  assert(client.Current(&info));
+  assert(info.title == "Notes *");
+
+  // Closing the last window leaves nothing focused
+  sway.SendWindowEvent("close",
+                       ViewJson(6, "Notes *", "org.gnome.TextEditor", 300,
+                                false));
+  assert(RunUntil([&] { return changes == 4; }));
+  assert(!client.Current(&info));
+  assert(client.IsActive());
+
+  // Requests go over their own connection, by container ID
+  std::vector<ToplevelWindow> windows =
+      CallOffMainThread<std::vector<ToplevelWindow>>(
+          [&] { return client.Windows(); });
+  assert(windows.size() == 3);
+  assert(windows[0].title == "~ - foot");
+  assert(windows[0].focused);
+  assert(windows[1].application == "whph");
+  assert(windows[1].pid == 200);
+  assert(CallOffMainThread<bool>([&] { return client.Focus("Notes"); }));
+  assert(CallOffMainThread<bool>([&] { return client.Focus("Missing"); }));
+  assert((sway.commands ==
+          std::vector<std::string>{"[con_id=6] focus", "[con_id=5] focus"}));
+
+  // Sway goes away
+  sway.Stop();
+  assert(RunUntil([&] { return !client.IsActive(); }));
+  assert(changes == 5);
+  assert(!client.Current(&info));
+  assert(!CallOffMainThread<bool>([&] { return client.Focus("Notes"); }));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestWithoutSocket(const std::string &path) {
+  std::cout << "Running TestWithoutSocket..." << std::endl;
+
+  SwayIpcClient unset("", [] { assert(false); });
+  SwayIpcClient missing(path, [] { assert(false); });
+  for (int i = 0; i < 10; i++) {
+    g_main_context_iteration(nullptr, FALSE);
+  }
+  WindowInfo info;
+  assert(!unset.IsActive());
+  assert(!unset.Current(&info));
+  assert(!unset.Focus("Notes"));
+  assert(unset.Windows().empty());
+  assert(!missing.IsActive());
+  assert(!missing.Focus("Notes"));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestFramesMessages();
+  TestParsesTree();
+  TestPicksFocusTarget();
+  TestParsesWindowEvents();
+
+  gchar *dir = g_dir_make_tmp("whph-sway-XXXXXX", nullptr);
+  assert(dir);
+  std::string path = std::string(dir) + "/sway-ipc.sock";
+  TestFollowsEvents(path);
+  unlink(path.c_str());
+  TestWithoutSocket(path);
+  rmdir(dir);
+  g_free(dir);
+
+  std::cout << "All sway_ipc tests passed!" << std::endl;
+  return 0;
+}
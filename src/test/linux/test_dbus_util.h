@@ -0,0 +1,59 @@
+#ifndef TEST_DBUS_UTIL_H_
+#define TEST_DBUS_UTIL_H_
+
+// Helpers shared by the tests that drive a main context or a private
+// dbus-daemon.
+
+#include <gio/gio.h>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// A new connection to the message bus at address; nullptr on failure.
+inline GDBusConnection *Connect(const gchar *address) {
+  return g_dbus_connection_new_for_address_sync(
+      address,
+      static_cast<GDBusConnectionFlags>(
+          G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+          G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+      nullptr, nullptr, nullptr);
+}
+
+// Iterates the main context until done() or timeout has passed.
+inline bool
+RunUntil(const std::function<bool()> &done,
+         std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (!done()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    g_main_context_iteration(nullptr, FALSE);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+// Runs tests against a private dbus-daemon, which also becomes the session
+// bus for the duration. Returns false, having run nothing, if dbus-daemon is
+// not installed.
+inline bool
+RunOnTestBus(const std::function<void(const gchar *address)> &tests) {
+  gchar *daemon = g_find_program_in_path("dbus-daemon");
+  if (!daemon) {
+    std::cout << "dbus-daemon not found, skipping bus tests" << std::endl;
+    return false;
+  }
+  g_free(daemon);
+
+  GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+  g_test_dbus_up(bus);
+  tests(g_test_dbus_get_bus_address(bus));
+  g_test_dbus_down(bus);
+  g_object_unref(bus);
+  return true;
+}
+
+#endif // TEST_DBUS_UTIL_H_
@@ -0,0 +1,61 @@
+// Micro-benchmark for the per-call cost of active window detection.
+//
+// Not part of the regular test suite (run_tests.sh only picks up *_test.cpp).
+// Build and run from the project root inside a desktop session:
+//
+//   g++ -O2 -pthread -o /tmp/window_detector_benchmark \
+//     src/test/linux/window_detector_benchmark.cpp src/linux/*.cpp \
+//     $(pkg-config --cflags --libs glib-2.0 gio-2.0) -I src/linux
+//   /tmp/window_detector_benchmark [iterations]
+//
+// "per-call detector" mirrors the old method channel behaviour, which created
+// a new WindowDetector for every getActiveWindow call. "persistent detector"
+// mirrors the current behaviour, where the application owns one detector.
+
+#include "window_detector.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using BenchClock = std::chrono::steady_clock;
+
+template <typename Fn> double MeasureMicros(int iterations, Fn fn) {
+  auto start = BenchClock::now();
+  for (int i = 0; i < iterations; i++) {
+    fn();
+  }
+  auto elapsed = BenchClock::now() - start;
+  return std::chrono::duration<double, std::micro>(elapsed).count() /
+         iterations;
+}
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 50;
+  if (iterations <= 0) {
+    iterations = 50;
+  }
+
+  std::string sink;
+
+  double per_call = MeasureMicros(iterations, [&sink]() {
+    auto detector = WindowDetector::Create();
+    WindowInfo info = detector->GetActiveWindow();
+    sink = info.title;
+  });
+
+  auto detector = WindowDetector::Create();
+  // Warm up once so one-time setup is not attributed to the first sample.
+  detector->GetActiveWindow();
+  double persistent = MeasureMicros(iterations, [&sink, &detector]() {
+    WindowInfo info = detector->GetActiveWindow();
+    sink = info.title;
+  });
+
+  std::cout << "iterations:          " << iterations << std::endl;
+  std::cout << "per-call detector:   " << per_call << " us/call" << std::endl;
+  std::cout << "persistent detector: " << persistent << " us/call"
+            << std::endl;
+  std::cout << "last title:          " << sink << std::endl;
+  return 0;
+}
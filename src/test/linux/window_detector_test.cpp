@@ -57,8 +57,83 @@ void TestKdeJournalParsing() {
   std::cout << "  Passed: Styles whitespace trimming" << std::endl;
 }
 
+void TestKdeSupportInfoScanner() {
+  std::cout << "Running TestKdeSupportInfoScanner..." << std::endl;
+
+  // Case 1: Values of the block right before the active marker are used
+  std::vector<std::string> lines = {
+      "Resource Class: konsole", "Caption: ~ : bash", "Active: false",
+      "Resource Class: org.mozilla.firefox", "Caption: Mozilla Firefox",
+      "Active: true", "Resource Class: dolphin"};
+  KdeSupportInfoScanner scanner1;
+  size_t consumed = 0;
+  for (const std::string &line : lines) {
+    consumed++;
+    if (!scanner1.AddLine(line)) {
+      break;
+    }
+  }
+  assert(scanner1.Found());
+  assert(consumed == 6); // Stops at the marker
+  assert(scanner1.Result().application == "org.mozilla.firefox");
+  assert(scanner1.Result().title == "Mozilla Firefox");
+  assert(!scanner1.AddLine("Caption: ignored"));
+  std::cout << "  Passed: Stops at active window" << std::endl;
+
+  // Case 2: Values further back than the context window are forgotten
+  KdeSupportInfoScanner scanner2;
+  scanner2.AddLine("Resource Class: stale");
+  for (size_t i = 0; i < KdeSupportInfoScanner::kContextLines; i++) {
+    scanner2.AddLine("Geometry: 0,0 100x100");
+  }
+  scanner2.AddLine("active: true");
+  assert(scanner2.Found());
+  assert(scanner2.Result().application.empty());
+  std::cout << "  Passed: Bounded context" << std::endl;
+
+  // Case 3: No active window
+  KdeSupportInfoScanner scanner3;
+  assert(scanner3.AddLine("Resource Class: konsole"));
+  assert(!scanner3.Found());
+  assert(scanner3.Result().application == "unknown");
+  std::cout << "  Passed: No active window" << std::endl;
+}
+
+void TestWindowListParsing() {
+  std::cout << "Testing window list parsing..." << std::endl;
+
+  std::string output = "false\tfalse\t100\tfirefox\tNews - Mozilla Firefox\n"
+                       "true\tfalse\t200\tfoot\tvim a\\tb\\\\c\n"
+                       "false\ttrue\tnull\t\t\n"
+                       "malformed line\n";
+  std::vector<ToplevelWindow> windows =
+      WaylandWindowDetector::ParseWindowListTsv(output);
+  assert(windows.size() == 3);
+
+  assert(!windows[0].focused);
+  assert(!windows[0].minimized);
+  assert(windows[0].pid == 100);
+  assert(windows[0].application == "firefox");
+  assert(windows[0].title == "News - Mozilla Firefox");
+
+  // Escaped tabs and backslashes in titles
+  assert(windows[1].focused);
+  assert(windows[1].title == "vim a\tb\\c");
+
+  // Missing pid, application and title
+  assert(windows[2].minimized);
+  assert(windows[2].pid == 0);
+  assert(windows[2].application.empty());
+  assert(windows[2].title.empty());
+
+  assert(WaylandWindowDetector::ParseWindowListTsv("").empty());
+  std::cout << "  Passed" << std::endl;
+}
+
 int main() {
   TestKdeJournalParsing();
+  TestKdeSupportInfoScanner();
+  TestWindowListParsing();
   std::cout << "All tests passed!" << std::endl;
   return 0;
 }
@@ -32,26 +32,28 @@ void TestGnomeParsing() {
 
   // Normal
   WindowInfo info = WaylandWindowDetector::ParseGnomeEval(
-      "(true, 'My Title')", "(true, 'org.example.App')");
+      "[\"My Title\",\"org.example.App\",1234]");
   assert(info.title == "My Title");
   assert(info.application == "org.example.App");
+  assert(info.pid == 1234);
 
-  // Empty/False
-  info = WaylandWindowDetector::ParseGnomeEval("(false, '')", "(false, '')");
+  // Nothing focused, or Eval failed
+  info = WaylandWindowDetector::ParseGnomeEval("null");
   assert(info.title.empty());
   assert(info.application.empty());
+  info = WaylandWindowDetector::ParseGnomeEval("");
+  assert(info.title.empty());
+
+  // JSON escapes, including a surrogate pair and a null app ID
+  info = WaylandWindowDetector::ParseGnomeEval(
+      "[\"It's a \\\"title\\\" \\u00e9 \\ud83d\\ude00\", null, 0]");
+  assert(info.title == "It's a \"title\" \xc3\xa9 \xf0\x9f\x98\x80");
+  assert(info.application.empty());
+  assert(info.pid == 0);
 
-  // With quotes in string
-  // This depends on how CleanQuotes handles it, but typically Gnome returns
-  // escaped JS strings? Our CleanQuotes just removes outer quotes.
-  info = WaylandWindowDetector::ParseGnomeEval("(true, 'It\\'s a title')",
-                                               "(true, 'app')");
-  // ValidateUtf8/CleanQuotes usage in implementation:
-  // res.substr(start, end-start) -> 'It\'s a title'
-  // CleanQuotes -> It\'s a title
-  // It does NOT unescape inner quotes currently in ParseGnomeEval
-  // implementation! Wait, CleanQuotes removes front/back quotes. If input is
-  // "(true, 'title')", substr is `'title'`. CleanQuotes makes it `title`.
+  // Truncated
+  info = WaylandWindowDetector::ParseGnomeEval("[\"My Title\",\"app");
+  assert(info.title.empty());
 
   std::cout << "  Passed" << std::endl;
 }
@@ -64,6 +66,7 @@ void TestFallbackParsing() {
   WindowInfo info =
       FallbackWindowDetector::ParsePsOutput("1234 0.1 myapp", "/usr/bin/myapp");
   assert(info.application == "myapp");
+  assert(info.pid == 1234);
   assert(info.title ==
          "myapp"); // cmdline processing uses filename as title if available
 
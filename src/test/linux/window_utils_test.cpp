@@ -2,7 +2,6 @@
 #include <cassert>
 #include <iostream>
 #include <string>
-#include <vector>
 
 void TestShellEscape() {
   std::cout << "Running TestShellEscape..." << std::endl;
@@ -24,30 +23,25 @@ void TestShellEscape() {
   std::cout << "  Passed" << std::endl;
 }
 
-void TestUnescapeGVariant() {
-  std::cout << "Running TestUnescapeGVariant..." << std::endl;
+void TestJsString() {
+  std::cout << "Running TestJsString..." << std::endl;
 
-  // Test standard GVariant string
-  assert(UnescapeGVariantString("('hello',)") == "hello");
-
-  // Test simple quoted string
-  assert(UnescapeGVariantString("'hello'") == "hello");
-
-  // Test escaped characters
-  // ('don\'t',) -> don't
-  assert(UnescapeGVariantString("('don\\'t',)") == "don't");
-
-  // Test no quotes (should return as is if not matching pattern, or maybe
-  // handle gracefully) The current implementation expects quotes for stripping,
-  // else returns as is
-  assert(UnescapeGVariantString("hello") == "hello");
+  assert(JsString("Editor") == "\"Editor\"");
+  // Single quotes need no escape inside double quotes
+  assert(JsString("it's') + alert(1) + ('") ==
+         "\"it's') + alert(1) + ('\"");
+  assert(JsString("say \"hi\" \\o/") == "\"say \\\"hi\\\" \\\\o/\"");
+  assert(JsString("a\nb\tc") == "\"a\\u000ab\\u0009c\"");
+  // UTF-8 is passed through
+  assert(JsString("caf\xc3\xa9") == "\"caf\xc3\xa9\"");
+  assert(JsString("") == "\"\"");
 
   std::cout << "  Passed" << std::endl;
 }
 
 int main() {
   TestShellEscape();
-  TestUnescapeGVariant();
+  TestJsString();
 
   std::cout << "All window_utils tests passed!" << std::endl;
   return 0;
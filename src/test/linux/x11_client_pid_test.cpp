@@ -0,0 +1,76 @@
+#include "x11_client_pid.h"
+#include <cassert>
+#include <iostream>
+
+void TestCachesPids() {
+  std::cout << "Running TestCachesPids..." << std::endl;
+
+  WindowPidCache cache;
+  int pid = -1;
+  assert(!cache.Lookup(0x1200003, &pid));
+
+  cache.Store(0x1200003, 4242);
+  assert(cache.Lookup(0x1200003, &pid));
+  assert(pid == 4242);
+
+  // A remote client without a PID is remembered too
+  cache.Store(0x1400001, 0);
+  assert(cache.Lookup(0x1400001, &pid));
+  assert(pid == 0);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestRetainDropsDestroyedWindows() {
+  std::cout << "Running TestRetainDropsDestroyedWindows..." << std::endl;
+
+  WindowPidCache cache;
+  cache.Store(1, 100);
+  cache.Store(2, 200);
+  cache.Store(3, 300);
+
+  cache.Retain({1, 3, 4});
+
+  int pid = 0;
+  assert(cache.Size() == 2);
+  assert(cache.Lookup(1, &pid) && pid == 100);
+  assert(!cache.Lookup(2, &pid));
+  assert(cache.Lookup(3, &pid) && pid == 300);
+  // Windows in the list are not added
+  assert(!cache.Lookup(4, &pid));
+
+  cache.Retain({});
+  assert(cache.Size() == 0);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestStaysBounded() {
+  std::cout << "Running TestStaysBounded..." << std::endl;
+
+  WindowPidCache cache;
+  for (uint64_t window = 0; window < WindowPidCache::kMaxEntries; window++) {
+    cache.Store(window, 1);
+  }
+  assert(cache.Size() == WindowPidCache::kMaxEntries);
+
+  // Updating a known window does not count as growth
+  cache.Store(0, 2);
+  assert(cache.Size() == WindowPidCache::kMaxEntries);
+
+  cache.Store(WindowPidCache::kMaxEntries, 3);
+  assert(cache.Size() == 1);
+  int pid = 0;
+  assert(cache.Lookup(WindowPidCache::kMaxEntries, &pid) && pid == 3);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestCachesPids();
+  TestRetainDropsDestroyedWindows();
+  TestStaysBounded();
+
+  std::cout << "All x11_client_pid tests passed!" << std::endl;
+  return 0;
+}
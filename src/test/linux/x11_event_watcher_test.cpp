@@ -0,0 +1,59 @@
+#include "x11_event_watcher.h"
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+using std::chrono::milliseconds;
+using std::chrono::nanoseconds;
+using std::chrono::seconds;
+
+void TestMapsServerTime() {
+  std::cout << "Running TestMapsServerTime..." << std::endl;
+
+  ServerTimeMapper mapper;
+  nanoseconds boot = seconds(1000);
+
+  // The first event defines the offset
+  assert(mapper.ToBootTime(5000, boot) == boot);
+
+  // An earlier event read later keeps its own time
+  assert(mapper.ToBootTime(5500, boot + milliseconds(700)) ==
+         boot + milliseconds(500));
+
+  // A faster delivery tightens the offset
+  assert(mapper.ToBootTime(6000, boot + milliseconds(900)) ==
+         boot + milliseconds(900));
+  assert(mapper.ToBootTime(6100, boot + milliseconds(1050)) ==
+         boot + milliseconds(1000));
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestResetsAfterClockJump() {
+  std::cout << "Running TestResetsAfterClockJump..." << std::endl;
+
+  ServerTimeMapper mapper;
+  nanoseconds boot = seconds(1000);
+  mapper.ToBootTime(5000, boot);
+
+  // After a suspend the server clock fell behind CLOCK_BOOTTIME by a minute;
+  // without a reset the event would be dated a minute too early
+  nanoseconds after_resume = boot + seconds(61);
+  assert(mapper.ToBootTime(6000, after_resume) == after_resume);
+  assert(mapper.ToBootTime(6200, after_resume + milliseconds(300)) ==
+         after_resume + milliseconds(200));
+
+  // Server time wrapped around
+  nanoseconds later = after_resume + seconds(10);
+  assert(mapper.ToBootTime(100, later) == later);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestMapsServerTime();
+  TestResetsAfterClockJump();
+
+  std::cout << "All x11_event_watcher tests passed!" << std::endl;
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include "x11_window_table.h"
+#include <cassert>
+#include <iostream>
+
+X11WindowProperties MakeWindow(const std::string &title,
+                           const std::string &wm_class = "") {
+  X11WindowProperties properties;
+  properties.title = title;
+  properties.has_title = true;
+  properties.wm_class = wm_class;
+  return properties;
+}
+
+void TestTracksClientList() {
+  std::cout << "Running TestTracksClientList..." << std::endl;
+
+  X11WindowTable table;
+  std::vector<uint64_t> added = table.SetWindows({1, 2});
+  assert((added == std::vector<uint64_t>{1, 2}));
+  table.Update(1, MakeWindow("Editor"));
+  table.Update(2, MakeWindow("Terminal"));
+
+  // Only new windows need their properties fetched
+  added = table.SetWindows({2, 3});
+  assert((added == std::vector<uint64_t>{3}));
+  assert(!table.Contains(1));
+  assert(table.Contains(2));
+  assert(table.Size() == 2);
+  assert(table.Find("Terminal") == 2);
+
+  // Updates for windows that are not listed are dropped
+  table.Update(1, MakeWindow("Editor"));
+  assert(!table.Contains(1));
+  assert(table.Find("Editor") == 0);
+
+  table.Clear();
+  assert(table.Size() == 0);
+  assert(table.Find("Terminal") == 0);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestFindsWindows() {
+  std::cout << "Running TestFindsWindows..." << std::endl;
+
+  X11WindowTable table;
+  table.SetWindows({1, 2, 3});
+  table.Update(1, MakeWindow("Files", "Nautilus"));
+  table.Update(2, MakeWindow("WHPH - Tasks", "whph"));
+  table.Update(3, MakeWindow("Tasks - Browser", "Firefox"));
+
+  // First match in client list order
+  assert(table.Find("Tasks") == 2);
+  assert(table.Find("Browser") == 3);
+
+  // A title that does not match falls back to WHPH's own window
+  assert(table.Find("Nonexistent") == 2);
+  assert(table.Find("") == 2);
+
+  table.Update(2, MakeWindow("Tasks"));
+  assert(table.Find("Nonexistent") == 0);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+void TestSnapshotKeepsClientListOrder() {
+  std::cout << "Running TestSnapshotKeepsClientListOrder..." << std::endl;
+
+  X11WindowTable table;
+  table.SetWindows({3, 1, 2});
+  X11WindowProperties minimized = MakeWindow("Editor");
+  minimized.hidden = true;
+  table.Update(1, minimized);
+
+  auto windows = table.Snapshot();
+  assert(windows.size() == 3);
+  assert(windows[0].first == 3 && !windows[0].second.has_title);
+  assert(windows[1].first == 1 && windows[1].second.title == "Editor");
+  assert(windows[1].second.hidden);
+  assert(windows[2].first == 2);
+
+  std::cout << "  Passed" << std::endl;
+}
+
+int main() {
+  TestTracksClientList();
+  TestFindsWindows();
+  TestSnapshotKeepsClientListOrder();
+
+  std::cout << "All x11_window_table tests passed!" << std::endl;
+  return 0;
+}